@@ -0,0 +1,137 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Throughput of MemoryDiff::GetChangedRanges against a word-at-a-time scan
+ *
+ * Two buffers differ in a number of randomly placed bytes. Each run finds
+ * the changed ranges repeatedly and reports how many bytes were scanned
+ * per second.
+ *
+ *   Usage: memdiff_bench [size KiB] [changed bytes]
+ */
+
+#include "utils/MemoryDiff.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace NETPLAY;
+
+#define DEFAULT_SIZE_KB        1024
+#define DEFAULT_CHANGES        256
+#define MIN_DURATION_MS        200
+
+namespace
+{
+  /*!
+   * \brief Compare 64 bits at a time, the scan the diff kernels replaced
+   */
+  void WordRanges(const uint8_t* a, const uint8_t* b, size_t size, std::vector<MemoryRange>& ranges)
+  {
+    ranges.clear();
+
+    const size_t words = size / sizeof(uint64_t);
+    size_t word = 0;
+
+    while (word < words)
+    {
+      uint64_t x, y;
+      do
+      {
+        std::memcpy(&x, a + word * sizeof(x), sizeof(x));
+        std::memcpy(&y, b + word * sizeof(y), sizeof(y));
+      } while (x == y && ++word < words);
+
+      const size_t start = word;
+      while (word < words)
+      {
+        std::memcpy(&x, a + word * sizeof(x), sizeof(x));
+        std::memcpy(&y, b + word * sizeof(y), sizeof(y));
+        if (x == y)
+          break;
+        word++;
+      }
+
+      if (word > start)
+      {
+        MemoryRange range = { start * sizeof(uint64_t), (word - start) * sizeof(uint64_t) };
+        ranges.push_back(range);
+      }
+    }
+  }
+
+  template <typename FUNC>
+  double Measure(FUNC func, const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, size_t& rangeCount)
+  {
+    std::vector<MemoryRange> ranges;
+    uint64_t iterations = 0;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration elapsed;
+
+    do
+    {
+      func(a.data(), b.data(), a.size(), ranges);
+      iterations++;
+      elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(MIN_DURATION_MS));
+
+    rangeCount = ranges.size();
+
+    return iterations * a.size() / std::chrono::duration<double>(elapsed).count();
+  }
+
+  void KernelRanges(const uint8_t* a, const uint8_t* b, size_t size, std::vector<MemoryRange>& ranges)
+  {
+    MemoryDiff::GetChangedRanges(a, b, size, ranges);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const size_t size = (argc > 1 ? atoi(argv[1]) : DEFAULT_SIZE_KB) * 1024;
+  const unsigned int changes = argc > 2 ? atoi(argv[2]) : DEFAULT_CHANGES;
+
+  std::vector<uint8_t> a(size);
+  for (size_t i = 0; i < size; i++)
+    a[i] = static_cast<uint8_t>(rand());
+
+  std::vector<uint8_t> b(a);
+  for (unsigned int i = 0; i < changes && size > 0; i++)
+    b[rand() % size]++;
+
+  size_t wordCount;
+  size_t kernelCount;
+  const double word = Measure(WordRanges, a, b, wordCount);
+  const double kernel = Measure(KernelRanges, a, b, kernelCount);
+
+  printf("%u KiB, %u changed bytes, %s kernel\n\n", static_cast<unsigned int>(size / 1024), changes, MemoryDiff::KernelName());
+  printf("%8s %12s %8s\n", "scan", "GB/s", "ranges");
+  printf("%8s %12.2f %8u\n", "word", word / 1e9, static_cast<unsigned int>(wordCount));
+  printf("%8s %12.2f %8u\n", "kernel", kernel / 1e9, static_cast<unsigned int>(kernelCount));
+  printf("\nspeedup %.2fx\n", kernel / word);
+
+  return 0;
+}
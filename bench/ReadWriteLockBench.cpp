@@ -0,0 +1,172 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Contention microbenchmark for CReadWriteLock
+ *
+ * Each thread loops over a short critical section for a fixed time, taking
+ * the write lock for a configurable fraction of iterations. The mutex-based
+ * lock that CReadWriteLock replaced is reproduced below as the baseline.
+ *
+ *   Usage: rwlock_bench [duration ms] [writes per thousand]
+ */
+
+#include "utils/ReadWriteLock.h"
+
+#include "platform/threads/mutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define DEFAULT_DURATION_MS    500
+#define DEFAULT_WRITES         10    // Per thousand iterations
+#define MAX_THREADS            32
+
+namespace
+{
+  /*!
+   * \brief The previous CReadWriteLock: readers share a mutex, and the first
+   *        reader holds the writer's mutex until the last reader leaves
+   */
+  class CMutexReadWriteLock
+  {
+  public:
+    CMutexReadWriteLock(void) : m_readCount(0) { }
+
+    void LockRead(void)
+    {
+      CLockObject lock(m_readLock);
+      if (++m_readCount == 1)
+        LockWrite();
+    }
+
+    void UnlockRead(void)
+    {
+      CLockObject lock(m_readLock);
+      if (--m_readCount == 0)
+        UnlockWrite();
+    }
+
+    void LockWrite(void)   { m_writeLock.Lock(); }
+    void UnlockWrite(void) { m_writeLock.Unlock(); }
+
+  private:
+    CMutex m_readLock;
+    CMutex m_writeLock;
+    int    m_readCount;
+  };
+
+  struct SharedData
+  {
+    uint64_t values[8];
+  };
+
+  template <typename LOCK>
+  uint64_t RunThread(LOCK& lock, SharedData& data, std::atomic<bool>& bStop, unsigned int writesPerThousand, unsigned int seed)
+  {
+    uint64_t iterations = 0;
+    uint64_t sum = 0;
+
+    while (!bStop.load(std::memory_order_relaxed))
+    {
+      seed = seed * 1103515245 + 12345;
+
+      if ((seed >> 16) % 1000 < writesPerThousand)
+      {
+        lock.LockWrite();
+        for (unsigned int i = 0; i < 8; i++)
+          data.values[i]++;
+        lock.UnlockWrite();
+      }
+      else
+      {
+        lock.LockRead();
+        for (unsigned int i = 0; i < 8; i++)
+          sum += data.values[i];
+        lock.UnlockRead();
+      }
+
+      iterations++;
+    }
+
+    // Keep the reads from being optimized away
+    if (sum == 1)
+      printf(" ");
+
+    return iterations;
+  }
+
+  template <typename LOCK>
+  double Measure(unsigned int threadCount, unsigned int durationMs, unsigned int writesPerThousand)
+  {
+    LOCK lock;
+    SharedData data = { };
+    std::atomic<bool> bStop(false);
+    std::vector<uint64_t> iterations(threadCount);
+    std::vector<std::thread> threads;
+
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+      threads.push_back(std::thread([&, i]()
+      {
+        iterations[i] = RunThread(lock, data, bStop, writesPerThousand, i + 1);
+      }));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
+    bStop = true;
+
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+      threads[i].join();
+      total += iterations[i];
+    }
+
+    return total * 1000.0 / durationMs;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const unsigned int durationMs = argc > 1 ? atoi(argv[1]) : DEFAULT_DURATION_MS;
+  const unsigned int writesPerThousand = argc > 2 ? atoi(argv[2]) : DEFAULT_WRITES;
+
+  printf("%u ms per run, %u writes per thousand operations\n\n", durationMs, writesPerThousand);
+  printf("%8s %16s %16s %8s\n", "threads", "mutex (ops/s)", "striped (ops/s)", "speedup");
+
+  for (unsigned int threadCount = 1; threadCount <= MAX_THREADS; threadCount *= 2)
+  {
+    const double baseline = Measure<CMutexReadWriteLock>(threadCount, durationMs, writesPerThousand);
+    const double striped = Measure<CReadWriteLock>(threadCount, durationMs, writesPerThousand);
+
+    printf("%8u %16.0f %16.0f %7.2fx\n", threadCount, baseline, striped, striped / baseline);
+  }
+
+  return 0;
+}
@@ -18,12 +18,19 @@
  *
  */
 
+#include "filesystem/AutoSave.h"
+#include "interface/DirectCalls.h"
 #include "interface/dll/DLLFrontend.h"
 #include "interface/dll/DLLGame.h"
 #include "interface/FrontendManager.h"
+#include "interface/RunAheadGame.h"
+#if !defined(_WIN32)
+  #include "interface/ipc/IPCGame.h"
+#endif
 #include "keyboard/Keyboard.h"
 #include "keyboard/KeyboardAddon.h"
 #include "log/Log.h"
+#include "netplay/NetplayGame.h"
 #include "utils/PathUtils.h"
 
 #include "kodi/kodi_game_dll.h"
@@ -46,6 +53,8 @@ namespace NETPLAY
   IFrontend*              FRONTEND  = NULL;
   CFrontendManager*       CALLBACKS = NULL;
   IGame*                  GAME      = NULL;
+  CAutoSave*              AUTOSAVE  = NULL;
+  GameDirectCalls         DIRECT    = { };
 }
 
 // --- Helper functions --------------------------------------------------------
@@ -69,7 +78,7 @@ namespace NETPLAY
     return properties.proxy_dll_paths.empty();
   }
 
-  IGame* GetGame(const GameClientProperties& properties, IFrontend* callbacks)
+  IGame* GetGame(const GameClientProperties& properties, CFrontendManager* callbacks)
   {
     IGame* game = NULL;
 
@@ -79,11 +88,58 @@ namespace NETPLAY
 
       std::string myPath = properties.proxy_dll_paths[0];
       std::string myDir = PathUtils::GetParentDirectory(myPath);
-      game = new CDLLGame(callbacks, PopProxyDLL(properties), PathUtils::GetHelperLibraryDir(myDir));
+
+#if !defined(_WIN32)
+      // Hosting the game client in a child process keeps a crashing emulator
+      // from taking down Kodi
+      bool bOutOfProcess = false;
+      if (callbacks->GetSetting("out_of_process", &bOutOfProcess) && bOutOfProcess)
+        game = new CIPCGame(callbacks, PopProxyDLL(properties), PathUtils::GetServerPath(myDir));
+      else
+#endif
+        game = new CDLLGame(callbacks, PopProxyDLL(properties), PathUtils::GetHelperLibraryDir(myDir));
+
+      int runAheadFrames = 0;
+      if (callbacks->GetSetting("run_ahead", &runAheadFrames) && runAheadFrames > 0)
+      {
+        // A second instance must live in this process to skip serialization
+        IGame* secondary = NULL;
+        bool bSecondInstance = false;
+        if (dynamic_cast<CDLLGame*>(game) != NULL &&
+            callbacks->GetSetting("run_ahead_second_instance", &bSecondInstance) && bSecondInstance)
+        {
+          secondary = new CDLLGame(callbacks, PopProxyDLL(properties), PathUtils::GetHelperLibraryDir(myDir), true);
+        }
+
+        game = new CRunAheadGame(game, callbacks, runAheadFrames, secondary);
+      }
+
+      game = new CNetplayGame(game, callbacks);
     }
 
     return game;
   }
+
+  /*!
+   * \brief Let the per-frame calls skip the proxy layers while they are idle
+   */
+  void BindDirectCalls(void)
+  {
+    GameDirectCalls calls = { };
+    if (GAME && GAME->GetDirectCalls(calls))
+    {
+      DIRECT = calls;
+      dsyslog("Calling game client directly while no layer needs the calls");
+    }
+  }
+
+  void UnbindDirectCalls(void)
+  {
+    if (DIRECT.gate)
+      DIRECT.gate->Close();
+
+    DIRECT = GameDirectCalls();
+  }
 }
 
 // --- API functions -----------------------------------------------------------
@@ -114,6 +170,11 @@ ADDON_STATUS ADDON_Create(void* callbacks, void* props)
     if (!CALLBACKS->Initialize())
       throw ADDON_STATUS_PERMANENT_FAILURE;
 
+    // Must be known before the frontend is registered
+    bool bAsyncDispatch = false;
+    if (FRONTEND->GetSetting("async_dispatch", &bAsyncDispatch) && bAsyncDispatch)
+      CALLBACKS->SetAsyncDispatch(true);
+
     CALLBACKS->RegisterFrontend(FRONTEND);
 
     GameClientProperties gameProps = CDLLGame::TranslateProperties(*static_cast<game_client_properties*>(props));
@@ -125,6 +186,9 @@ ADDON_STATUS ADDON_Create(void* callbacks, void* props)
     if (status == ADDON_STATUS_UNKNOWN || status == ADDON_STATUS_PERMANENT_FAILURE)
       throw status;
 
+    if (!IsStandalone(gameProps) && !gameProps.save_directory.empty())
+      AUTOSAVE = new CAutoSave(GAME, gameProps.save_directory);
+
     returnStatus = ADDON_STATUS_OK;
   }
   catch (const ADDON_STATUS& status)
@@ -144,11 +208,16 @@ void ADDON_Stop()
 
 void ADDON_Destroy()
 {
+  UnbindDirectCalls();
+
+  SAFE_DELETE(AUTOSAVE);
+
   if (GAME)
     GAME->Deinitialize();
 
   if (CALLBACKS)
   {
+    CALLBACKS->DumpStats();
     CALLBACKS->UnregisterFrontend(FRONTEND);
     CALLBACKS->Deinitialize();
   }
@@ -231,7 +300,16 @@ GAME_ERROR LoadGame(const char* url)
     return GAME_ERROR_INVALID_PARAMETERS;
 
   if (GAME)
-    return GAME->LoadGame(url);
+  {
+    GAME_ERROR error = GAME->LoadGame(url);
+    if (error == GAME_ERROR_NO_ERROR)
+    {
+      BindDirectCalls();
+      if (AUTOSAVE)
+        AUTOSAVE->Start(url);
+    }
+    return error;
+  }
 
   return GAME_ERROR_FAILED;
 }
@@ -242,7 +320,16 @@ GAME_ERROR LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t url
     return GAME_ERROR_INVALID_PARAMETERS;
 
   if (GAME)
-    return GAME->LoadGameSpecial(type, urls, urlCount);
+  {
+    GAME_ERROR error = GAME->LoadGameSpecial(type, urls, urlCount);
+    if (error == GAME_ERROR_NO_ERROR)
+    {
+      BindDirectCalls();
+      if (AUTOSAVE)
+        AUTOSAVE->Start(urls[0]);
+    }
+    return error;
+  }
 
   return GAME_ERROR_FAILED;
 }
@@ -257,6 +344,11 @@ GAME_ERROR LoadStandalone(void)
 
 GAME_ERROR UnloadGame(void)
 {
+  UnbindDirectCalls();
+
+  if (AUTOSAVE)
+    AUTOSAVE->Stop();
+
   if (GAME)
     return GAME->UnloadGame();
 
@@ -284,8 +376,16 @@ GAME_REGION GetRegion(void)
 
 void FrameEvent(void)
 {
-  if (GAME)
-    return GAME->FrameEvent();
+  {
+    CDirectCall direct(DIRECT, DIRECT_CALL_FRAME_EVENT);
+    if (direct.IsDirect())
+      DIRECT.FrameEvent();
+    else if (GAME)
+      GAME->FrameEvent();
+  }
+
+  if (AUTOSAVE)
+    AUTOSAVE->FrameEvent();
 }
 
 GAME_ERROR Reset(void)
@@ -326,6 +426,10 @@ bool InputEvent(unsigned int port, const game_input_event* event)
   if (event == NULL)
     return GAME_ERROR_INVALID_PARAMETERS;
 
+  CDirectCall direct(DIRECT, DIRECT_CALL_INPUT_EVENT);
+  if (direct.IsDirect())
+    return DIRECT.InputEvent(port, event);
+
   if (GAME)
     return GAME->InputEvent(port, event);
 
@@ -342,6 +446,10 @@ GAME_ERROR Serialize(uint8_t* data, size_t size)
   if (data == NULL || size == 0)
     return GAME_ERROR_INVALID_PARAMETERS;
 
+  CDirectCall direct(DIRECT, DIRECT_CALL_SERIALIZE);
+  if (direct.IsDirect())
+    return DIRECT.Serialize(data, size);
+
   if (GAME)
     return GAME->Serialize(data, size);
 
@@ -353,6 +461,10 @@ GAME_ERROR Deserialize(const uint8_t* data, size_t size)
   if (data == NULL || size == 0)
     return GAME_ERROR_INVALID_PARAMETERS;
 
+  CDirectCall direct(DIRECT, DIRECT_CALL_DESERIALIZE);
+  if (direct.IsDirect())
+    return DIRECT.Deserialize(data, size);
+
   if (GAME)
     return GAME->Deserialize(data, size);
 
@@ -372,6 +484,10 @@ GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size)
   if (data == NULL || size == NULL)
     return GAME_ERROR_INVALID_PARAMETERS;
 
+  CDirectCall direct(DIRECT, DIRECT_CALL_GET_MEMORY);
+  if (direct.IsDirect())
+    return DIRECT.GetMemory(type, data, size);
+
   if (GAME)
     return GAME->GetMemory(type, data, size);
 
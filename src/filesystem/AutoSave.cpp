@@ -0,0 +1,290 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "AutoSave.h"
+#include "interface/IGame.h"
+#include "log/Log.h"
+#include "utils/PathUtils.h"
+
+#include "platform/util/timeutils.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+  #include <io.h>
+  #include <windows.h>
+#else
+  #include <unistd.h>
+#endif
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define STATE_EXTENSION        ".state"
+#define SRAM_EXTENSION         ".srm"
+#define TEMP_EXTENSION         ".tmp"
+#define SRAM_CHECK_INTERVAL_MS 1000  // Save RAM is compared at most this often
+#define MAX_POOLED_SAVES       4     // A pending and an in-flight buffer per file
+
+CAutoSave::CAutoSave(IGame* game, const std::string& strSaveDirectory) :
+  m_game(game),
+  m_strSaveDirectory(strSaveDirectory),
+  m_nextSRAMCheckMs(0),
+  m_bStarted(false),
+  m_bSRAMWriteFailed(false),
+  m_pool(MAX_POOLED_SAVES)
+{
+}
+
+CAutoSave::~CAutoSave(void)
+{
+  StopThread(-1);
+  m_workEvent.Signal();
+  StopThread();
+}
+
+bool CAutoSave::Start(const std::string& strContentPath)
+{
+  if (m_bStarted)
+    Stop();
+
+  m_strStatePath = PathUtils::GetSavePath(m_strSaveDirectory, strContentPath, STATE_EXTENSION);
+  m_strSRAMPath = PathUtils::GetSavePath(m_strSaveDirectory, strContentPath, SRAM_EXTENSION);
+  m_nextSRAMCheckMs = GetTimeMs() + SRAM_CHECK_INTERVAL_MS;
+  m_sramShadow.reset();
+  m_bSRAMWriteFailed = false;
+
+  // Don't save the save RAM that the game just loaded
+  const uint8_t* data = NULL;
+  size_t size = 0;
+  if (m_game->GetMemory(GAME_MEMORY_SAVE_RAM, &data, &size) == GAME_ERROR_NO_ERROR && data != NULL && size > 0)
+  {
+    if (m_pool.Reserve(m_sramShadow, size))
+      std::memcpy(m_sramShadow->data, data, size);
+  }
+
+  if (!CreateThread(false))
+  {
+    esyslog("Failed to start autosave thread");
+    return false;
+  }
+
+  m_bStarted = true;
+
+  dsyslog("Autosaving to %s", m_strSRAMPath.c_str());
+
+  return true;
+}
+
+void CAutoSave::Stop(void)
+{
+  if (!m_bStarted)
+    return;
+
+  SaveSRAM();
+  SaveState();
+
+  // Process() writes what is still pending before it returns
+  StopThread(-1);
+  m_workEvent.Signal();
+  StopThread();
+
+  // There is no later check to retry at, so try once more now
+  if (m_bSRAMWriteFailed.exchange(false) && m_sramShadow)
+  {
+    if (!WriteAtomic(m_strSRAMPath, *m_sramShadow))
+      esyslog("Failed to save %s, save RAM changes are lost", m_strSRAMPath.c_str());
+  }
+
+  m_bStarted = false;
+}
+
+void CAutoSave::FrameEvent(void)
+{
+  if (!m_bStarted)
+    return;
+
+  const int64_t now = GetTimeMs();
+  if (now < m_nextSRAMCheckMs)
+    return;
+
+  m_nextSRAMCheckMs = now + SRAM_CHECK_INTERVAL_MS;
+
+  SaveSRAM();
+}
+
+bool CAutoSave::SaveState(void)
+{
+  if (!m_bStarted)
+    return false;
+
+  StatePtr state;
+  if (m_game->SerializeState(m_pool, state) != GAME_ERROR_NO_ERROR)
+    return false;
+
+  Queue(SAVE_TYPE_STATE, std::move(state), m_strStatePath);
+
+  return true;
+}
+
+bool CAutoSave::SaveSRAM(void)
+{
+  if (!m_bStarted)
+    return false;
+
+  const uint8_t* data = NULL;
+  size_t size = 0;
+  if (m_game->GetMemory(GAME_MEMORY_SAVE_RAM, &data, &size) != GAME_ERROR_NO_ERROR || data == NULL || size == 0)
+    return false;
+
+  // The shadow was updated when the failed write was queued
+  if (m_bSRAMWriteFailed.exchange(false))
+    m_sramShadow.reset();
+
+  // Most games only touch save RAM when the player saves
+  if (m_sramShadow && m_sramShadow->size == size && std::memcmp(m_sramShadow->data, data, size) == 0)
+    return true;
+
+  StatePtr sram = m_pool.Acquire(size);
+  if (!sram || !m_pool.Reserve(m_sramShadow, size))
+    return false;
+
+  std::memcpy(sram->data, data, size);
+  std::memcpy(m_sramShadow->data, data, size);
+
+  Queue(SAVE_TYPE_SRAM, std::move(sram), m_strSRAMPath);
+
+  return true;
+}
+
+void CAutoSave::Queue(SAVE_TYPE type, StatePtr buffer, const std::string& strPath)
+{
+  StatePtr stale; // Returned to the pool outside the lock
+  {
+    CLockObject lock(m_pendingMutex);
+
+    // Replace a save that hasn't been written yet
+    stale = std::move(m_pending[type].buffer);
+    m_pending[type].buffer = std::move(buffer);
+    m_pending[type].strPath = strPath;
+  }
+
+  m_workEvent.Signal();
+}
+
+void* CAutoSave::Process(void)
+{
+  while (!IsStopped())
+  {
+    m_workEvent.Wait();
+    WritePending();
+  }
+
+  WritePending();
+
+  return NULL;
+}
+
+void CAutoSave::WritePending(void)
+{
+  for (unsigned int type = 0; type < SAVE_TYPE_COUNT; type++)
+  {
+    SaveJob job;
+    {
+      CLockObject lock(m_pendingMutex);
+      job.buffer = std::move(m_pending[type].buffer);
+      job.strPath = m_pending[type].strPath;
+    }
+
+    if (job.buffer && !WriteAtomic(job.strPath, *job.buffer))
+    {
+      esyslog("Failed to save %s", job.strPath.c_str());
+      if (type == SAVE_TYPE_SRAM)
+        m_bSRAMWriteFailed = true;
+    }
+  }
+}
+
+bool CAutoSave::WriteAtomic(const std::string& strPath, const StateBuffer& buffer)
+{
+  const std::string strTempPath = strPath + TEMP_EXTENSION;
+
+#if defined(_WIN32)
+  int fd = _open(strTempPath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  int fd = open(strTempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+  if (fd < 0)
+    return false;
+
+  bool bSuccess = true;
+
+  size_t written = 0;
+  while (bSuccess && written < buffer.size)
+  {
+#if defined(_WIN32)
+    const int result = _write(fd, buffer.data + written, static_cast<unsigned int>(buffer.size - written));
+#else
+    const ssize_t result = write(fd, buffer.data + written, buffer.size - written);
+#endif
+    if (result <= 0)
+      bSuccess = false;
+    else
+      written += result;
+  }
+
+  // The data must be on disk before the rename makes it the current save
+#if defined(_WIN32)
+  if (bSuccess && _commit(fd) != 0)
+    bSuccess = false;
+  _close(fd);
+#else
+  if (bSuccess && fsync(fd) != 0)
+    bSuccess = false;
+  close(fd);
+#endif
+
+  if (bSuccess)
+  {
+#if defined(_WIN32)
+    bSuccess = MoveFileEx(strTempPath.c_str(), strPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bSuccess = rename(strTempPath.c_str(), strPath.c_str()) == 0;
+
+    // Make the rename itself durable
+    if (bSuccess)
+    {
+      int dirFd = open(PathUtils::GetParentDirectory(strPath).c_str(), O_RDONLY);
+      if (dirFd >= 0)
+      {
+        fsync(dirFd);
+        close(dirFd);
+      }
+    }
+#endif
+  }
+
+  if (!bSuccess)
+    remove(strTempPath.c_str());
+
+  return bSuccess;
+}
@@ -0,0 +1,117 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "interface/StatePool.h"
+
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  class IGame;
+
+  /*!
+   * \brief Persists save RAM and savestates to the save directory without
+   *        blocking the emulation thread on disk I/O
+   *
+   * The emulation thread only copies the data into a pooled buffer. Writes
+   * happen on a background thread: each file is written to a temporary file,
+   * flushed to disk and renamed over the old one, so a crash never leaves a
+   * truncated save behind.
+   *
+   * Only the newest copy of each file is kept. If the disk falls behind, an
+   * older pending save is replaced instead of queueing up. A failed save RAM
+   * write is retried at the next check even if save RAM hasn't changed.
+   */
+  class CAutoSave : public PLATFORM::CThread
+  {
+  public:
+    CAutoSave(IGame* game, const std::string& strSaveDirectory);
+    virtual ~CAutoSave(void);
+
+    /*!
+     * \brief Start saving for the loaded content
+     */
+    bool Start(const std::string& strContentPath);
+
+    /*!
+     * \brief Save the state and save RAM one last time and wait for the writes
+     *
+     * Must be called from the emulation thread before the game is unloaded.
+     */
+    void Stop(void);
+
+    /*!
+     * \brief Check save RAM for changes, called after each frame
+     */
+    void FrameEvent(void);
+
+    /*!
+     * \brief Capture now and write in the background, emulation thread only
+     */
+    bool SaveState(void);
+    bool SaveSRAM(void);
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    enum SAVE_TYPE
+    {
+      SAVE_TYPE_STATE,
+      SAVE_TYPE_SRAM,
+      SAVE_TYPE_COUNT,
+    };
+
+    struct SaveJob
+    {
+      StatePtr    buffer;
+      std::string strPath;
+    };
+
+    void Queue(SAVE_TYPE type, StatePtr buffer, const std::string& strPath);
+    void WritePending(void);
+
+    static bool WriteAtomic(const std::string& strPath, const StateBuffer& buffer);
+
+    IGame* const      m_game;
+    const std::string m_strSaveDirectory;
+
+    // Emulation thread
+    std::string       m_strStatePath;
+    std::string       m_strSRAMPath;
+    StatePtr          m_sramShadow;      // Save RAM as of the last queued save
+    int64_t           m_nextSRAMCheckMs;
+    bool              m_bStarted;
+
+    std::atomic<bool> m_bSRAMWriteFailed; // Set by the I/O thread
+
+    CStatePool        m_pool;
+    SaveJob           m_pending[SAVE_TYPE_COUNT];
+    PLATFORM::CMutex  m_pendingMutex;
+    PLATFORM::CEvent  m_workEvent;
+  };
+}
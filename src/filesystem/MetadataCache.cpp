@@ -0,0 +1,193 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MetadataCache.h"
+
+#include "platform/util/timeutils.h"
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define METADATA_TTL_MS       5000  // Long enough to cover a core's startup probes
+#define MAX_METADATA_ENTRIES  1024
+
+template <typename T>
+bool CMetadataCache::Get(const std::string& strPath, CachedValue<T> MetadataEntry::*field, T& value)
+{
+  CLockObject lock(m_mutex);
+
+  std::map<std::string, MetadataEntry>::const_iterator it = m_entries.find(strPath);
+  if (it == m_entries.end())
+    return false;
+
+  const CachedValue<T>& cached = it->second.*field;
+  if (cached.expiresMs == 0 || cached.expiresMs <= GetTimeMs())
+    return false;
+
+  value = cached.value;
+  return true;
+}
+
+bool CMetadataCache::GetExists(const std::string& strPath, bool& bExists)
+{
+  return Get(strPath, &MetadataEntry::exists, bExists);
+}
+
+bool CMetadataCache::GetStat(const std::string& strPath, bool& bSuccess, STAT_STRUCTURE& buffer)
+{
+  StatResult result;
+  if (!Get(strPath, &MetadataEntry::stat, result))
+    return false;
+
+  bSuccess = result.bSuccess;
+  if (bSuccess)
+    buffer = result.buffer;
+
+  return true;
+}
+
+bool CMetadataCache::GetDirectoryExists(const std::string& strPath, bool& bExists)
+{
+  return Get(strPath, &MetadataEntry::directoryExists, bExists);
+}
+
+uint64_t CMetadataCache::Generation(void)
+{
+  CLockObject lock(m_mutex);
+  return m_generation;
+}
+
+void CMetadataCache::SetExists(const std::string& strPath, bool bExists, uint64_t generation)
+{
+  CLockObject lock(m_mutex);
+
+  if (generation != m_generation)
+    return;
+
+  const int64_t now = GetTimeMs();
+  MetadataEntry& entry = GetEntry(strPath, now);
+
+  entry.exists.value = bExists;
+  entry.exists.expiresMs = now + METADATA_TTL_MS;
+}
+
+void CMetadataCache::SetStat(const std::string& strPath, bool bSuccess, const STAT_STRUCTURE& buffer, uint64_t generation)
+{
+  CLockObject lock(m_mutex);
+
+  if (generation != m_generation)
+    return;
+
+  const int64_t now = GetTimeMs();
+  MetadataEntry& entry = GetEntry(strPath, now);
+
+  entry.stat.value.bSuccess = bSuccess;
+  entry.stat.value.buffer = buffer;
+  entry.stat.expiresMs = now + METADATA_TTL_MS;
+
+  // A stat also answers the existence questions
+  entry.exists.value = bSuccess && !buffer.isDirectory;
+  entry.exists.expiresMs = now + METADATA_TTL_MS;
+  entry.directoryExists.value = bSuccess && buffer.isDirectory;
+  entry.directoryExists.expiresMs = now + METADATA_TTL_MS;
+}
+
+void CMetadataCache::SetDirectoryExists(const std::string& strPath, bool bExists, uint64_t generation)
+{
+  CLockObject lock(m_mutex);
+
+  if (generation != m_generation)
+    return;
+
+  const int64_t now = GetTimeMs();
+  MetadataEntry& entry = GetEntry(strPath, now);
+
+  entry.directoryExists.value = bExists;
+  entry.directoryExists.expiresMs = now + METADATA_TTL_MS;
+}
+
+void CMetadataCache::Invalidate(const std::string& strPath)
+{
+  CLockObject lock(m_mutex);
+
+  m_generation++;
+  Erase(strPath);
+  Erase(GetParentDirectory(strPath));
+}
+
+void CMetadataCache::Clear(void)
+{
+  CLockObject lock(m_mutex);
+  m_generation++;
+  m_entries.clear();
+}
+
+CMetadataCache::MetadataEntry& CMetadataCache::GetEntry(const std::string& strPath, int64_t now)
+{
+  if (m_entries.size() >= MAX_METADATA_ENTRIES && m_entries.find(strPath) == m_entries.end())
+  {
+    // Evict entries where nothing is cached anymore
+    for (std::map<std::string, MetadataEntry>::iterator it = m_entries.begin(); it != m_entries.end(); )
+    {
+      const MetadataEntry& entry = it->second;
+      if (entry.exists.expiresMs <= now && entry.stat.expiresMs <= now && entry.directoryExists.expiresMs <= now)
+        m_entries.erase(it++);
+      else
+        ++it;
+    }
+
+    if (m_entries.size() >= MAX_METADATA_ENTRIES)
+      m_entries.clear();
+  }
+
+  return m_entries[strPath];
+}
+
+void CMetadataCache::Erase(const std::string& strPath)
+{
+  if (strPath.empty())
+    return;
+
+  // Directories may be probed with or without a trailing separator
+  std::string strTrimmed = strPath;
+  while (strTrimmed.size() > 1 && IsSeparator(strTrimmed[strTrimmed.size() - 1]))
+    strTrimmed.erase(strTrimmed.size() - 1);
+
+  m_entries.erase(strTrimmed);
+  m_entries.erase(strTrimmed + "/");
+  m_entries.erase(strTrimmed + "\\");
+}
+
+std::string CMetadataCache::GetParentDirectory(const std::string& strPath)
+{
+  // Ignore a trailing separator on directory paths
+  size_t end = strPath.size();
+  while (end > 1 && IsSeparator(strPath[end - 1]))
+    end--;
+
+  if (end <= 1)
+    return "";
+
+  const size_t pos = strPath.find_last_of("/\\", end - 1);
+  if (pos == std::string::npos)
+    return "";
+
+  return strPath.substr(0, pos + 1);
+}
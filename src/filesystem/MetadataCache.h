@@ -0,0 +1,118 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "StatStructure.h"
+
+#include "platform/threads/mutex.h"
+
+#include <map>
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Short-lived cache of file metadata, keyed by path
+   *
+   * Cores probe for BIOS and system files many times while loading, and each
+   * probe travels through several layers to the frontend. Results are kept
+   * for a few seconds, including negative results, and dropped when the
+   * path (or its parent directory) is modified through us.
+   *
+   * A lookup can race with a modification: the frontend answers before the
+   * change, the change invalidates the path, and then the lookup stores its
+   * stale answer. To prevent this, every invalidation bumps a generation.
+   * Lookups take the generation before asking the frontend, and the result
+   * is only stored if no invalidation happened in between.
+   */
+  class CMetadataCache
+  {
+  public:
+    CMetadataCache(void) : m_generation(0) { }
+
+    /*!
+     * \return false if the result isn't cached
+     */
+    bool GetExists(const std::string& strPath, bool& bExists);
+    bool GetStat(const std::string& strPath, bool& bSuccess, STAT_STRUCTURE& buffer);
+    bool GetDirectoryExists(const std::string& strPath, bool& bExists);
+
+    /*!
+     * \brief Take before asking the frontend, pass to the Set*() call
+     */
+    uint64_t Generation(void);
+
+    /*!
+     * \brief Store a result, unless the cache was invalidated since
+     *        generation was taken
+     */
+    void SetExists(const std::string& strPath, bool bExists, uint64_t generation);
+    void SetStat(const std::string& strPath, bool bSuccess, const STAT_STRUCTURE& buffer, uint64_t generation);
+    void SetDirectoryExists(const std::string& strPath, bool bExists, uint64_t generation);
+
+    /*!
+     * \brief Forget a path that was modified, and its parent directory
+     */
+    void Invalidate(const std::string& strPath);
+
+    void Clear(void);
+
+  private:
+    template <typename T>
+    struct CachedValue
+    {
+      CachedValue(void) : expiresMs(0), value() { }
+
+      int64_t expiresMs; // 0 if not cached
+      T       value;
+    };
+
+    struct StatResult
+    {
+      bool           bSuccess;
+      STAT_STRUCTURE buffer;
+    };
+
+    struct MetadataEntry
+    {
+      CachedValue<bool>       exists;
+      CachedValue<StatResult> stat;
+      CachedValue<bool>       directoryExists;
+    };
+
+    template <typename T>
+    bool Get(const std::string& strPath, CachedValue<T> MetadataEntry::*field, T& value);
+
+    MetadataEntry& GetEntry(const std::string& strPath, int64_t now);
+
+    /*!
+     * \brief Erase a path, with and without a trailing separator
+     */
+    void Erase(const std::string& strPath);
+
+    static std::string GetParentDirectory(const std::string& strPath);
+    static bool IsSeparator(char c) { return c == '/' || c == '\\'; }
+
+    std::map<std::string, MetadataEntry> m_entries;
+    uint64_t                             m_generation; // Incremented by every invalidation
+    PLATFORM::CMutex                     m_mutex;
+  };
+}
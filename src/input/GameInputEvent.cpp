@@ -0,0 +1,227 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "GameInputEvent.h"
+
+#include "game.pb.h"
+
+#include <cstring>
+
+using namespace NETPLAY;
+
+CGameInputEvent::CGameInputEvent(void)
+{
+  std::memset(&m_event, 0, sizeof(m_event));
+  UpdatePointers();
+}
+
+CGameInputEvent::CGameInputEvent(const game_input_event& event) :
+  m_event(event),
+  m_strControllerId(event.controller_id ? event.controller_id : ""),
+  m_strFeatureName(event.feature_name ? event.feature_name : "")
+{
+  UpdatePointers();
+}
+
+CGameInputEvent::CGameInputEvent(const CGameInputEvent& other) :
+  m_event(other.m_event),
+  m_strControllerId(other.m_strControllerId),
+  m_strFeatureName(other.m_strFeatureName)
+{
+  UpdatePointers();
+}
+
+CGameInputEvent& CGameInputEvent::operator=(const CGameInputEvent& rhs)
+{
+  if (this != &rhs)
+  {
+    m_event           = rhs.m_event;
+    m_strControllerId = rhs.m_strControllerId;
+    m_strFeatureName  = rhs.m_strFeatureName;
+    UpdatePointers();
+  }
+  return *this;
+}
+
+CGameInputEvent& CGameInputEvent::operator=(const game_input_event& event)
+{
+  m_event = event;
+  m_strControllerId.assign(event.controller_id ? event.controller_id : "");
+  m_strFeatureName.assign(event.feature_name ? event.feature_name : "");
+  UpdatePointers();
+  return *this;
+}
+
+size_t CGameInputEvent::Serialize(uint8_t* data, size_t size) const
+{
+  const uint32_t controllerLength = m_strControllerId.length();
+  const uint32_t featureLength    = m_strFeatureName.length();
+
+  const size_t total = sizeof(m_event) +
+                       sizeof(controllerLength) + controllerLength +
+                       sizeof(featureLength) + featureLength;
+
+  if (data == NULL || size < total)
+    return 0;
+
+  std::memcpy(data, &m_event, sizeof(m_event));
+  data += sizeof(m_event);
+
+  std::memcpy(data, &controllerLength, sizeof(controllerLength));
+  data += sizeof(controllerLength);
+  std::memcpy(data, m_strControllerId.c_str(), controllerLength);
+  data += controllerLength;
+
+  std::memcpy(data, &featureLength, sizeof(featureLength));
+  data += sizeof(featureLength);
+  std::memcpy(data, m_strFeatureName.c_str(), featureLength);
+
+  return total;
+}
+
+bool CGameInputEvent::Deserialize(const uint8_t* data, size_t size)
+{
+  const uint8_t* const end = data + size;
+
+  uint32_t controllerLength;
+  uint32_t featureLength;
+
+  if (data == NULL || size < sizeof(m_event) + sizeof(controllerLength))
+    return false;
+
+  std::memcpy(&m_event, data, sizeof(m_event));
+  data += sizeof(m_event);
+
+  std::memcpy(&controllerLength, data, sizeof(controllerLength));
+  data += sizeof(controllerLength);
+  if (static_cast<size_t>(end - data) < controllerLength + sizeof(featureLength))
+    return false;
+  m_strControllerId.assign(reinterpret_cast<const char*>(data), controllerLength);
+  data += controllerLength;
+
+  std::memcpy(&featureLength, data, sizeof(featureLength));
+  data += sizeof(featureLength);
+  if (static_cast<size_t>(end - data) < featureLength)
+    return false;
+  m_strFeatureName.assign(reinterpret_cast<const char*>(data), featureLength);
+
+  UpdatePointers();
+
+  return true;
+}
+
+void CGameInputEvent::ToMessage(game::game_input_event& msg) const
+{
+  msg.set_type(m_event.type);
+  msg.set_port(m_event.port);
+  msg.set_controller_id(m_strControllerId);
+  msg.set_feature_name(m_strFeatureName);
+
+  switch (m_event.type)
+  {
+    case GAME_INPUT_EVENT_DIGITAL_BUTTON:
+      msg.mutable_digital_button()->set_pressed(m_event.digital_button.pressed);
+      break;
+    case GAME_INPUT_EVENT_ANALOG_BUTTON:
+      msg.mutable_analog_button()->set_magnitude(m_event.analog_button.magnitude);
+      break;
+    case GAME_INPUT_EVENT_ANALOG_STICK:
+      msg.mutable_analog_stick()->set_x(m_event.analog_stick.x);
+      msg.mutable_analog_stick()->set_y(m_event.analog_stick.y);
+      break;
+    case GAME_INPUT_EVENT_ACCELEROMETER:
+      msg.mutable_accelerometer()->set_x(m_event.accelerometer.x);
+      msg.mutable_accelerometer()->set_y(m_event.accelerometer.y);
+      msg.mutable_accelerometer()->set_z(m_event.accelerometer.z);
+      break;
+    case GAME_INPUT_EVENT_KEY:
+      msg.mutable_key()->set_pressed(m_event.key.pressed);
+      msg.mutable_key()->set_character(m_event.key.character);
+      msg.mutable_key()->set_modifiers(m_event.key.modifiers);
+      break;
+    case GAME_INPUT_EVENT_RELATIVE_POINTER:
+      msg.mutable_rel_pointer()->set_x(m_event.rel_pointer.x);
+      msg.mutable_rel_pointer()->set_y(m_event.rel_pointer.y);
+      break;
+    case GAME_INPUT_EVENT_ABSOLUTE_POINTER:
+      msg.mutable_abs_pointer()->set_pressed(m_event.abs_pointer.pressed);
+      msg.mutable_abs_pointer()->set_x(m_event.abs_pointer.x);
+      msg.mutable_abs_pointer()->set_y(m_event.abs_pointer.y);
+      break;
+    default:
+      break;
+  }
+}
+
+bool CGameInputEvent::FromMessage(const game::game_input_event& msg)
+{
+  std::memset(&m_event, 0, sizeof(m_event));
+
+  m_event.type = static_cast<GAME_INPUT_EVENT_SOURCE>(msg.type());
+  m_event.port = msg.port();
+  m_strControllerId = msg.controller_id();
+  m_strFeatureName = msg.feature_name();
+
+  switch (msg.input_event_case())
+  {
+    case game::game_input_event::kDigitalButton:
+      m_event.digital_button.pressed = msg.digital_button().pressed();
+      break;
+    case game::game_input_event::kAnalogButton:
+      m_event.analog_button.magnitude = msg.analog_button().magnitude();
+      break;
+    case game::game_input_event::kAnalogStick:
+      m_event.analog_stick.x = msg.analog_stick().x();
+      m_event.analog_stick.y = msg.analog_stick().y();
+      break;
+    case game::game_input_event::kAccelerometer:
+      m_event.accelerometer.x = msg.accelerometer().x();
+      m_event.accelerometer.y = msg.accelerometer().y();
+      m_event.accelerometer.z = msg.accelerometer().z();
+      break;
+    case game::game_input_event::kKey:
+      m_event.key.pressed = msg.key().pressed();
+      m_event.key.character = msg.key().character();
+      m_event.key.modifiers = msg.key().modifiers();
+      break;
+    case game::game_input_event::kRelPointer:
+      m_event.rel_pointer.x = msg.rel_pointer().x();
+      m_event.rel_pointer.y = msg.rel_pointer().y();
+      break;
+    case game::game_input_event::kAbsPointer:
+      m_event.abs_pointer.pressed = msg.abs_pointer().pressed();
+      m_event.abs_pointer.x = msg.abs_pointer().x();
+      m_event.abs_pointer.y = msg.abs_pointer().y();
+      break;
+    default:
+      UpdatePointers();
+      return false;
+  }
+
+  UpdatePointers();
+
+  return true;
+}
+
+void CGameInputEvent::UpdatePointers(void)
+{
+  m_event.controller_id = m_strControllerId.c_str();
+  m_event.feature_name  = m_strFeatureName.c_str();
+}
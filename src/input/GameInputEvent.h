@@ -0,0 +1,82 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace game
+{
+  class game_input_event;
+}
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Owning copy of a game_input_event
+   *
+   * game_input_event borrows its controller and feature strings from the
+   * caller. This class keeps its own copy of the strings so that the event
+   * can outlive the call that produced it.
+   */
+  class CGameInputEvent
+  {
+  public:
+    CGameInputEvent(void);
+    CGameInputEvent(const game_input_event& event);
+    CGameInputEvent(const CGameInputEvent& other);
+
+    CGameInputEvent& operator=(const CGameInputEvent& rhs);
+
+    /*!
+     * \brief Copy an event, reusing the memory of the strings held so far
+     */
+    CGameInputEvent& operator=(const game_input_event& event);
+
+    const game_input_event& Get(void) const { return m_event; }
+
+    /*!
+     * \brief Pack the event into a flat buffer (for same-host transport only)
+     * \return The number of bytes written, or 0 if the buffer is too small
+     */
+    size_t Serialize(uint8_t* data, size_t size) const;
+
+    /*!
+     * \brief Unpack an event written by Serialize()
+     */
+    bool Deserialize(const uint8_t* data, size_t size);
+
+    /*!
+     * \brief Convert to and from the protobuf message sent between peers
+     */
+    void ToMessage(game::game_input_event& msg) const;
+    bool FromMessage(const game::game_input_event& msg);
+
+  private:
+    void UpdatePointers(void);
+
+    game_input_event m_event;
+    std::string      m_strControllerId;
+    std::string      m_strFeatureName;
+  };
+}
@@ -0,0 +1,128 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "InputStaging.h"
+#include "interface/IGame.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+using namespace NETPLAY;
+
+CInputStaging::CInputStaging(void) :
+  m_cells(INPUT_STAGING_CAPACITY),
+  m_enqueuePos(0),
+  m_dequeuePos(0)
+{
+  for (size_t i = 0; i < m_cells.size(); i++)
+    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+CInputStaging::~CInputStaging(void)
+{
+}
+
+bool CInputStaging::Stage(unsigned int port, const game_input_event& event)
+{
+  const size_t mask = m_cells.size() - 1;
+
+  Cell* cell;
+  size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+  while (true)
+  {
+    cell = &m_cells[pos & mask];
+
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+    if (diff == 0)
+    {
+      // The cell is free, claim the position
+      if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+        break;
+    }
+    else if (diff < 0)
+    {
+      return false; // The consumer hasn't freed this cell yet
+    }
+    else
+    {
+      pos = m_enqueuePos.load(std::memory_order_relaxed); // Another producer claimed it
+    }
+  }
+
+  cell->input.port = port;
+  cell->input.event = event;
+  cell->sequence.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+bool CInputStaging::Pop(StagedInput* input)
+{
+  const size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+  Cell& cell = m_cells[pos & (m_cells.size() - 1)];
+
+  // Empty, or a producer is still filling the cell
+  if (cell.sequence.load(std::memory_order_acquire) != pos + 1)
+    return false;
+
+  if (input)
+    *input = cell.input;
+
+  cell.sequence.store(pos + m_cells.size(), std::memory_order_release);
+  m_dequeuePos.store(pos + 1, std::memory_order_release);
+
+  return true;
+}
+
+void CInputStaging::Drain(std::vector<StagedInput>& inputs)
+{
+  StagedInput input;
+  while (Pop(&input))
+    inputs.push_back(input);
+}
+
+void CInputStaging::Clear(void)
+{
+  while (Pop(NULL)) { }
+}
+
+unsigned int CInputStaging::Apply(IGame* game, const std::vector<StagedInput>& inputs)
+{
+  unsigned int handled = 0;
+
+  for (size_t begin = 0; begin < inputs.size(); )
+  {
+    const unsigned int port = inputs[begin].port;
+
+    m_batch.clear();
+
+    size_t end = begin;
+    for ( ; end < inputs.size() && inputs[end].port == port; end++)
+      m_batch.push_back(inputs[end].event.Get());
+
+    handled += game->InputEvents(port, m_batch.data(), m_batch.size());
+
+    begin = end;
+  }
+
+  return handled;
+}
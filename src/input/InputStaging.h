@@ -0,0 +1,108 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "GameInputEvent.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+#define INPUT_STAGING_CAPACITY  256 // Events staged between two frames, must be a power of 2
+
+namespace NETPLAY
+{
+  class IGame;
+
+  struct StagedInput
+  {
+    unsigned int    port;
+    CGameInputEvent event;
+  };
+
+  /*!
+   * \brief Input waiting to be applied before the next frame
+   *
+   * Any number of threads (typically network receive threads) can stage
+   * input without taking a lock or waiting for the frame in progress. The
+   * emulation thread drains everything staged so far and applies it in as
+   * few calls as possible, right before running the frame.
+   *
+   * Events go through a bounded ring of preallocated cells. Each cell has a
+   * sequence number that tells producers and the consumer whose turn it is.
+   * Cells keep their string memory, so staging doesn't allocate once the
+   * ring has warmed up.
+   */
+  class CInputStaging
+  {
+  public:
+    CInputStaging(void);
+    ~CInputStaging(void);
+
+    /*!
+     * \brief Queue an event, safe to call from any thread
+     * \return false if the ring is full and the event was dropped
+     */
+    bool Stage(unsigned int port, const game_input_event& event);
+
+    /*!
+     * \brief Move everything staged so far to the end of inputs, in the order
+     *        it was staged. Consumer thread only.
+     */
+    void Drain(std::vector<StagedInput>& inputs);
+
+    /*!
+     * \brief Discard everything staged so far. Consumer thread only.
+     */
+    void Clear(void);
+
+    /*!
+     * \brief True if nothing is staged, safe to call from any thread
+     *
+     * An event that a producer is still copying counts as staged.
+     */
+    bool IsEmpty(void) const { return m_enqueuePos.load() == m_dequeuePos.load(); }
+
+    /*!
+     * \brief Apply inputs with one InputEvents() call per run of events for
+     *        the same port. Consumer thread only.
+     *
+     * \return The number of events the game client handled
+     */
+    unsigned int Apply(IGame* game, const std::vector<StagedInput>& inputs);
+
+  private:
+    struct Cell
+    {
+      std::atomic<size_t> sequence; // Position + 1 once filled, + capacity once free again
+      StagedInput         input;
+    };
+
+    /*!
+     * \brief Take the oldest event, consumer thread only
+     */
+    bool Pop(StagedInput* input);
+
+    std::vector<Cell>             m_cells;
+    std::atomic<size_t>           m_enqueuePos; // Next position claimed by a producer
+    std::atomic<size_t>           m_dequeuePos; // Next position read, written by the consumer only
+    std::vector<game_input_event> m_batch;      // Reused by Apply()
+  };
+}
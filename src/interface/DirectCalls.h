@@ -0,0 +1,176 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+
+#include <atomic>
+#include <chrono>
+#include <stddef.h>
+#include <stdint.h>
+#include <thread>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Lets callers skip the layers in front of the game client while
+   *        none of them needs to see the calls
+   *
+   * The layer that owns the gate opens it while it has nothing to do, and
+   * closes it before it does. Closing waits for direct calls in progress, so
+   * on return every call goes through the layer again.
+   */
+  class CDirectCallGate
+  {
+  public:
+    CDirectCallGate(void) : m_bOpen(false), m_activeCalls(0) { }
+
+    /*!
+     * \return false if the call must go through the layers
+     */
+    bool Enter(void)
+    {
+      // Count the call before checking the gate, Close() does the opposite
+      m_activeCalls++;
+      if (m_bOpen)
+        return true;
+
+      m_activeCalls--;
+      return false;
+    }
+
+    void Leave(void) { m_activeCalls--; }
+
+    void Open(void) { m_bOpen = true; }
+
+    /*!
+     * \brief Must not be called from within a direct call
+     */
+    void Close(void)
+    {
+      if (!m_bOpen.exchange(false))
+        return;
+
+      while (m_activeCalls != 0)
+        std::this_thread::yield();
+    }
+
+    bool IsOpen(void) const { return m_bOpen; }
+
+  private:
+    std::atomic<bool>         m_bOpen;
+    std::atomic<unsigned int> m_activeCalls;
+  };
+
+  enum DIRECT_CALL
+  {
+    DIRECT_CALL_FRAME_EVENT,
+    DIRECT_CALL_INPUT_EVENT,
+    DIRECT_CALL_SERIALIZE,
+    DIRECT_CALL_DESERIALIZE,
+    DIRECT_CALL_GET_MEMORY,
+    DIRECT_CALL_COUNT
+  };
+
+  /*!
+   * \brief Implemented by the layer that owns the entry points
+   *
+   * The owner keeps the entry points valid between BeginDirectCall() and
+   * EndDirectCall(), exactly as it does for calls that go through it, and
+   * records the call in its statistics.
+   */
+  class IDirectCallOwner
+  {
+  public:
+    virtual ~IDirectCallOwner(void) { }
+
+    /*!
+     * \return false if the entry points may no longer be called
+     */
+    virtual bool BeginDirectCall(void) = 0;
+
+    /*!
+     * \brief Called once for every successful BeginDirectCall()
+     */
+    virtual void EndDirectCall(DIRECT_CALL call, uint64_t elapsedNs) = 0;
+  };
+
+  /*!
+   * \brief Entry points of the game client at the end of the chain, for the
+   *        calls made every frame
+   */
+  struct GameDirectCalls
+  {
+    void       (*FrameEvent)(void);
+    bool       (*InputEvent)(unsigned int port, const game_input_event* event);
+    GAME_ERROR (*Serialize)(uint8_t* data, size_t size);
+    GAME_ERROR (*Deserialize)(const uint8_t* data, size_t size);
+    GAME_ERROR (*GetMemory)(GAME_MEMORY type, const uint8_t** data, size_t* size);
+    IDirectCallOwner* owner; // Owner of the entry points
+    CDirectCallGate*  gate;  // NULL if no layer can ever need to see the calls
+  };
+
+  /*!
+   * \brief Holds the gate and the owner for the duration of a direct call
+   */
+  class CDirectCall
+  {
+  public:
+    CDirectCall(const GameDirectCalls& calls, DIRECT_CALL call) :
+      m_calls(calls),
+      m_call(call),
+      m_bDirect(false)
+    {
+      if (m_calls.owner == NULL || (m_calls.gate != NULL && !m_calls.gate->Enter()))
+        return;
+
+      if (!m_calls.owner->BeginDirectCall())
+      {
+        // Let the layers report the failure
+        if (m_calls.gate != NULL)
+          m_calls.gate->Leave();
+        return;
+      }
+
+      m_bDirect = true;
+      m_start = std::chrono::steady_clock::now();
+    }
+
+    ~CDirectCall(void)
+    {
+      if (!m_bDirect)
+        return;
+
+      const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+      m_calls.owner->EndDirectCall(m_call, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+      if (m_calls.gate != NULL)
+        m_calls.gate->Leave();
+    }
+
+    bool IsDirect(void) const { return m_bDirect; }
+
+  private:
+    const GameDirectCalls&                m_calls;
+    const DIRECT_CALL                     m_call;
+    bool                                  m_bDirect;
+    std::chrono::steady_clock::time_point m_start;
+  };
+}
@@ -0,0 +1,88 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FramePool.h"
+
+#include <cstring>
+#include <functional>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define MAX_FREE_BUFFERS  8 // Enough for a few frames in flight per frontend
+
+CFramePool::FreeList::~FreeList(void)
+{
+  for (std::vector<FrameBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+    delete *it;
+}
+
+CFramePool::CFramePool(void) :
+  m_freeList(std::make_shared<FreeList>())
+{
+}
+
+std::shared_ptr<FrameBuffer> CFramePool::Acquire(const uint8_t* data, size_t size)
+{
+  FrameBuffer* buffer = NULL;
+  {
+    CLockObject lock(m_freeList->mutex);
+
+    // Prefer the most recently released buffer, it's likely the right size
+    if (!m_freeList->buffers.empty())
+    {
+      buffer = m_freeList->buffers.back();
+      m_freeList->buffers.pop_back();
+    }
+  }
+
+  if (buffer == NULL)
+    buffer = new FrameBuffer;
+
+  buffer->data.resize(size);
+  if (size > 0)
+    std::memcpy(buffer->data.data(), data, size);
+
+  buffer->width = 0;
+  buffer->height = 0;
+  buffer->renderFormat = GAME_RENDER_FMT_NONE;
+  buffer->frames = 0;
+  buffer->audioFormat = GAME_AUDIO_FMT_UNKNOWN;
+  buffer->frameNumber = 0;
+  buffer->timestampMs = 0;
+
+  // The deleter keeps the free list alive, so buffers may outlive the pool
+  return std::shared_ptr<FrameBuffer>(buffer, std::bind(&CFramePool::Release, m_freeList, std::placeholders::_1));
+}
+
+void CFramePool::Release(const std::shared_ptr<FreeList>& freeList, FrameBuffer* buffer)
+{
+  {
+    CLockObject lock(freeList->mutex);
+
+    if (freeList->buffers.size() < MAX_FREE_BUFFERS)
+    {
+      freeList->buffers.push_back(buffer);
+      return;
+    }
+  }
+
+  delete buffer;
+}
@@ -0,0 +1,90 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+#include "platform/threads/mutex.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief A video frame or audio packet produced by the game
+   */
+  struct FrameBuffer
+  {
+    std::vector<uint8_t> data;         // Capacity is kept when the buffer is reused
+
+    // Video
+    unsigned int         width;
+    unsigned int         height;
+    GAME_RENDER_FORMAT   renderFormat;
+
+    // Audio
+    unsigned int         frames;
+    GAME_AUDIO_FORMAT    audioFormat;
+
+    uint64_t             frameNumber;  // Video frame the data belongs to
+    int64_t              timestampMs;  // Time the game produced the data
+  };
+
+  /*!
+   * \brief Shared, read-only reference to a pooled buffer. The buffer returns
+   *        to its pool when the last reference is dropped.
+   */
+  typedef std::shared_ptr<const FrameBuffer> FramePtr;
+
+  /*!
+   * \brief Recycles frame buffers so that keeping a frame past the callback
+   *        costs a reference instead of an allocation and a copy per frontend
+   *
+   * Buffers can be released from any thread, and may outlive the pool.
+   */
+  class CFramePool
+  {
+  public:
+    CFramePool(void);
+
+    /*!
+     * \brief Get a buffer holding a copy of the given data
+     *
+     * The remaining fields are left for the caller to fill in before the
+     * buffer is shared.
+     */
+    std::shared_ptr<FrameBuffer> Acquire(const uint8_t* data, size_t size);
+
+  private:
+    struct FreeList
+    {
+      std::vector<FrameBuffer*> buffers;
+      PLATFORM::CMutex          mutex;
+
+      ~FreeList(void);
+    };
+
+    static void Release(const std::shared_ptr<FreeList>& freeList, FrameBuffer* buffer);
+
+    std::shared_ptr<FreeList> m_freeList;
+  };
+}
@@ -0,0 +1,246 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrameScheduler.h"
+#include "FrontendManager.h"
+#include "IGame.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+  #include <unistd.h>
+#endif
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define DEFAULT_FPS            60.0
+#define SPIN_THRESHOLD_NS      (1000 * 1000) // Sleep until this close to the deadline, then spin
+#define MAX_CATCH_UP_FRAMES    8             // Beyond this the schedule is reset
+#define SPEED_WINDOW_NS        (1000 * 1000 * 1000)
+
+namespace
+{
+  int64_t NowNs(void)
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+}
+
+CFrameScheduler::CFrameScheduler(IGame* game, CFrontendManager* callbacks) :
+  m_game(game),
+  m_callbacks(callbacks),
+  m_periodNs(0),
+  m_cpu(-1),
+  m_policy(FRAME_POLICY_CATCH_UP),
+  m_fastForward(0),
+  m_speedStartNs(0),
+  m_speedFrames(0),
+  m_stats()
+{
+}
+
+CFrameScheduler::~CFrameScheduler(void)
+{
+  Stop();
+}
+
+bool CFrameScheduler::Start(double fps, FRAME_POLICY policy /* = FRAME_POLICY_CATCH_UP */, int cpu /* = -1 */)
+{
+  if (fps <= 0.0)
+  {
+    esyslog("Game reported an invalid frame rate, using %.0f fps", DEFAULT_FPS);
+    fps = DEFAULT_FPS;
+  }
+
+  m_periodNs = static_cast<int64_t>(1000000000.0 / fps + 0.5);
+  m_policy = policy;
+  m_cpu = cpu;
+
+  {
+    CLockObject lock(m_statsMutex);
+    m_stats = FrameSchedulerStats();
+  }
+
+  isyslog("Running game at %.3f fps", fps);
+
+  return CreateThread(false);
+}
+
+void CFrameScheduler::Stop(void)
+{
+  StopThread();
+}
+
+void CFrameScheduler::SetFastForward(unsigned int videoInterval)
+{
+  const unsigned int previous = m_fastForward.exchange(videoInterval);
+  if (previous == videoInterval)
+    return;
+
+  if (m_callbacks)
+    m_callbacks->SetFastForward(videoInterval);
+
+  if (videoInterval != 0)
+    isyslog("Fast-forwarding, showing every %u frames", videoInterval);
+  else
+    isyslog("Returning to native speed");
+}
+
+void CFrameScheduler::GetStats(FrameSchedulerStats& stats)
+{
+  CLockObject lock(m_statsMutex);
+  stats = m_stats;
+}
+
+void* CFrameScheduler::Process(void)
+{
+  PinThread();
+
+  int64_t start = NowNs();
+  uint64_t frame = 0;
+
+  m_speedStartNs = start;
+  m_speedFrames = 0;
+
+  while (!IsStopped())
+  {
+    if (m_fastForward != 0)
+    {
+      m_game->FrameEvent();
+      UpdateSpeed(NowNs());
+
+      {
+        CLockObject lock(m_statsMutex);
+        m_stats.frames++;
+      }
+
+      // Resume the schedule from here rather than catch up on wall time
+      start = NowNs();
+      frame = 0;
+      continue;
+    }
+
+    const int64_t deadline = start + static_cast<int64_t>(frame) * m_periodNs;
+
+    int64_t now = NowNs();
+    if (deadline - now > SPIN_THRESHOLD_NS)
+    {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(deadline - now - SPIN_THRESHOLD_NS));
+      now = NowNs();
+    }
+
+    while (now < deadline)
+      now = NowNs();
+
+    int64_t lateNs = now - deadline;
+    bool bCatchUp = false;
+
+    if (lateNs >= m_periodNs)
+    {
+      const uint64_t missed = lateNs / m_periodNs;
+
+      if (m_policy == FRAME_POLICY_SKIP || missed > MAX_CATCH_UP_FRAMES)
+      {
+        // Resume the schedule from the most recent deadline instead
+        frame += missed;
+        lateNs -= static_cast<int64_t>(missed) * m_periodNs;
+
+        CLockObject lock(m_statsMutex);
+        m_stats.skippedFrames += missed;
+      }
+      else
+      {
+        bCatchUp = true;
+      }
+    }
+
+    m_game->FrameEvent();
+    frame++;
+
+    UpdateStats(lateNs, bCatchUp);
+    UpdateSpeed(NowNs());
+  }
+
+  return NULL;
+}
+
+void CFrameScheduler::PinThread(void)
+{
+#if defined(__linux__)
+  const long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpuCount <= 1)
+    return;
+
+  const int cpu = m_cpu >= 0 ? m_cpu : static_cast<int>(cpuCount - 1);
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+    esyslog("Failed to pin emulation thread to CPU %d", cpu);
+  else
+    dsyslog("Emulation thread pinned to CPU %d", cpu);
+#endif
+}
+
+void CFrameScheduler::UpdateStats(int64_t lateNs, bool bCatchUp)
+{
+  const double lateUs = lateNs / 1000.0;
+
+  CLockObject lock(m_statsMutex);
+
+  m_stats.frames++;
+  m_stats.driftUs = lateUs;
+
+  // Catch-up frames are late on purpose, they'd swamp the jitter figures
+  if (bCatchUp)
+  {
+    m_stats.catchUpFrames++;
+  }
+  else
+  {
+    m_stats.averageJitterUs += (lateUs - m_stats.averageJitterUs) / 16.0;
+    m_stats.maxJitterUs = std::max(m_stats.maxJitterUs, lateUs);
+  }
+}
+
+void CFrameScheduler::UpdateSpeed(int64_t now)
+{
+  m_speedFrames++;
+
+  const int64_t elapsedNs = now - m_speedStartNs;
+  if (elapsedNs < SPEED_WINDOW_NS)
+    return;
+
+  const double speed = static_cast<double>(m_speedFrames) * m_periodNs / elapsedNs;
+
+  m_speedStartNs = now;
+  m_speedFrames = 0;
+
+  CLockObject lock(m_statsMutex);
+  m_stats.speed = speed;
+}
@@ -0,0 +1,113 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  class CFrontendManager;
+  class IGame;
+
+  /*!
+   * \brief What to do when the schedule falls more than a frame behind
+   */
+  enum FRAME_POLICY
+  {
+    FRAME_POLICY_CATCH_UP, // Run the missed frames back to back (game time is preserved)
+    FRAME_POLICY_SKIP,     // Drop the missed frames (wall time is preserved)
+  };
+
+  struct FrameSchedulerStats
+  {
+    uint64_t frames;          // Frames run
+    uint64_t catchUpFrames;   // Frames run late to catch up
+    uint64_t skippedFrames;   // Frames dropped
+    double   averageJitterUs; // Frame start vs deadline, smoothed
+    double   maxJitterUs;
+    double   driftUs;         // How far behind the schedule the last frame started
+    double   speed;           // Frames run over the last second, as a multiple of the native rate
+  };
+
+  /*!
+   * \brief Runs the game's FrameEvent() on its own thread at a fixed rate
+   *
+   * Deadlines are absolute (start + n * period), so rounding errors and late
+   * frames don't accumulate into drift. The thread sleeps until shortly
+   * before each deadline and spins for the rest, which gets frame starts
+   * within tens of microseconds of the deadline on an idle core. On Linux
+   * the thread is pinned to one CPU so the spin isn't migrated.
+   *
+   * In fast-forward, frames run back to back as fast as the game allows and
+   * the frontends only see every Nth video frame.
+   */
+  class CFrameScheduler : public PLATFORM::CThread
+  {
+  public:
+    /*!
+     * \param callbacks Filters video and audio in fast-forward, may be NULL
+     */
+    CFrameScheduler(IGame* game, CFrontendManager* callbacks);
+    virtual ~CFrameScheduler(void);
+
+    /*!
+     * \param fps The game's frame rate, from game_system_timing
+     * \param cpu CPU to pin the thread to, or -1 for the last CPU
+     */
+    bool Start(double fps, FRAME_POLICY policy = FRAME_POLICY_CATCH_UP, int cpu = -1);
+    void Stop(void);
+
+    void SetPolicy(FRAME_POLICY policy) { m_policy = policy; }
+
+    /*!
+     * \brief Run unthrottled, forwarding every videoInterval-th video frame
+     *        and no audio. 0 returns to the native rate.
+     */
+    void SetFastForward(unsigned int videoInterval);
+    bool IsFastForwarding(void) const { return m_fastForward != 0; }
+
+    void GetStats(FrameSchedulerStats& stats);
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    void PinThread(void);
+    void UpdateStats(int64_t lateNs, bool bCatchUp);
+    void UpdateSpeed(int64_t now);
+
+    IGame* const              m_game;
+    CFrontendManager* const   m_callbacks;
+    int64_t                   m_periodNs;
+    int                       m_cpu;
+    std::atomic<FRAME_POLICY> m_policy;
+    std::atomic<unsigned int> m_fastForward;  // Video interval, 0 if off
+    int64_t                   m_speedStartNs; // Start of the speed measurement window
+    uint64_t                  m_speedFrames;  // Frames run in the window
+
+    FrameSchedulerStats       m_stats;
+    PLATFORM::CMutex          m_statsMutex;
+  };
+}
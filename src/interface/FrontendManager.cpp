@@ -25,38 +25,339 @@
 
 #include "kodi/libKODI_game.h"
 #include "kodi/libXBMC_addon.h"
+#include "platform/util/timeutils.h"
 
 #include <algorithm>
 #include <assert.h>
+#include <stdio.h>
+#include <thread>
 
 using namespace NETPLAY;
+using namespace PLATFORM;
 
-void CFrontendManager::RegisterFrontend(IFrontend* frontend)
+namespace NETPLAY
 {
-  CWriteLockObject lock(m_mutex);
+  const char* const FrontendCallNames[FRONTEND_CALL_COUNT] =
+  {
+    "Log",
+    "GetSetting",
+    "QueueNotification",
+    "WakeOnLan",
+    "UnknownToUTF8",
+    "GetLocalizedString",
+    "GetDVDMenuLanguage",
+    "OpenFile",
+    "OpenFileForWrite",
+    "ReadFile",
+    "ReadFileString",
+    "WriteFile",
+    "FlushFile",
+    "SeekFile",
+    "TruncateFile",
+    "GetFilePosition",
+    "GetFileLength",
+    "CloseFile",
+    "GetFileChunkSize",
+    "FileExists",
+    "StatFile",
+    "DeleteFile",
+    "CanOpenDirectory",
+    "CreateDirectory",
+    "DirectoryExists",
+    "RemoveDirectory",
+    "CloseGame",
+    "VideoFrame",
+    "AudioFrames",
+    "HwSetInfo",
+    "HwGetCurrentFramebuffer",
+    "HwGetProcAddress",
+    "OpenPort",
+    "ClosePort",
+    "RumbleSetState",
+  };
+}
+
+CFrontendManager::CFrontendSnapshot::CFrontendSnapshot(CFrontendManager& manager) :
+  m_readers(manager.m_readers[manager.m_epoch.load()])
+{
+  // Announce ourselves before loading the list, so a writer that swaps the
+  // list after this point waits for us
+  m_readers++;
+  m_list = manager.m_list.load();
+}
+
+CFrontendManager::CFrontendSnapshot::~CFrontendSnapshot(void)
+{
+  m_readers--;
+}
+
+CFrontendManager::CFrontendManager(void) :
+  m_list(new FrontendList),
+  m_epoch(0),
+  m_frontendCount(0),
+  m_frameNumber(0),
+  m_bVideoEnabled(true),
+  m_bAudioEnabled(true),
+  m_videoInterval(1),
+  m_bFastForward(false),
+  m_bAsyncDispatch(false)
+{
+  m_readers[0] = 0;
+  m_readers[1] = 0;
+}
+
+CFrontendManager::~CFrontendManager(void)
+{
+  FrontendList* list = m_list.load();
+
+  for (WorkerVector::iterator it = list->workers.begin(); it != list->workers.end(); ++it)
+    delete *it;
+
+  delete list;
+
+  for (FrontendVector::iterator it = m_frontendStats.begin(); it != m_frontendStats.end(); ++it)
+    delete it->stats;
+}
+
+void CFrontendManager::RegisterFrontend(IFrontend* frontend, unsigned int capabilities /* = FRONTEND_CAP_ALL */)
+{
+  CLockObject lock(m_writeMutex);
+
+  char strName[32];
+  snprintf(strName, sizeof(strName), "frontend %u", ++m_frontendCount);
+
+  FrontendEntry entry;
+  entry.frontend = frontend;
+  entry.stats = new CCallStats(strName, FrontendCallNames, FRONTEND_CALL_COUNT);
+  m_frontendStats.push_back(entry);
+
+  FrontendList* list = new FrontendList(*m_list.load());
+  list->frontends.push_back(entry);
+
+  if (capabilities & FRONTEND_CAP_RUMBLE)
+    list->rumble.push_back(entry);
+  if (capabilities & FRONTEND_CAP_LOG)
+    list->log.push_back(entry);
+
+  CFrontendWorker* worker = NULL;
+  if (m_bAsyncDispatch && (capabilities & (FRONTEND_CAP_VIDEO | FRONTEND_CAP_AUDIO)))
+  {
+    worker = new CFrontendWorker(frontend, entry.stats);
+    if (!worker->Start())
+    {
+      esyslog("Failed to start frontend worker, delivering video and audio synchronously");
+      delete worker;
+      worker = NULL;
+    }
+  }
+
+  if (worker)
+  {
+    list->workers.push_back(worker);
+    if (capabilities & FRONTEND_CAP_VIDEO)
+      list->videoWorkers.push_back(worker);
+    if (capabilities & FRONTEND_CAP_AUDIO)
+      list->audioWorkers.push_back(worker);
+  }
+  else
+  {
+    if (capabilities & FRONTEND_CAP_VIDEO)
+      list->video.push_back(entry);
+    if (capabilities & FRONTEND_CAP_AUDIO)
+      list->audio.push_back(entry);
+  }
+
+  Publish(list);
 
-  m_frontends.push_back(frontend);
+  // Cached answers came from the previous set of frontends
+  m_metadataCache.Clear();
 }
 
 bool CFrontendManager::UnregisterFrontend(IFrontend* frontend)
 {
-  CWriteLockObject lock(m_mutex);
+  CLockObject lock(m_writeMutex);
+
+  FrontendVector::iterator itStats = FindFrontend(m_frontendStats, frontend);
+  if (itStats == m_frontendStats.end())
+    return false;
 
-  const unsigned int oldSize = m_frontends.size();
+  CCallStats* stats = itStats->stats;
+  m_frontendStats.erase(itStats);
 
-  m_frontends.erase(std::remove(m_frontends.begin(), m_frontends.end(), frontend), m_frontends.end());
+  FrontendList* list = new FrontendList(*m_list.load());
+  RemoveFrontend(list->frontends, frontend);
+  RemoveFrontend(list->video, frontend);
+  RemoveFrontend(list->audio, frontend);
+  RemoveFrontend(list->rumble, frontend);
+  RemoveFrontend(list->log, frontend);
 
-  return oldSize != m_frontends.size();
+  CFrontendWorker* worker = NULL;
+  for (WorkerVector::iterator it = list->workers.begin(); it != list->workers.end(); ++it)
+  {
+    if ((*it)->Frontend() == frontend)
+    {
+      worker = *it;
+      list->workers.erase(it);
+      break;
+    }
+  }
+
+  if (worker)
+  {
+    list->videoWorkers.erase(std::remove(list->videoWorkers.begin(), list->videoWorkers.end(), worker), list->videoWorkers.end());
+    list->audioWorkers.erase(std::remove(list->audioWorkers.begin(), list->audioWorkers.end(), worker), list->audioWorkers.end());
+  }
+
+  // Forget handles the frontend never closed. This happens before the list
+  // is published so that callers already routed to it are waited for.
+  {
+    CLockObject fileLock(m_fileMutex);
+
+    for (FileOwnerMap::iterator it = m_fileOwners.begin(); it != m_fileOwners.end(); )
+    {
+      if (it->second.owner.frontend == frontend)
+        it = m_fileOwners.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  Publish(list);
+
+  // Cached answers may have come from the removed frontend
+  m_metadataCache.Clear();
+
+  // No reader can reach the worker anymore
+  delete worker;
+  delete stats;
+
+  return true;
+}
+
+bool CFrontendManager::GetLag(IFrontend* frontend, FrontendLag& lag)
+{
+  CFrontendSnapshot frontends(*this);
+
+  const WorkerVector& workers = frontends.List().workers;
+  for (WorkerVector::const_iterator it = workers.begin(); it != workers.end(); ++it)
+  {
+    if ((*it)->Frontend() == frontend)
+    {
+      (*it)->GetLag(lag);
+      return true;
+    }
+  }
+
+  return false;
 }
 
-IFrontend* CFrontendManager::GetMaster(void)
+void CFrontendManager::Publish(FrontendList* list)
 {
-  if (!m_frontends.empty())
-    return *m_frontends.begin();
+  FrontendList* oldList = m_list.exchange(list);
+
+  // Any reader that can still see the old list registered itself in one of
+  // the two epoch counters before the exchange. Drain the idle epoch (late
+  // readers that loaded a stale epoch), then flip so new readers stop
+  // joining the current epoch, and drain that too.
+  const unsigned int current = m_epoch.load();
+  const unsigned int next = current ^ 1;
+
+  while (m_readers[next] != 0)
+    std::this_thread::yield();
+
+  m_epoch = next;
+
+  while (m_readers[current] != 0)
+    std::this_thread::yield();
+
+  delete oldList;
+}
+
+const CFrontendManager::FrontendEntry* CFrontendManager::GetMaster(const FrontendVector& frontends)
+{
+  if (!frontends.empty())
+    return &frontends.front();
 
   return NULL;
 }
 
+CFrontendManager::FrontendVector::iterator CFrontendManager::FindFrontend(FrontendVector& frontends, IFrontend* frontend)
+{
+  for (FrontendVector::iterator it = frontends.begin(); it != frontends.end(); ++it)
+  {
+    if (it->frontend == frontend)
+      return it;
+  }
+
+  return frontends.end();
+}
+
+void CFrontendManager::RemoveFrontend(FrontendVector& frontends, IFrontend* frontend)
+{
+  FrontendVector::iterator it = FindFrontend(frontends, frontend);
+  if (it != frontends.end())
+    frontends.erase(it);
+}
+
+void CFrontendManager::SetFileOwner(void* file, const FrontendEntry& owner, const std::string& strWritePath /* = "" */)
+{
+  CLockObject lock(m_fileMutex);
+
+  FileHandle& handle = m_fileOwners[file];
+  handle.owner = owner;
+  handle.strWritePath = strWritePath;
+}
+
+CFrontendManager::FrontendEntry CFrontendManager::GetFileOwner(void* file)
+{
+  CLockObject lock(m_fileMutex);
+
+  FileOwnerMap::const_iterator it = m_fileOwners.find(file);
+  if (it != m_fileOwners.end())
+    return it->second.owner;
+
+  FrontendEntry none = { NULL, NULL };
+  return none;
+}
+
+bool CFrontendManager::GetCallStats(IFrontend* frontend, std::vector<CallHistogram>& histograms)
+{
+  CLockObject lock(m_writeMutex);
+
+  FrontendVector::iterator it = FindFrontend(m_frontendStats, frontend);
+  if (it == m_frontendStats.end())
+    return false;
+
+  it->stats->Collect(histograms);
+  return true;
+}
+
+void CFrontendManager::DumpStats(void)
+{
+  CLockObject lock(m_writeMutex);
+
+  for (FrontendVector::const_iterator it = m_frontendStats.begin(); it != m_frontendStats.end(); ++it)
+  {
+    it->stats->Dump();
+
+    FrontendLag lag;
+    if (GetLag(it->frontend, lag))
+    {
+      isyslog("  async delivery: queued audio=%u dropped video=%u dropped audio=%u latency avg=%.1fms max=%.1fms",
+              lag.queuedAudio, lag.droppedVideo, lag.droppedAudio, lag.averageLatencyMs, lag.maxLatencyMs);
+    }
+  }
+}
+
+void CFrontendManager::InvalidateMetadata(void* file)
+{
+  CLockObject lock(m_fileMutex);
+
+  FileOwnerMap::const_iterator it = m_fileOwners.find(file);
+  if (it != m_fileOwners.end() && !it->second.strWritePath.empty())
+    m_metadataCache.Invalidate(it->second.strWritePath);
+}
+
 void CFrontendManager::Log(const ADDON::addon_log_t loglevel, const char* msg)
 {
   if (CLog::Get().Type() != SYS_LOG_TYPE_ADDON)
@@ -78,37 +379,48 @@ void CFrontendManager::Log(const ADDON::addon_log_t loglevel, const char* msg)
     }
   }
 
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  const FrontendVector& log = frontends.List().log;
+  for (FrontendVector::const_iterator it = log.begin(); it != log.end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_LOG);
     (*it)->Log(loglevel, msg);
+  }
 }
 
 bool CFrontendManager::GetSetting(const char* settingName, void* settingValue)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  IFrontend* master = GetMaster();
+  const FrontendEntry* master = GetMaster(*frontends);
   if (master)
-    return master->GetSetting(settingName, settingValue);
+  {
+    CCallTimer timer(master->stats, FRONTEND_CALL_GET_SETTING);
+    return master->frontend->GetSetting(settingName, settingValue);
+  }
 
   return false;
 }
 
 void CFrontendManager::QueueNotification(const ADDON::queue_msg_t type, const char* msg)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_QUEUE_NOTIFICATION);
     (*it)->QueueNotification(type, msg);
+  }
 }
 
 bool CFrontendManager::WakeOnLan(const char* mac)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_WAKE_ON_LAN);
     if ((*it)->WakeOnLan(mac))
       return true;
   }
@@ -118,46 +430,59 @@ bool CFrontendManager::WakeOnLan(const char* mac)
 
 std::string CFrontendManager::UnknownToUTF8(const char* str)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  IFrontend* master = GetMaster();
+  const FrontendEntry* master = GetMaster(*frontends);
   if (master)
-    return master->UnknownToUTF8(str);
+  {
+    CCallTimer timer(master->stats, FRONTEND_CALL_UNKNOWN_TO_UTF8);
+    return master->frontend->UnknownToUTF8(str);
+  }
 
   return "";
 }
 
 std::string CFrontendManager::GetLocalizedString(int dwCode, const char* strDefault /* = "" */)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  IFrontend* master = GetMaster();
+  const FrontendEntry* master = GetMaster(*frontends);
   if (master)
-    return master->GetLocalizedString(dwCode, strDefault);
+  {
+    CCallTimer timer(master->stats, FRONTEND_CALL_GET_LOCALIZED_STRING);
+    return master->frontend->GetLocalizedString(dwCode, strDefault);
+  }
 
   return "";
 }
 
 std::string CFrontendManager::GetDVDMenuLanguage(void)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  IFrontend* master = GetMaster();
+  const FrontendEntry* master = GetMaster(*frontends);
   if (master)
-    return master->GetDVDMenuLanguage();
+  {
+    CCallTimer timer(master->stats, FRONTEND_CALL_GET_DVD_MENU_LANGUAGE);
+    return master->frontend->GetDVDMenuLanguage();
+  }
 
   return "";
 }
 
 void* CFrontendManager::OpenFile(const char* strFileName, unsigned int flags)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_OPEN_FILE);
     void* file = (*it)->OpenFile(strFileName, flags);
     if (file)
+    {
+      SetFileOwner(file, *it);
       return file;
+    }
   }
 
   return NULL;
@@ -165,13 +490,18 @@ void* CFrontendManager::OpenFile(const char* strFileName, unsigned int flags)
 
 void* CFrontendManager::OpenFileForWrite(const char* strFileName, bool bOverWrite)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_OPEN_FILE_FOR_WRITE);
     void* file = (*it)->OpenFileForWrite(strFileName, bOverWrite);
     if (file)
+    {
+      SetFileOwner(file, *it, strFileName);
+      m_metadataCache.Invalidate(strFileName);
       return file;
+    }
   }
 
   return NULL;
@@ -179,13 +509,13 @@ void* CFrontendManager::OpenFileForWrite(const char* strFileName, bool bOverWrit
 
 ssize_t CFrontendManager::ReadFile(void* file, void* lpBuf, size_t uiBufSize)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    ssize_t result = (*it)->ReadFile(file, lpBuf, uiBufSize);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_READ_FILE);
+    return owner->ReadFile(file, lpBuf, uiBufSize);
   }
 
   return -1;
@@ -193,12 +523,13 @@ ssize_t CFrontendManager::ReadFile(void* file, void* lpBuf, size_t uiBufSize)
 
 bool CFrontendManager::ReadFileString(void* file, char* szLine, int iLineLength)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    if ((*it)->ReadFileString(file, szLine, iLineLength))
-      return true;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_READ_FILE_STRING);
+    return owner->ReadFileString(file, szLine, iLineLength);
   }
 
   return false;
@@ -206,13 +537,15 @@ bool CFrontendManager::ReadFileString(void* file, char* szLine, int iLineLength)
 
 ssize_t CFrontendManager::WriteFile(void* file, const void* lpBuf, size_t uiBufSize)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    ssize_t result = (*it)->WriteFile(file, lpBuf, uiBufSize);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_WRITE_FILE);
+    ssize_t result = owner->WriteFile(file, lpBuf, uiBufSize);
+    InvalidateMetadata(file);
+    return result;
   }
 
   return -1;
@@ -220,21 +553,25 @@ ssize_t CFrontendManager::WriteFile(void* file, const void* lpBuf, size_t uiBufS
 
 void CFrontendManager::FlushFile(void* file)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
-    (*it)->FlushFile(file);
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
+  {
+    CCallTimer timer(owner.stats, FRONTEND_CALL_FLUSH_FILE);
+    owner->FlushFile(file);
+  }
 }
 
 int64_t CFrontendManager::SeekFile(void* file, int64_t iFilePosition, int iWhence)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    int64_t result = (*it)->SeekFile(file, iFilePosition, iWhence);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_SEEK_FILE);
+    return owner->SeekFile(file, iFilePosition, iWhence);
   }
 
   return -1;
@@ -242,13 +579,15 @@ int64_t CFrontendManager::SeekFile(void* file, int64_t iFilePosition, int iWhenc
 
 int CFrontendManager::TruncateFile(void* file, int64_t iSize)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    int result = (*it)->TruncateFile(file, iSize);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_TRUNCATE_FILE);
+    int result = owner->TruncateFile(file, iSize);
+    InvalidateMetadata(file);
+    return result;
   }
 
   return -1;
@@ -256,13 +595,13 @@ int CFrontendManager::TruncateFile(void* file, int64_t iSize)
 
 int64_t CFrontendManager::GetFilePosition(void* file)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    int64_t result = (*it)->GetFilePosition(file);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_GET_FILE_POSITION);
+    return owner->GetFilePosition(file);
   }
 
   return -1;
@@ -270,13 +609,13 @@ int64_t CFrontendManager::GetFilePosition(void* file)
 
 int64_t CFrontendManager::GetFileLength(void* file)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    int64_t result = (*it)->GetFileLength(file);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_GET_FILE_LENGTH);
+    return owner->GetFileLength(file);
   }
 
   return -1;
@@ -284,21 +623,42 @@ int64_t CFrontendManager::GetFileLength(void* file)
 
 void CFrontendManager::CloseFile(void* file)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
+
+  FrontendEntry owner = { NULL, NULL };
+  std::string strWritePath;
+  {
+    CLockObject lock(m_fileMutex);
+
+    FileOwnerMap::iterator it = m_fileOwners.find(file);
+    if (it != m_fileOwners.end())
+    {
+      owner = it->second.owner;
+      strWritePath = it->second.strWritePath;
+      m_fileOwners.erase(it);
+    }
+  }
+
+  if (owner.frontend)
+  {
+    CCallTimer timer(owner.stats, FRONTEND_CALL_CLOSE_FILE);
+    owner->CloseFile(file);
+  }
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
-    (*it)->CloseFile(file);
+  // Closing flushes buffered writes
+  if (!strWritePath.empty())
+    m_metadataCache.Invalidate(strWritePath);
 }
 
 int CFrontendManager::GetFileChunkSize(void* file)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  FrontendEntry owner = GetFileOwner(file);
+  if (owner.frontend)
   {
-    int result = (*it)->GetFileChunkSize(file);
-    if (result != -1)
-      return result;
+    CCallTimer timer(owner.stats, FRONTEND_CALL_GET_FILE_CHUNK_SIZE);
+    return owner->GetFileChunkSize(file);
   }
 
   return -1;
@@ -306,49 +666,83 @@ int CFrontendManager::GetFileChunkSize(void* file)
 
 bool CFrontendManager::FileExists(const char* strFileName, bool bUseCache)
 {
-  CReadLockObject lock(m_mutex);
+  bool bExists;
+  if (bUseCache && m_metadataCache.GetExists(strFileName, bExists))
+    return bExists;
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  const uint64_t generation = m_metadataCache.Generation();
+
+  CFrontendSnapshot frontends(*this);
+
+  bExists = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_FILE_EXISTS);
     if ((*it)->FileExists(strFileName, bUseCache))
-      return true;
+    {
+      bExists = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.SetExists(strFileName, bExists, generation);
+
+  return bExists;
 }
 
 bool CFrontendManager::StatFile(const char* strFileName, STAT_STRUCTURE& buffer)
 {
-  CReadLockObject lock(m_mutex);
+  bool bSuccess;
+  if (m_metadataCache.GetStat(strFileName, bSuccess, buffer))
+    return bSuccess;
+
+  const uint64_t generation = m_metadataCache.Generation();
+
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  bSuccess = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_STAT_FILE);
     if ((*it)->StatFile(strFileName, buffer))
-      return true;
+    {
+      bSuccess = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.SetStat(strFileName, bSuccess, buffer, generation);
+
+  return bSuccess;
 }
 
 bool CFrontendManager::DeleteFile(const char* strFileName)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  bool bSuccess = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_DELETE_FILE);
     if ((*it)->DeleteFile(strFileName))
-      return true;
+    {
+      bSuccess = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.Invalidate(strFileName);
+
+  return bSuccess;
 }
 
 bool CFrontendManager::CanOpenDirectory(const char* strUrl)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_CAN_OPEN_DIRECTORY);
     if ((*it)->CanOpenDirectory(strUrl))
       return true;
   }
@@ -358,81 +752,180 @@ bool CFrontendManager::CanOpenDirectory(const char* strUrl)
 
 bool CFrontendManager::CreateDirectory(const char* strPath)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  bool bSuccess = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_CREATE_DIRECTORY);
     if ((*it)->CreateDirectory(strPath))
-      return true;
+    {
+      bSuccess = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.Invalidate(strPath);
+
+  return bSuccess;
 }
 
 bool CFrontendManager::DirectoryExists(const char* strPath)
 {
-  CReadLockObject lock(m_mutex);
+  bool bExists;
+  if (m_metadataCache.GetDirectoryExists(strPath, bExists))
+    return bExists;
+
+  const uint64_t generation = m_metadataCache.Generation();
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  CFrontendSnapshot frontends(*this);
+
+  bExists = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_DIRECTORY_EXISTS);
     if ((*it)->DirectoryExists(strPath))
-      return true;
+    {
+      bExists = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.SetDirectoryExists(strPath, bExists, generation);
+
+  return bExists;
 }
 
 bool CFrontendManager::RemoveDirectory(const char* strPath)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  bool bSuccess = false;
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_REMOVE_DIRECTORY);
     if ((*it)->RemoveDirectory(strPath))
-      return true;
+    {
+      bSuccess = true;
+      break;
+    }
   }
 
-  return false;
+  m_metadataCache.Invalidate(strPath);
+
+  return bSuccess;
 }
 
 void CFrontendManager::CloseGame(void)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_CLOSE_GAME);
     (*it)->CloseGame();
+  }
 }
 
 void CFrontendManager::VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format)
 {
-  CReadLockObject lock(m_mutex);
+  const uint64_t frameNumber = m_frameNumber++;
+
+  if (!m_bVideoEnabled)
+    return;
+
+  const unsigned int interval = m_videoInterval;
+  if (interval > 1 && frameNumber % interval != 0)
+    return;
+
+  CFrontendSnapshot frontends(*this);
+
+  const FrontendList& list = frontends.List();
+  if (list.video.empty() && list.videoWorkers.empty())
+    return;
+
+  // A lone frontend on the game thread takes the game client's buffer as is
+  if (list.video.size() == 1 && list.videoWorkers.empty())
+  {
+    CCallTimer timer(list.video[0].stats, FRONTEND_CALL_VIDEO_FRAME);
+    list.video[0]->VideoFrame(data, size, width, height, format);
+    return;
+  }
+
+  // One copy into a pooled buffer, shared by every frontend
+  std::shared_ptr<FrameBuffer> buffer = m_framePool.Acquire(data, size);
+  buffer->width = width;
+  buffer->height = height;
+  buffer->renderFormat = format;
+  buffer->frameNumber = frameNumber;
+  buffer->timestampMs = GetTimeMs();
+
+  const FramePtr frame = buffer;
+
+  for (FrontendVector::const_iterator it = list.video.begin(); it != list.video.end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_VIDEO_FRAME);
+    (*it)->SharedVideoFrame(frame);
+  }
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
-    (*it)->VideoFrame(data, size, width, height, format);
+  for (WorkerVector::const_iterator it = list.videoWorkers.begin(); it != list.videoWorkers.end(); ++it)
+    (*it)->QueueVideo(frame);
 }
 
 void CFrontendManager::AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format)
 {
-  CReadLockObject lock(m_mutex);
+  if (!m_bAudioEnabled || m_bFastForward)
+    return;
+
+  CFrontendSnapshot frontends(*this);
+
+  const FrontendList& list = frontends.List();
+  if (list.audio.empty() && list.audioWorkers.empty())
+    return;
+
+  if (list.audio.size() == 1 && list.audioWorkers.empty())
+  {
+    CCallTimer timer(list.audio[0].stats, FRONTEND_CALL_AUDIO_FRAMES);
+    list.audio[0]->AudioFrames(data, size, frames, format);
+    return;
+  }
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
-    (*it)->AudioFrames(data, size, frames, format);
+  std::shared_ptr<FrameBuffer> buffer = m_framePool.Acquire(data, size);
+  buffer->frames = frames;
+  buffer->audioFormat = format;
+  buffer->frameNumber = m_frameNumber;
+  buffer->timestampMs = GetTimeMs();
+
+  const FramePtr frame = buffer;
+
+  for (FrontendVector::const_iterator it = list.audio.begin(); it != list.audio.end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_AUDIO_FRAMES);
+    (*it)->SharedAudioFrames(frame);
+  }
+
+  for (WorkerVector::const_iterator it = list.audioWorkers.begin(); it != list.audioWorkers.end(); ++it)
+    (*it)->QueueAudio(frame);
 }
 
 void CFrontendManager::HwSetInfo(const game_hw_info* hw_info)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_HW_SET_INFO);
     (*it)->HwSetInfo(hw_info);
+  }
 }
 
 uintptr_t CFrontendManager::HwGetCurrentFramebuffer(void)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_HW_GET_CURRENT_FRAMEBUFFER);
     uintptr_t framebuffer = (*it)->HwGetCurrentFramebuffer();
     if (framebuffer != 0)
       return framebuffer;
@@ -443,10 +936,11 @@ uintptr_t CFrontendManager::HwGetCurrentFramebuffer(void)
 
 game_proc_address_t CFrontendManager::HwGetProcAddress(const char* symbol)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_HW_GET_PROC_ADDRESS);
     game_proc_address_t proc = (*it)->HwGetProcAddress(symbol);
     if (proc != NULL)
       return proc;
@@ -457,10 +951,11 @@ game_proc_address_t CFrontendManager::HwGetProcAddress(const char* symbol)
 
 bool CFrontendManager::OpenPort(unsigned int port)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
   {
+    CCallTimer timer(it->stats, FRONTEND_CALL_OPEN_PORT);
     if ((*it)->OpenPort(port))
       return true;
   }
@@ -470,16 +965,23 @@ bool CFrontendManager::OpenPort(unsigned int port)
 
 void CFrontendManager::ClosePort(unsigned int port)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  for (FrontendVector::const_iterator it = frontends->begin(); it != frontends->end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_CLOSE_PORT);
     (*it)->ClosePort(port);
+  }
 }
 
 void CFrontendManager::RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength)
 {
-  CReadLockObject lock(m_mutex);
+  CFrontendSnapshot frontends(*this);
 
-  for (std::vector<IFrontend*>::iterator it = m_frontends.begin(); it != m_frontends.end(); ++it)
+  const FrontendVector& rumble = frontends.List().rumble;
+  for (FrontendVector::const_iterator it = rumble.begin(); it != rumble.end(); ++it)
+  {
+    CCallTimer timer(it->stats, FRONTEND_CALL_RUMBLE_SET_STATE);
     (*it)->RumbleSetState(port, effect, strength);
+  }
 }
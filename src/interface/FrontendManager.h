@@ -19,31 +19,122 @@
  */
 #pragma once
 
+#include "FramePool.h"
+#include "FrontendWorker.h"
 #include "IFrontend.h"
-#include "utils/ReadWriteLock.h"
+#include "filesystem/MetadataCache.h"
+#include "utils/CallStats.h"
 
+#include "platform/threads/mutex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
 #include <vector>
 
 namespace NETPLAY
 {
   class IFrontend;
 
+  /*!
+   * \brief Broadcast callbacks a frontend consumes
+   *
+   * Frontends that opt out of a callback are left off its dispatch list
+   * entirely. All other callbacks are always delivered.
+   */
+  enum FRONTEND_CAPABILITY
+  {
+    FRONTEND_CAP_VIDEO  = 1 << 0,
+    FRONTEND_CAP_AUDIO  = 1 << 1,
+    FRONTEND_CAP_RUMBLE = 1 << 2,
+    FRONTEND_CAP_LOG    = 1 << 3,
+    FRONTEND_CAP_ALL    = FRONTEND_CAP_VIDEO | FRONTEND_CAP_AUDIO | FRONTEND_CAP_RUMBLE | FRONTEND_CAP_LOG,
+  };
+
+  /*!
+   * \brief Fans callbacks out to all registered frontends
+   *
+   * The frontend list is read on every callback, including several per frame,
+   * and changes rarely. It is published as an immutable snapshot: readers load
+   * it without taking a lock, and writers copy, modify and swap it, then wait
+   * for readers of the old snapshot to finish before freeing it.
+   */
   class CFrontendManager : public IFrontend
   {
   public:
-    CFrontendManager(void) { }
+    CFrontendManager(void);
+    virtual ~CFrontendManager(void);
 
     /*!
      * \brief Register an initialized frontend with this manager
+     * \param capabilities Mask of FRONTEND_CAPABILITY flags to receive
      */
-    void RegisterFrontend(IFrontend* frontend);
+    void RegisterFrontend(IFrontend* frontend, unsigned int capabilities = FRONTEND_CAP_ALL);
 
     /*!
      * \brief Unregister a frontend from this manager
+     *
+     * On return, no callbacks into the frontend are in progress and it can be
+     * safely destroyed. Must not be called from a callback.
+     *
      * \return false if the frontend wasn't previously registered
      */
     bool UnregisterFrontend(IFrontend* frontend);
 
+    /*!
+     * \brief Deliver video and audio to frontends registered after this call
+     *        from a worker thread per frontend, instead of the game thread
+     *
+     * Other callbacks are still made on the game thread, so these frontends
+     * may receive calls from two threads at once.
+     */
+    void SetAsyncDispatch(bool bAsync) { m_bAsyncDispatch = bAsync; }
+
+    /*!
+     * \brief Get the delivery lag of a frontend registered in async mode
+     * \return false if the frontend isn't dispatched asynchronously
+     */
+    bool GetLag(IFrontend* frontend, FrontendLag& lag);
+
+    /*!
+     * \brief Get call counts and latencies of the callbacks made into a frontend
+     * \return false if the frontend isn't registered
+     */
+    bool GetCallStats(IFrontend* frontend, std::vector<CallHistogram>& histograms);
+
+    /*!
+     * \brief Log call statistics of every registered frontend, and the
+     *        delivery lag of those dispatched asynchronously
+     */
+    void DumpStats(void);
+
+    /*!
+     * \brief Drop video and audio while the game is being fast-forwarded
+     */
+    void SetAVEnabled(bool bEnabled) { m_bVideoEnabled = bEnabled; m_bAudioEnabled = bEnabled; }
+
+    /*!
+     * \brief Drop one stream only, e.g. video of frames that are run but not
+     *        shown
+     */
+    void SetVideoEnabled(bool bEnabled) { m_bVideoEnabled = bEnabled; }
+    void SetAudioEnabled(bool bEnabled) { m_bAudioEnabled = bEnabled; }
+    bool IsVideoEnabled(void) const { return m_bVideoEnabled; }
+    bool IsAudioEnabled(void) const { return m_bAudioEnabled; }
+
+    /*!
+     * \brief Drop audio and forward only every Nth video frame
+     *
+     * Audio is dropped for as long as fast-forward is on, even if every video
+     * frame is forwarded, as audio played faster than real time only plays
+     * back as noise. An interval of 0 turns fast-forward off.
+     */
+    void SetFastForward(unsigned int videoInterval)
+    {
+      m_videoInterval = std::max(videoInterval, 1u);
+      m_bFastForward = videoInterval != 0;
+    }
+
     // implementation of IFrontend
     virtual bool Initialize(void) { return true; }
     virtual void Deinitialize(void) { }
@@ -84,12 +175,103 @@ namespace NETPLAY
     virtual void RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength);
 
   private:
+    struct FrontendEntry
+    {
+      IFrontend*  frontend;
+      CCallStats* stats;
+
+      IFrontend* operator->(void) const { return frontend; }
+    };
+
+    typedef std::vector<FrontendEntry> FrontendVector;
+    typedef std::vector<CFrontendWorker*> WorkerVector;
+
+    struct FileHandle
+    {
+      FrontendEntry owner;
+      std::string   strWritePath; // Set for handles opened for writing
+    };
+
+    typedef std::unordered_map<void*, FileHandle> FileOwnerMap;
+
+    /*!
+     * \brief Dispatch lists, built when frontends are registered
+     */
+    struct FrontendList
+    {
+      FrontendVector frontends;    // All frontends, in registration order
+      FrontendVector video;        // Receiving video on the game thread
+      FrontendVector audio;        // Receiving audio on the game thread
+      FrontendVector rumble;
+      FrontendVector log;
+      WorkerVector   videoWorkers; // Receiving video asynchronously
+      WorkerVector   audioWorkers; // Receiving audio asynchronously
+      WorkerVector   workers;      // All workers, owned by the list
+    };
+
+    /*!
+     * \brief Pins the current frontend list for the lifetime of the object
+     */
+    class CFrontendSnapshot
+    {
+    public:
+      CFrontendSnapshot(CFrontendManager& manager);
+      ~CFrontendSnapshot(void);
+
+      const FrontendVector& operator*(void) const { return m_list->frontends; }
+      const FrontendVector* operator->(void) const { return &m_list->frontends; }
+
+      const FrontendList& List(void) const { return *m_list; }
+
+    private:
+      std::atomic<unsigned int>& m_readers;
+      const FrontendList*        m_list;
+    };
+
+    /*!
+     * \brief Publish a new frontend list and free the old one once no
+     *        readers are left
+     */
+    void Publish(FrontendList* list);
+
     /*!
      * \brief Get the "master" frontend, the first frontend to be registered
      */
-    IFrontend* GetMaster(void);
+    static const FrontendEntry* GetMaster(const FrontendVector& frontends);
+
+    static FrontendVector::iterator FindFrontend(FrontendVector& frontends, IFrontend* frontend);
+    static void RemoveFrontend(FrontendVector& frontends, IFrontend* frontend);
+
+    /*!
+     * \brief Record which frontend opened a file, so file operations on the
+     *        handle go straight to it instead of trying every frontend
+     *
+     * Lookups must be made while holding a CFrontendSnapshot, which keeps the
+     * owner from being unregistered until the call returns.
+     */
+    void SetFileOwner(void* file, const FrontendEntry& owner, const std::string& strWritePath = "");
+    FrontendEntry GetFileOwner(void* file);
+
+    /*!
+     * \brief Drop cached metadata of a file that was written through a handle
+     */
+    void InvalidateMetadata(void* file);
 
-    std::vector<IFrontend*> m_frontends;
-    CReadWriteLock          m_mutex;
+    std::atomic<FrontendList*>   m_list;
+    std::atomic<unsigned int>    m_readers[2]; // Readers in flight, by epoch
+    std::atomic<unsigned int>    m_epoch;
+    PLATFORM::CMutex             m_writeMutex; // Serializes writers
+    FrontendVector               m_frontendStats; // Owns the stats, guarded by m_writeMutex
+    unsigned int                 m_frontendCount;
+    FileOwnerMap                 m_fileOwners;
+    CMetadataCache               m_metadataCache;
+    CFramePool                   m_framePool;
+    uint64_t                     m_frameNumber; // Video frames produced, game thread only
+    PLATFORM::CMutex             m_fileMutex;
+    std::atomic<bool>            m_bVideoEnabled;
+    std::atomic<bool>            m_bAudioEnabled;
+    std::atomic<unsigned int>    m_videoInterval;
+    std::atomic<bool>            m_bFastForward;
+    std::atomic<bool>            m_bAsyncDispatch;
   };
 }
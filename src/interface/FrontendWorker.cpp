@@ -0,0 +1,162 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FrontendWorker.h"
+#include "IFrontend.h"
+#include "log/Log.h"
+#include "utils/CallStats.h"
+
+#include "platform/util/timeutils.h"
+
+#include <algorithm>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define AUDIO_QUEUE_SIZE       16    // Packets, several frames of audio
+#define AUDIO_MAX_BLOCK_MS     100   // Give up on a frontend that stops taking audio
+#define WORKER_WAIT_MS         100
+
+CFrontendWorker::CFrontendWorker(IFrontend* frontend, CCallStats* stats) :
+  m_frontend(frontend),
+  m_stats(stats),
+  m_video(NULL),
+  m_audio(AUDIO_QUEUE_SIZE),
+  m_droppedVideo(0),
+  m_droppedAudio(0),
+  m_averageLatencyMs(0.0),
+  m_maxLatencyMs(0.0)
+{
+}
+
+CFrontendWorker::~CFrontendWorker(void)
+{
+  Stop();
+}
+
+bool CFrontendWorker::Start(void)
+{
+  return CreateThread(false);
+}
+
+void CFrontendWorker::Stop(void)
+{
+  StopThread(-1);
+  m_workEvent.Signal();
+  StopThread();
+
+  delete m_video.exchange(NULL);
+
+  QueueItem item;
+  while (m_audio.TryPop(item)) { }
+}
+
+void CFrontendWorker::QueueVideo(const FramePtr& frame)
+{
+  QueueItem* item = new QueueItem;
+  item->frame = frame;
+  item->queuedMs = GetTimeMs();
+
+  QueueItem* stale = m_video.exchange(item);
+  if (stale)
+  {
+    m_droppedVideo++;
+    delete stale;
+  }
+
+  m_workEvent.Signal();
+}
+
+void CFrontendWorker::QueueAudio(const FramePtr& frame)
+{
+  QueueItem item;
+  item.frame = frame;
+  item.queuedMs = GetTimeMs();
+
+  while (!m_audio.TryPush(item))
+  {
+    m_workEvent.Signal();
+
+    if (IsStopped() || GetTimeMs() - item.queuedMs >= AUDIO_MAX_BLOCK_MS)
+    {
+      if (m_droppedAudio++ == 0)
+        esyslog("Frontend isn't keeping up with audio, dropping samples");
+      return;
+    }
+
+    m_spaceEvent.Wait(10);
+  }
+
+  m_workEvent.Signal();
+}
+
+void CFrontendWorker::GetLag(FrontendLag& lag)
+{
+  lag.queuedAudio = m_audio.Size();
+  lag.droppedVideo = m_droppedVideo;
+  lag.droppedAudio = m_droppedAudio;
+
+  CLockObject lock(m_latencyMutex);
+  lag.averageLatencyMs = m_averageLatencyMs;
+  lag.maxLatencyMs = m_maxLatencyMs;
+}
+
+void* CFrontendWorker::Process(void)
+{
+  while (!IsStopped())
+  {
+    m_workEvent.Wait(WORKER_WAIT_MS);
+
+    // Audio first, it's the stream that blocks the game thread
+    QueueItem audio;
+    while (!IsStopped() && m_audio.TryPop(audio))
+    {
+      m_spaceEvent.Signal();
+      {
+        CCallTimer timer(m_stats, FRONTEND_CALL_AUDIO_FRAMES);
+        m_frontend->SharedAudioFrames(audio.frame);
+      }
+      UpdateLatency(audio.queuedMs);
+    }
+    audio.frame.reset(); // Return the buffer to its pool
+
+    QueueItem* video = m_video.exchange(NULL);
+    if (video)
+    {
+      {
+        CCallTimer timer(m_stats, FRONTEND_CALL_VIDEO_FRAME);
+        m_frontend->SharedVideoFrame(video->frame);
+      }
+      UpdateLatency(video->queuedMs);
+      delete video;
+    }
+  }
+
+  return NULL;
+}
+
+void CFrontendWorker::UpdateLatency(int64_t queuedMs)
+{
+  const double latencyMs = static_cast<double>(GetTimeMs() - queuedMs);
+
+  CLockObject lock(m_latencyMutex);
+  m_averageLatencyMs += (latencyMs - m_averageLatencyMs) / 8.0;
+  m_maxLatencyMs = std::max(m_maxLatencyMs, latencyMs);
+}
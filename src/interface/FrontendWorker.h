@@ -0,0 +1,107 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "FramePool.h"
+#include "utils/SPSCQueue.h"
+
+#include "kodi/kodi_game_types.h"
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <atomic>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  class CCallStats;
+  class IFrontend;
+
+  struct FrontendLag
+  {
+    unsigned int queuedAudio;      // Audio packets waiting for delivery
+    unsigned int droppedVideo;     // Frames replaced by a newer frame before delivery
+    unsigned int droppedAudio;     // Packets dropped after blocking too long
+    double       averageLatencyMs; // Queue to delivery, smoothed
+    double       maxLatencyMs;
+  };
+
+  /*!
+   * \brief Delivers video and audio to one frontend on its own thread
+   *
+   * The game thread only queues a reference to the frame, so a slow frontend
+   * no longer sets the frame time for every other frontend.
+   *
+   * Video uses a single slot: a new frame replaces one that hasn't been
+   * delivered yet (drop-oldest). Audio can't be dropped without an audible
+   * glitch, so it goes through a bounded queue and the game thread blocks
+   * while it is full, giving up only if the frontend appears stuck.
+   */
+  class CFrontendWorker : public PLATFORM::CThread
+  {
+  public:
+    /*!
+     * \param stats Records delivery of video and audio, may be NULL
+     */
+    CFrontendWorker(IFrontend* frontend, CCallStats* stats);
+    virtual ~CFrontendWorker(void);
+
+    IFrontend* Frontend(void) const { return m_frontend; }
+
+    bool Start(void);
+    void Stop(void);
+
+    /*!
+     * \brief Producer side, must only be called from the game thread
+     */
+    void QueueVideo(const FramePtr& frame);
+    void QueueAudio(const FramePtr& frame);
+
+    void GetLag(FrontendLag& lag);
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    struct QueueItem
+    {
+      FramePtr frame;
+      int64_t  queuedMs;
+    };
+
+    void UpdateLatency(int64_t queuedMs);
+
+    IFrontend* const          m_frontend;
+    CCallStats* const         m_stats;
+
+    std::atomic<QueueItem*>   m_video;     // Latest undelivered frame
+    CSPSCQueue<QueueItem>     m_audio;
+
+    PLATFORM::CEvent          m_workEvent; // Signaled by the producer
+    PLATFORM::CEvent          m_spaceEvent; // Signaled by the worker after taking audio
+
+    std::atomic<unsigned int> m_droppedVideo;
+    std::atomic<unsigned int> m_droppedAudio;
+    double                    m_averageLatencyMs;
+    double                    m_maxLatencyMs;
+    PLATFORM::CMutex          m_latencyMutex;
+  };
+}
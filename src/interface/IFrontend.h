@@ -19,6 +19,7 @@
  */
 #pragma once
 
+#include "FramePool.h"
 #include "utils/CommonIncludes.h"
 #include "utils/Observer.h"
 
@@ -32,6 +33,49 @@ namespace NETPLAY
 {
   struct STAT_STRUCTURE;
 
+  /*!
+   * \brief Identifies each callback for call statistics
+   */
+  enum FRONTEND_CALL
+  {
+    FRONTEND_CALL_LOG,
+    FRONTEND_CALL_GET_SETTING,
+    FRONTEND_CALL_QUEUE_NOTIFICATION,
+    FRONTEND_CALL_WAKE_ON_LAN,
+    FRONTEND_CALL_UNKNOWN_TO_UTF8,
+    FRONTEND_CALL_GET_LOCALIZED_STRING,
+    FRONTEND_CALL_GET_DVD_MENU_LANGUAGE,
+    FRONTEND_CALL_OPEN_FILE,
+    FRONTEND_CALL_OPEN_FILE_FOR_WRITE,
+    FRONTEND_CALL_READ_FILE,
+    FRONTEND_CALL_READ_FILE_STRING,
+    FRONTEND_CALL_WRITE_FILE,
+    FRONTEND_CALL_FLUSH_FILE,
+    FRONTEND_CALL_SEEK_FILE,
+    FRONTEND_CALL_TRUNCATE_FILE,
+    FRONTEND_CALL_GET_FILE_POSITION,
+    FRONTEND_CALL_GET_FILE_LENGTH,
+    FRONTEND_CALL_CLOSE_FILE,
+    FRONTEND_CALL_GET_FILE_CHUNK_SIZE,
+    FRONTEND_CALL_FILE_EXISTS,
+    FRONTEND_CALL_STAT_FILE,
+    FRONTEND_CALL_DELETE_FILE,
+    FRONTEND_CALL_CAN_OPEN_DIRECTORY,
+    FRONTEND_CALL_CREATE_DIRECTORY,
+    FRONTEND_CALL_DIRECTORY_EXISTS,
+    FRONTEND_CALL_REMOVE_DIRECTORY,
+    FRONTEND_CALL_CLOSE_GAME,
+    FRONTEND_CALL_VIDEO_FRAME,
+    FRONTEND_CALL_AUDIO_FRAMES,
+    FRONTEND_CALL_HW_SET_INFO,
+    FRONTEND_CALL_HW_GET_CURRENT_FRAMEBUFFER,
+    FRONTEND_CALL_HW_GET_PROC_ADDRESS,
+    FRONTEND_CALL_OPEN_PORT,
+    FRONTEND_CALL_CLOSE_PORT,
+    FRONTEND_CALL_RUMBLE_SET_STATE,
+    FRONTEND_CALL_COUNT
+  };
+
   class IFrontend : public Observable
   {
   public:
@@ -74,6 +118,24 @@ namespace NETPLAY
     virtual void CloseGame(void) = 0;
     virtual void VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format) = 0;
     virtual void AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format) = 0;
+
+    /*!
+     * \brief Receive a frame as a shared reference
+     *
+     * Frontends that keep frames past the call (for encoding, queueing or
+     * spectators) override these to hold on to the reference instead of
+     * copying the data. By default the frame is passed to VideoFrame() and
+     * AudioFrames().
+     */
+    virtual void SharedVideoFrame(const FramePtr& frame)
+    {
+      VideoFrame(frame->data.data(), frame->data.size(), frame->width, frame->height, frame->renderFormat);
+    }
+    virtual void SharedAudioFrames(const FramePtr& frame)
+    {
+      AudioFrames(frame->data.data(), frame->data.size(), frame->frames, frame->audioFormat);
+    }
+
     virtual void HwSetInfo(const game_hw_info* hw_info) = 0;
     virtual uintptr_t HwGetCurrentFramebuffer(void) = 0;
     virtual game_proc_address_t HwGetProcAddress(const char* symbol) = 0;
@@ -19,6 +19,8 @@
  */
 #pragma once
 
+#include "StatePool.h"
+
 #include "kodi/xbmc_addon_types.h"
 #include "kodi/kodi_game_types.h"
 
@@ -26,6 +28,8 @@
 
 namespace NETPLAY
 {
+  struct GameDirectCalls;
+
   class IGame
   {
   public:
@@ -59,11 +63,60 @@ namespace NETPLAY
     virtual GAME_ERROR HwContextDestroy(void) = 0;
     virtual void UpdatePort(unsigned int port, bool connected, const game_controller* controller) = 0;
     virtual bool InputEvent(unsigned int port, const game_input_event* event) = 0;
+
+    /*!
+     * \brief Apply several input events to one port in a single call
+     *
+     * Layers that pay per call (locking, IPC, the network) override this to
+     * forward the whole batch at once. By default each event is passed to
+     * InputEvent().
+     *
+     * \return The number of events the game client handled
+     */
+    virtual unsigned int InputEvents(unsigned int port, const game_input_event* events, unsigned int count)
+    {
+      unsigned int handled = 0;
+      for (unsigned int i = 0; i < count; i++)
+      {
+        if (InputEvent(port, &events[i]))
+          handled++;
+      }
+      return handled;
+    }
+
     virtual size_t SerializeSize(void) = 0;
     virtual GAME_ERROR Serialize(uint8_t* data, size_t size) = 0;
     virtual GAME_ERROR Deserialize(const uint8_t* data, size_t size) = 0;
+
+    /*!
+     * \brief Serialize straight into a pooled buffer
+     *
+     * state is reused when it's large enough, so a caller that keeps its
+     * states (rewind, rollback) doesn't allocate once the pool is warm.
+     */
+    virtual GAME_ERROR SerializeState(CStatePool& pool, StatePtr& state)
+    {
+      const size_t size = SerializeSize();
+      if (size == 0 || !pool.Reserve(state, size))
+        return GAME_ERROR_FAILED;
+
+      return Serialize(state->data, state->size);
+    }
+
     virtual GAME_ERROR CheatReset(void) = 0;
     virtual GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size) = 0;
     virtual GAME_ERROR SetCheat(unsigned int index, bool enabled, const char* code) = 0;
+
+    // --- In-process fast path ------------------------------------------------
+
+    /*!
+     * \brief Get the entry points of the game client at the end of the chain,
+     *        if calling them directly is equivalent to calling this layer
+     *
+     * Call after a game is loaded, the entry points are invalid once it is
+     * unloaded. A layer that only sometimes needs to see calls provides a gate
+     * (see CDirectCallGate). A layer that always does returns false.
+     */
+    virtual bool GetDirectCalls(GameDirectCalls& calls) { return false; }
   };
 }
@@ -0,0 +1,189 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MemoryTracker.h"
+#include "IGame.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace NETPLAY;
+
+namespace
+{
+  bool IsBefore(const MemoryRange& a, const MemoryRange& b)
+  {
+    return a.offset < b.offset;
+  }
+
+  bool IsSameRange(const MemoryRange& a, const MemoryRange& b)
+  {
+    return a.offset == b.offset && a.length == b.length;
+  }
+}
+
+CMemoryTracker::CMemoryTracker(IGame* game) :
+  m_game(game)
+{
+}
+
+void CMemoryTracker::Track(GAME_MEMORY type, const std::vector<MemoryRange>& ranges /* = std::vector<MemoryRange>() */)
+{
+  std::vector<MemoryRange> bounds(ranges);
+  NormalizeRanges(bounds);
+
+  std::map<GAME_MEMORY, Region>::iterator it = m_regions.find(type);
+  if (it != m_regions.end() && it->second.bounds.size() == bounds.size() &&
+      std::equal(bounds.begin(), bounds.end(), it->second.bounds.begin(), IsSameRange))
+    return;
+
+  Region& region = m_regions[type];
+  region.bounds.swap(bounds);
+  region.bValid = false;
+}
+
+void CMemoryTracker::Untrack(GAME_MEMORY type)
+{
+  m_regions.erase(type);
+}
+
+void CMemoryTracker::Update(void)
+{
+  for (std::map<GAME_MEMORY, Region>::iterator it = m_regions.begin(); it != m_regions.end(); ++it)
+  {
+    Region& region = it->second;
+
+    const uint8_t* data = NULL;
+    size_t size = 0;
+    if (m_game->GetMemory(it->first, &data, &size) != GAME_ERROR_NO_ERROR || data == NULL || size == 0)
+    {
+      region.shadow.clear();
+      region.dirty.clear();
+      region.bValid = false;
+      continue;
+    }
+
+    if (!region.bValid || region.shadow.size() != size)
+    {
+      // New or resized, everything changed
+      region.shadow.assign(data, data + size);
+      region.dirty.clear();
+      if (region.bounds.empty())
+      {
+        MemoryRange all = { 0, size };
+        region.dirty.push_back(all);
+      }
+      else
+      {
+        for (std::vector<MemoryRange>::const_iterator range = region.bounds.begin(); range != region.bounds.end() && range->offset < size; ++range)
+        {
+          MemoryRange clipped = { range->offset, std::min(range->length, size - range->offset) };
+          region.dirty.push_back(clipped);
+        }
+      }
+      region.bValid = true;
+      continue;
+    }
+
+    DiffRegion(region, data, size);
+
+    for (std::vector<MemoryRange>::const_iterator range = region.dirty.begin(); range != region.dirty.end(); ++range)
+      std::memcpy(region.shadow.data() + range->offset, data + range->offset, range->length);
+  }
+}
+
+bool CMemoryTracker::GetDirtyRanges(GAME_MEMORY type, std::vector<MemoryRange>& ranges) const
+{
+  std::map<GAME_MEMORY, Region>::const_iterator it = m_regions.find(type);
+  if (it == m_regions.end() || !it->second.bValid)
+    return false;
+
+  ranges = it->second.dirty;
+  return true;
+}
+
+bool CMemoryTracker::GetShadow(GAME_MEMORY type, const uint8_t*& data, size_t& size) const
+{
+  std::map<GAME_MEMORY, Region>::const_iterator it = m_regions.find(type);
+  if (it == m_regions.end() || !it->second.bValid)
+    return false;
+
+  data = it->second.shadow.data();
+  size = it->second.shadow.size();
+  return true;
+}
+
+void CMemoryTracker::DiffRegion(Region& region, const uint8_t* data, size_t size)
+{
+  const uint8_t* shadow = region.shadow.data();
+
+  if (region.bounds.empty())
+  {
+    MemoryDiff::GetChangedRanges(shadow, data, size, region.dirty);
+  }
+  else
+  {
+    region.dirty.clear();
+
+    std::vector<MemoryRange> changed;
+    for (std::vector<MemoryRange>::const_iterator range = region.bounds.begin(); range != region.bounds.end() && range->offset < size; ++range)
+    {
+      const size_t length = std::min(range->length, size - range->offset);
+      MemoryDiff::GetChangedRanges(shadow + range->offset, data + range->offset, length, changed);
+
+      for (std::vector<MemoryRange>::iterator it = changed.begin(); it != changed.end(); ++it)
+      {
+        it->offset += range->offset;
+        region.dirty.push_back(*it);
+      }
+    }
+  }
+
+  // Ranges are whole blocks, trim them to the bytes that changed
+  for (std::vector<MemoryRange>::iterator it = region.dirty.begin(); it != region.dirty.end(); ++it)
+  {
+    while (it->length > 0 && shadow[it->offset] == data[it->offset])
+    {
+      it->offset++;
+      it->length--;
+    }
+    while (it->length > 0 && shadow[it->offset + it->length - 1] == data[it->offset + it->length - 1])
+      it->length--;
+  }
+}
+
+void CMemoryTracker::NormalizeRanges(std::vector<MemoryRange>& ranges)
+{
+  std::sort(ranges.begin(), ranges.end(), IsBefore);
+
+  std::vector<MemoryRange> merged;
+  for (std::vector<MemoryRange>::const_iterator it = ranges.begin(); it != ranges.end(); ++it)
+  {
+    if (it->length == 0)
+      continue;
+
+    if (!merged.empty() && it->offset <= merged.back().offset + merged.back().length)
+      merged.back().length = std::max(merged.back().offset + merged.back().length, it->offset + it->length) - merged.back().offset;
+    else
+      merged.push_back(*it);
+  }
+
+  ranges.swap(merged);
+}
@@ -0,0 +1,95 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "utils/MemoryDiff.h"
+
+#include "kodi/kodi_game_types.h"
+
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace NETPLAY
+{
+  class IGame;
+
+  /*!
+   * \brief Finds what changed in the game's memory regions since the last
+   *        frame
+   *
+   * Keeps a shadow copy of each tracked region. Update() diffs the regions
+   * against their shadows once per frame and brings the shadows up to date,
+   * so everything that wants to know what changed can share one scan.
+   */
+  class CMemoryTracker
+  {
+  public:
+    CMemoryTracker(IGame* game);
+
+    /*!
+     * \brief Start tracking a region, the first update reports all of it
+     *
+     * \param ranges Only diff these parts of the region, or all of it if empty.
+     *        Changing them restarts tracking of the region.
+     */
+    void Track(GAME_MEMORY type, const std::vector<MemoryRange>& ranges = std::vector<MemoryRange>());
+    void Untrack(GAME_MEMORY type);
+    bool IsTracked(GAME_MEMORY type) const { return m_regions.find(type) != m_regions.end(); }
+
+    /*!
+     * \brief Diff every tracked region, call once after each frame
+     */
+    void Update(void);
+
+    /*!
+     * \brief Get the ranges that changed in the last update
+     * \return false if the region isn't tracked or the game doesn't expose it
+     */
+    bool GetDirtyRanges(GAME_MEMORY type, std::vector<MemoryRange>& ranges) const;
+
+    /*!
+     * \brief Get the region's contents as of the last update
+     */
+    bool GetShadow(GAME_MEMORY type, const uint8_t*& data, size_t& size) const;
+
+    /*!
+     * \brief Sort ranges and merge the ones that overlap or touch
+     */
+    static void NormalizeRanges(std::vector<MemoryRange>& ranges);
+
+  private:
+    struct Region;
+
+    static void DiffRegion(Region& region, const uint8_t* data, size_t size);
+
+    struct Region
+    {
+      std::vector<uint8_t>     shadow;
+      std::vector<MemoryRange> dirty;
+      std::vector<MemoryRange> bounds;  // Sorted and disjoint, empty for everything
+      bool                     bValid;  // The game exposed the region in the last update
+    };
+
+    IGame* const                  m_game;
+    std::map<GAME_MEMORY, Region> m_regions;
+  };
+}
@@ -0,0 +1,319 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RewindBuffer.h"
+#include "IGame.h"
+#include "log/Log.h"
+#include "utils/MemoryDiff.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <sys/mman.h>
+#endif
+
+#include <chrono>
+#include <cstring>
+
+using namespace NETPLAY;
+
+#define DELTA_WORD        sizeof(uint64_t)
+#define DELTA_TOKEN_SIZE  (2 * sizeof(uint32_t)) // Bytes skipped, bytes copied
+
+namespace NETPLAY
+{
+  inline size_t AlignRecord(size_t length)
+  {
+    return (length + DELTA_WORD - 1) & ~(DELTA_WORD - 1);
+  }
+
+  inline uint64_t LoadWord(const uint8_t* data)
+  {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+  }
+}
+
+CRewindBuffer::CRewindBuffer(size_t capacity, unsigned int captureInterval /* = 1 */, unsigned int keyframeInterval /* = 120 */) :
+  m_ring(NULL),
+  m_capacity(AlignRecord(capacity)),
+  m_head(0),
+  m_captureInterval(captureInterval > 0 ? captureInterval : 1),
+  m_keyframeInterval(keyframeInterval > 0 ? keyframeInterval : 1),
+  m_sinceKeyframe(0),
+  m_lastFrame(0),
+  m_pool(2),
+  m_averageCaptureUs(0.0)
+{
+  // Pages are only backed by memory once the ring first reaches them
+#if defined(_WIN32)
+  m_ring = static_cast<uint8_t*>(VirtualAlloc(NULL, m_capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+#else
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  #if defined(MAP_NORESERVE)
+    flags |= MAP_NORESERVE;
+  #endif
+  void* ring = mmap(NULL, m_capacity, PROT_READ | PROT_WRITE, flags, -1, 0);
+  if (ring != MAP_FAILED)
+    m_ring = static_cast<uint8_t*>(ring);
+#endif
+
+  if (m_ring == NULL)
+    esyslog("Failed to map %u bytes for rewind", static_cast<unsigned int>(m_capacity));
+}
+
+CRewindBuffer::~CRewindBuffer(void)
+{
+  if (m_ring != NULL)
+  {
+#if defined(_WIN32)
+    VirtualFree(m_ring, 0, MEM_RELEASE);
+#else
+    munmap(m_ring, m_capacity);
+#endif
+  }
+}
+
+bool CRewindBuffer::Capture(IGame* game, uint64_t frame)
+{
+  if (m_ring == NULL || game == NULL)
+    return false;
+
+  if (!m_records.empty() && frame < m_lastFrame + m_captureInterval)
+    return false;
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  if (game->SerializeState(m_pool, m_next) != GAME_ERROR_NO_ERROR)
+    return false;
+
+  const size_t size = m_next->size;
+
+  // Reserve enough for a full state, a delta that doesn't fit is stored in full
+  size_t offset;
+  if (!Allocate(size, offset))
+  {
+    esyslog("Rewind buffer is too small for a %u byte state", static_cast<unsigned int>(size));
+    Clear();
+    return false;
+  }
+
+  bool bKeyframe = m_records.empty() || !m_current || m_current->size != size ||
+                   m_sinceKeyframe + 1 >= m_keyframeInterval;
+
+  size_t length = 0;
+  if (bKeyframe || !EncodeDelta(m_current->data, m_next->data, size, m_ring + offset, size, length))
+  {
+    std::memcpy(m_ring + offset, m_next->data, size);
+    length = size;
+    bKeyframe = true;
+  }
+
+  Record record;
+  record.offset    = offset;
+  record.length    = length;
+  record.stateSize = size;
+  record.frame     = frame;
+  record.bKeyframe = bKeyframe;
+  m_records.push_back(record);
+
+  m_head = offset + AlignRecord(length);
+  m_sinceKeyframe = bKeyframe ? 0 : m_sinceKeyframe + 1;
+  m_lastFrame = frame;
+  m_current.swap(m_next);
+
+  const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  m_averageCaptureUs += (elapsedUs - m_averageCaptureUs) / 64.0;
+
+  return true;
+}
+
+bool CRewindBuffer::Rewind(IGame* game, unsigned int steps, uint64_t& frame)
+{
+  if (game == NULL || steps == 0 || m_records.size() < 2)
+    return false;
+
+  while (steps-- > 0 && m_records.size() > 1)
+  {
+    const Record newest = m_records.back();
+    m_records.pop_back();
+
+    // XOR is its own inverse, so the delta to a state also leads back from it
+    if (!newest.bKeyframe)
+      ApplyDelta(m_ring + newest.offset, newest.length, m_current->data, m_current->size);
+    else if (!Decode(m_records.size() - 1, m_current))
+    {
+      esyslog("Failed to decode rewind state for frame %llu", static_cast<unsigned long long>(m_records.back().frame));
+      Clear();
+      return false;
+    }
+
+    m_head = newest.offset;
+  }
+
+  m_sinceKeyframe = 0;
+  for (std::deque<Record>::const_reverse_iterator it = m_records.rbegin(); it != m_records.rend() && !it->bKeyframe; ++it)
+    m_sinceKeyframe++;
+
+  m_lastFrame = m_records.back().frame;
+  frame = m_lastFrame;
+
+  return game->Deserialize(m_current->data, m_current->size) == GAME_ERROR_NO_ERROR;
+}
+
+void CRewindBuffer::Clear(void)
+{
+  m_records.clear();
+  m_head = 0;
+  m_sinceKeyframe = 0;
+  m_lastFrame = 0;
+  m_current.reset();
+}
+
+void CRewindBuffer::GetStats(RewindStats& stats) const
+{
+  stats.states = m_records.size();
+  stats.keyframes = 0;
+  stats.oldestFrame = m_records.empty() ? 0 : m_records.front().frame;
+  stats.usedBytes = 0;
+  stats.capacityBytes = m_capacity;
+  stats.averageCaptureUs = m_averageCaptureUs;
+
+  for (std::deque<Record>::const_iterator it = m_records.begin(); it != m_records.end(); ++it)
+  {
+    if (it->bKeyframe)
+      stats.keyframes++;
+    stats.usedBytes += it->length;
+  }
+}
+
+bool CRewindBuffer::Allocate(size_t length, size_t& offset)
+{
+  length = AlignRecord(length);
+  if (length > m_capacity)
+    return false;
+
+  size_t start = m_head;
+  if (start + length > m_capacity)
+  {
+    // Records between the head and the end of the ring are the oldest, and
+    // would be out of order once newer records are written at the start
+    while (!m_records.empty() && m_records.front().offset >= m_head)
+      m_records.pop_front();
+    start = 0;
+  }
+
+  while (!m_records.empty())
+  {
+    const Record& oldest = m_records.front();
+    if (oldest.offset >= start + length || oldest.offset + oldest.length <= start)
+      break;
+    m_records.pop_front();
+  }
+
+  // Deltas can't be decoded without the keyframe before them
+  while (!m_records.empty() && !m_records.front().bKeyframe)
+    m_records.pop_front();
+
+  offset = start;
+  return true;
+}
+
+bool CRewindBuffer::Decode(size_t index, StatePtr& state)
+{
+  size_t keyframe = index;
+  while (!m_records[keyframe].bKeyframe)
+    keyframe--;
+
+  const Record& key = m_records[keyframe];
+  if (!m_pool.Reserve(state, key.stateSize))
+    return false;
+
+  std::memcpy(state->data, m_ring + key.offset, key.stateSize);
+
+  for (size_t i = keyframe + 1; i <= index; i++)
+    ApplyDelta(m_ring + m_records[i].offset, m_records[i].length, state->data, state->size);
+
+  return true;
+}
+
+bool CRewindBuffer::EncodeDelta(const uint8_t* prev, const uint8_t* next, size_t size, uint8_t* out, size_t limit, size_t& length)
+{
+  length = 0;
+
+  size_t offset = 0;
+  while (offset < size)
+  {
+    const size_t start = offset + MemoryDiff::FindDifference(prev + offset, next + offset, size - offset);
+    if (start >= size)
+      break;
+
+    const size_t end = start + MemoryDiff::FindMatch(prev + start, next + start, size - start);
+
+    const uint32_t token[2] = { static_cast<uint32_t>(start - offset), static_cast<uint32_t>(end - start) };
+    if (length + DELTA_TOKEN_SIZE + token[1] > limit)
+      return false;
+
+    std::memcpy(out + length, token, DELTA_TOKEN_SIZE);
+    length += DELTA_TOKEN_SIZE;
+
+    Xor(prev + start, next + start, out + length, token[1]);
+    length += token[1];
+
+    offset = end;
+  }
+
+  return true;
+}
+
+void CRewindBuffer::ApplyDelta(const uint8_t* delta, size_t length, uint8_t* state, size_t size)
+{
+  const uint8_t* const end = delta + length;
+
+  size_t offset = 0;
+  while (delta + DELTA_TOKEN_SIZE <= end)
+  {
+    uint32_t token[2];
+    std::memcpy(token, delta, DELTA_TOKEN_SIZE);
+    delta += DELTA_TOKEN_SIZE;
+
+    offset += token[0];
+    if (offset + token[1] > size || delta + token[1] > end)
+      break;
+
+    Xor(state + offset, delta, state + offset, token[1]);
+    delta += token[1];
+    offset += token[1];
+  }
+}
+
+void CRewindBuffer::Xor(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t size)
+{
+  size_t i = 0;
+  for (; i + DELTA_WORD <= size; i += DELTA_WORD)
+  {
+    const uint64_t value = LoadWord(a + i) ^ LoadWord(b + i);
+    std::memcpy(out + i, &value, DELTA_WORD);
+  }
+
+  for (; i < size; i++)
+    out[i] = a[i] ^ b[i];
+}
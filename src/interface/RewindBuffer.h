@@ -0,0 +1,137 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "StatePool.h"
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  class IGame;
+
+  struct RewindStats
+  {
+    unsigned int states;        // States that can be stepped back through
+    unsigned int keyframes;
+    uint64_t     oldestFrame;
+    size_t       usedBytes;     // Ring bytes holding states
+    size_t       capacityBytes;
+    double       averageCaptureUs;
+  };
+
+  /*!
+   * \brief History of savestates for stepping the game backwards
+   *
+   * States are kept in a fixed-size ring of memory mapped when the buffer is
+   * created, so the history never costs more than its capacity. Most states
+   * are stored as the XOR of the state and its predecessor with unchanged
+   * ranges left out, which is usually a small fraction of a full state. The
+   * newest state is kept in full, so stepping back one state is a single
+   * pass over its delta. Every keyframeInterval states (or when a delta
+   * wouldn't be smaller) a full state is stored instead, which bounds how far
+   * a state is from one that can be decoded directly. When the ring is full,
+   * the oldest states are dropped up to the next keyframe.
+   */
+  class CRewindBuffer
+  {
+  public:
+    /*!
+     * \param capacity Bytes of history
+     * \param captureInterval Capture one state every N frames
+     * \param keyframeInterval Store a full state every N captures
+     */
+    CRewindBuffer(size_t capacity, unsigned int captureInterval = 1, unsigned int keyframeInterval = 120);
+    ~CRewindBuffer(void);
+
+    bool IsValid(void) const { return m_ring != NULL; }
+
+    /*!
+     * \brief Capture the game's state if it's time to
+     *
+     * Call once per frame, after the frame has run.
+     */
+    bool Capture(IGame* game, uint64_t frame);
+
+    /*!
+     * \brief Load the state captured a number of captures ago
+     *
+     * \param frame The frame the loaded state was captured at
+     * \return false if there is no older state to step back to
+     */
+    bool Rewind(IGame* game, unsigned int steps, uint64_t& frame);
+
+    void Clear(void);
+
+    void GetStats(RewindStats& stats) const;
+
+  private:
+    struct Record
+    {
+      size_t   offset;   // Position in the ring
+      size_t   length;   // Encoded bytes
+      size_t   stateSize;
+      uint64_t frame;
+      bool     bKeyframe;
+    };
+
+    /*!
+     * \brief Make room for a record of the given size
+     * \return false if the record is larger than the ring
+     */
+    bool Allocate(size_t length, size_t& offset);
+
+    /*!
+     * \brief Rebuild the state of a record from the keyframe before it
+     */
+    bool Decode(size_t index, StatePtr& state);
+
+    /*!
+     * \brief Write only the ranges that differ between two states, XORed
+     * \return false if the delta exceeds limit
+     */
+    static bool EncodeDelta(const uint8_t* prev, const uint8_t* next, size_t size, uint8_t* out, size_t limit, size_t& length);
+
+    /*!
+     * \brief XOR a delta into a state, turning it into the state on the other
+     *        side of the delta
+     */
+    static void ApplyDelta(const uint8_t* delta, size_t length, uint8_t* state, size_t size);
+
+    static void Xor(const uint8_t* a, const uint8_t* b, uint8_t* out, size_t size);
+
+    uint8_t*            m_ring;
+    size_t              m_capacity;
+    size_t              m_head;      // Where the next record is written
+    std::deque<Record>  m_records;   // Oldest first, the first is always a keyframe
+
+    const unsigned int  m_captureInterval;
+    const unsigned int  m_keyframeInterval;
+    unsigned int        m_sinceKeyframe;
+    uint64_t            m_lastFrame;
+
+    CStatePool          m_pool;
+    StatePtr            m_current;   // The newest state in full
+    StatePtr            m_next;      // Capture target, swapped with m_current
+    double              m_averageCaptureUs;
+  };
+}
@@ -0,0 +1,268 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RunAheadGame.h"
+#include "FrontendManager.h"
+#include "log/Log.h"
+
+using namespace NETPLAY;
+
+#define MAX_STATES  2 // The state in use and one being returned
+
+CRunAheadGame::CRunAheadGame(IGame* game, CFrontendManager* callbacks, unsigned int frames, IGame* secondary /* = NULL */) :
+  m_game(game),
+  m_secondary(secondary),
+  m_callbacks(callbacks),
+  m_frames(frames),
+  m_pool(MAX_STATES),
+  m_bSecondaryLoaded(false),
+  m_secondaryAhead(0),
+  m_bInputChanged(false)
+{
+}
+
+CRunAheadGame::~CRunAheadGame(void)
+{
+  delete m_secondary;
+  delete m_game;
+}
+
+ADDON_STATUS CRunAheadGame::Initialize(void)
+{
+  ADDON_STATUS status = m_game->Initialize();
+  if (status == ADDON_STATUS_UNKNOWN || status == ADDON_STATUS_PERMANENT_FAILURE)
+    return status;
+
+  if (m_secondary)
+  {
+    ADDON_STATUS secondaryStatus = m_secondary->Initialize();
+    if (secondaryStatus == ADDON_STATUS_UNKNOWN || secondaryStatus == ADDON_STATUS_PERMANENT_FAILURE)
+    {
+      esyslog("Failed to initialize second instance, running ahead on the main instance");
+      delete m_secondary;
+      m_secondary = NULL;
+    }
+  }
+
+  return status;
+}
+
+void CRunAheadGame::Deinitialize(void)
+{
+  if (m_secondary)
+    m_secondary->Deinitialize();
+  m_game->Deinitialize();
+}
+
+void CRunAheadGame::Stop(void)
+{
+  if (m_secondary)
+    m_secondary->Stop();
+  m_game->Stop();
+}
+
+ADDON_STATUS CRunAheadGame::SetSetting(const char* settingName, const void* settingValue)
+{
+  if (m_secondary)
+    m_secondary->SetSetting(settingName, settingValue);
+  return m_game->SetSetting(settingName, settingValue);
+}
+
+GAME_ERROR CRunAheadGame::LoadGame(const char* url)
+{
+  GAME_ERROR error = m_game->LoadGame(url);
+  if (error == GAME_ERROR_NO_ERROR && m_secondary)
+  {
+    m_bSecondaryLoaded = (m_secondary->LoadGame(url) == GAME_ERROR_NO_ERROR);
+    if (!m_bSecondaryLoaded)
+      esyslog("Second instance failed to load %s", url);
+  }
+  m_secondaryAhead = 0;
+  return error;
+}
+
+GAME_ERROR CRunAheadGame::LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount)
+{
+  GAME_ERROR error = m_game->LoadGameSpecial(type, urls, urlCount);
+  if (error == GAME_ERROR_NO_ERROR && m_secondary)
+  {
+    m_bSecondaryLoaded = (m_secondary->LoadGameSpecial(type, urls, urlCount) == GAME_ERROR_NO_ERROR);
+    if (!m_bSecondaryLoaded)
+      esyslog("Second instance failed to load game");
+  }
+  m_secondaryAhead = 0;
+  return error;
+}
+
+GAME_ERROR CRunAheadGame::LoadStandalone(void)
+{
+  // A standalone game comes from the network, there's no content for the
+  // second instance to load
+  m_bSecondaryLoaded = false;
+  m_secondaryAhead = 0;
+  return m_game->LoadStandalone();
+}
+
+GAME_ERROR CRunAheadGame::UnloadGame(void)
+{
+  if (m_bSecondaryLoaded)
+  {
+    m_secondary->UnloadGame();
+    m_bSecondaryLoaded = false;
+  }
+  m_secondaryAhead = 0;
+  m_state.reset();
+  return m_game->UnloadGame();
+}
+
+void CRunAheadGame::FrameEvent(void)
+{
+  const unsigned int frames = m_frames;
+
+  // Nothing to show while the caller suppresses video (e.g. catching up)
+  if (frames == 0 || !m_callbacks->IsVideoEnabled())
+  {
+    m_game->FrameEvent();
+    m_secondaryAhead = 0;
+    return;
+  }
+
+  const bool bAudioEnabled = m_callbacks->IsAudioEnabled();
+
+  // The real frame: keep its audio, the frame ahead supplies the picture
+  m_callbacks->SetVideoEnabled(false);
+  m_game->FrameEvent();
+  m_callbacks->SetAudioEnabled(false);
+
+  if (!m_bSecondaryLoaded || !RunAheadSecondary(frames))
+    RunAhead(frames);
+
+  m_callbacks->SetVideoEnabled(true);
+  m_callbacks->SetAudioEnabled(bAudioEnabled);
+}
+
+void CRunAheadGame::RunAhead(unsigned int frames)
+{
+  if (m_game->SerializeState(m_pool, m_state) != GAME_ERROR_NO_ERROR)
+  {
+    esyslog("Game can't be serialized, disabling run-ahead");
+    m_frames = 0;
+    return;
+  }
+
+  for (unsigned int i = 1; i < frames; i++)
+    m_game->FrameEvent();
+
+  PresentFrame(m_game);
+
+  if (m_game->Deserialize(m_state->data, m_state->size) != GAME_ERROR_NO_ERROR)
+  {
+    esyslog("Failed to restore state, disabling run-ahead");
+    m_frames = 0;
+  }
+}
+
+bool CRunAheadGame::RunAheadSecondary(unsigned int frames)
+{
+  // Without new input, the frames run ahead last time are still correct
+  const bool bInputChanged = m_bInputChanged.exchange(false);
+  if (bInputChanged || m_secondaryAhead != frames)
+  {
+    if (m_game->SerializeState(m_pool, m_state) != GAME_ERROR_NO_ERROR ||
+        m_secondary->Deserialize(m_state->data, m_state->size) != GAME_ERROR_NO_ERROR)
+    {
+      esyslog("Failed to synchronize second instance, running ahead on the main instance");
+      m_bSecondaryLoaded = false;
+      m_secondaryAhead = 0;
+      return false;
+    }
+
+    for (unsigned int i = 1; i < frames; i++)
+      m_secondary->FrameEvent();
+
+    m_secondaryAhead = frames;
+  }
+
+  PresentFrame(m_secondary);
+
+  return true;
+}
+
+void CRunAheadGame::PresentFrame(IGame* game)
+{
+  m_callbacks->SetVideoEnabled(true);
+  game->FrameEvent();
+  m_callbacks->SetVideoEnabled(false);
+}
+
+GAME_ERROR CRunAheadGame::Reset(void)
+{
+  if (m_bSecondaryLoaded)
+    m_secondary->Reset();
+  m_secondaryAhead = 0;
+  return m_game->Reset();
+}
+
+void CRunAheadGame::UpdatePort(unsigned int port, bool connected, const game_controller* controller)
+{
+  if (m_secondary)
+    m_secondary->UpdatePort(port, connected, controller);
+  m_bInputChanged = true;
+  m_game->UpdatePort(port, connected, controller);
+}
+
+bool CRunAheadGame::InputEvent(unsigned int port, const game_input_event* event)
+{
+  // Input state may not be part of a savestate, so both instances see it
+  if (m_bSecondaryLoaded)
+    m_secondary->InputEvent(port, event);
+  m_bInputChanged = true;
+  return m_game->InputEvent(port, event);
+}
+
+unsigned int CRunAheadGame::InputEvents(unsigned int port, const game_input_event* events, unsigned int count)
+{
+  if (m_bSecondaryLoaded)
+    m_secondary->InputEvents(port, events, count);
+  m_bInputChanged = true;
+  return m_game->InputEvents(port, events, count);
+}
+
+GAME_ERROR CRunAheadGame::Deserialize(const uint8_t* data, size_t size)
+{
+  m_secondaryAhead = 0;
+  return m_game->Deserialize(data, size);
+}
+
+GAME_ERROR CRunAheadGame::CheatReset(void)
+{
+  if (m_bSecondaryLoaded)
+    m_secondary->CheatReset();
+  m_secondaryAhead = 0;
+  return m_game->CheatReset();
+}
+
+GAME_ERROR CRunAheadGame::SetCheat(unsigned int index, bool enabled, const char* code)
+{
+  if (m_bSecondaryLoaded)
+    m_secondary->SetCheat(index, enabled, code);
+  m_secondaryAhead = 0;
+  return m_game->SetCheat(index, enabled, code);
+}
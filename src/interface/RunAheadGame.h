@@ -0,0 +1,119 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "IGame.h"
+#include "StatePool.h"
+
+#include <atomic>
+
+namespace NETPLAY
+{
+  class CFrontendManager;
+
+  /*!
+   * \brief Game client wrapper that hides the game's internal input lag
+   *
+   * Many games only react to input a frame or more after it arrives. Each
+   * frame, run-ahead advances the game by one frame with video suppressed
+   * (its audio is played), saves the state, runs N - 1 more frames silently
+   * and shows the video of the last one. It then restores the saved state.
+   * The picture on screen is N frames ahead of the game, so input shows up
+   * N frames sooner.
+   *
+   * With a second instance, the frames ahead are run on a separate copy of
+   * the game client instead. The main instance is never rolled back, and
+   * the second instance only needs to be resynchronized when input changes.
+   * When it doesn't, the ahead state is still correct and simply advances.
+   */
+  class CRunAheadGame : public IGame
+  {
+  public:
+    /*!
+     * \brief Take ownership of a game client, and optionally of a second
+     *        instance of it
+     *
+     * \param frames Frames to run ahead, 0 to disable
+     * \param secondary Separate instance of the same game client, may be NULL
+     */
+    CRunAheadGame(IGame* game, CFrontendManager* callbacks, unsigned int frames, IGame* secondary = NULL);
+    virtual ~CRunAheadGame(void);
+
+    void SetFrames(unsigned int frames) { m_frames = frames; }
+
+    // implementation of IGame
+    virtual ADDON_STATUS Initialize(void);
+    virtual void         Deinitialize(void);
+    virtual void         Stop(void);
+    virtual ADDON_STATUS GetStatus(void) { return m_game->GetStatus(); }
+    virtual bool         HasSettings(void) { return m_game->HasSettings(); }
+    virtual unsigned int GetSettings(ADDON_StructSetting*** sSet) { return m_game->GetSettings(sSet); }
+    virtual ADDON_STATUS SetSetting(const char* settingName, const void* settingValue);
+    virtual void         FreeSettings(void) { m_game->FreeSettings(); }
+    virtual void         Announce(const char* flag, const char* sender, const char* message, const void* data) { m_game->Announce(flag, sender, message, data); }
+    virtual std::string GetGameAPIVersion(void) { return m_game->GetGameAPIVersion(); }
+    virtual std::string GetMininumGameAPIVersion(void) { return m_game->GetMininumGameAPIVersion(); }
+    virtual GAME_ERROR LoadGame(const char* url);
+    virtual GAME_ERROR LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount);
+    virtual GAME_ERROR LoadStandalone(void);
+    virtual GAME_ERROR UnloadGame(void);
+    virtual GAME_ERROR GetGameInfo(game_system_av_info* info) { return m_game->GetGameInfo(info); }
+    virtual GAME_REGION GetRegion(void) { return m_game->GetRegion(); }
+    virtual void FrameEvent(void);
+    virtual GAME_ERROR Reset(void);
+    virtual GAME_ERROR HwContextReset(void) { return m_game->HwContextReset(); }
+    virtual GAME_ERROR HwContextDestroy(void) { return m_game->HwContextDestroy(); }
+    virtual void UpdatePort(unsigned int port, bool connected, const game_controller* controller);
+    virtual bool InputEvent(unsigned int port, const game_input_event* event);
+    virtual unsigned int InputEvents(unsigned int port, const game_input_event* events, unsigned int count);
+    virtual size_t SerializeSize(void) { return m_game->SerializeSize(); }
+    virtual GAME_ERROR Serialize(uint8_t* data, size_t size) { return m_game->Serialize(data, size); }
+    virtual GAME_ERROR Deserialize(const uint8_t* data, size_t size);
+    virtual GAME_ERROR CheatReset(void);
+    virtual GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size) { return m_game->GetMemory(type, data, size); }
+    virtual GAME_ERROR SetCheat(unsigned int index, bool enabled, const char* code);
+
+  private:
+    /*!
+     * \brief Run ahead on the main instance and roll it back
+     */
+    void RunAhead(unsigned int frames);
+
+    /*!
+     * \brief Run ahead on the second instance
+     * \return false if it couldn't be synchronized with the main instance
+     */
+    bool RunAheadSecondary(unsigned int frames);
+
+    void PresentFrame(IGame* game);
+
+    IGame* const              m_game;
+    IGame*                    m_secondary;         // NULL if not used or failed
+    CFrontendManager* const   m_callbacks;
+    std::atomic<unsigned int> m_frames;
+
+    CStatePool                m_pool;
+    StatePtr                  m_state;             // Reused every frame
+
+    bool                      m_bSecondaryLoaded;
+    std::atomic<unsigned int> m_secondaryAhead;    // Frames the second instance is ahead, 0 if out of sync
+    std::atomic<bool>         m_bInputChanged;     // Since the second instance was synchronized
+  };
+}
@@ -0,0 +1,157 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "StatePool.h"
+#include "log/Log.h"
+
+#if defined(_WIN32)
+  #include <malloc.h>
+#else
+  #include <stdlib.h>
+#endif
+
+#include <iterator>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define STATE_PAGE_SIZE  4096
+
+void StateDeleter::operator()(StateBuffer* buffer) const
+{
+  if (freeList)
+  {
+    CLockObject lock(freeList->mutex);
+
+    if (freeList->buffers.size() < freeList->maxFree)
+    {
+      freeList->buffers.push_back(buffer);
+      return;
+    }
+  }
+
+  StateFreeList::Free(buffer);
+}
+
+StateFreeList::~StateFreeList(void)
+{
+  for (std::vector<StateBuffer*>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+    Free(*it);
+}
+
+StateBuffer* StateFreeList::Allocate(size_t size)
+{
+  const size_t capacity = (size + STATE_PAGE_SIZE - 1) / STATE_PAGE_SIZE * STATE_PAGE_SIZE;
+
+  void* data = NULL;
+#if defined(_WIN32)
+  data = _aligned_malloc(capacity, STATE_PAGE_SIZE);
+#else
+  if (posix_memalign(&data, STATE_PAGE_SIZE, capacity) != 0)
+    data = NULL;
+#endif
+
+  if (data == NULL)
+  {
+    esyslog("Failed to allocate %u byte savestate", static_cast<unsigned int>(capacity));
+    return NULL;
+  }
+
+  StateBuffer* buffer = new StateBuffer;
+  buffer->data = static_cast<uint8_t*>(data);
+  buffer->size = size;
+  buffer->capacity = capacity;
+
+  return buffer;
+}
+
+void StateFreeList::Free(StateBuffer* buffer)
+{
+#if defined(_WIN32)
+  _aligned_free(buffer->data);
+#else
+  free(buffer->data);
+#endif
+  delete buffer;
+}
+
+CStatePool::CStatePool(unsigned int maxFree /* = 8 */) :
+  m_freeList(std::make_shared<StateFreeList>())
+{
+  m_freeList->maxFree = maxFree;
+  m_freeList->buffers.reserve(maxFree);
+}
+
+StatePtr CStatePool::Acquire(size_t size)
+{
+  StateBuffer* buffer = NULL;
+  StateBuffer* tooSmall = NULL;
+  {
+    CLockObject lock(m_freeList->mutex);
+
+    for (std::vector<StateBuffer*>::reverse_iterator it = m_freeList->buffers.rbegin(); it != m_freeList->buffers.rend(); ++it)
+    {
+      if ((*it)->capacity >= size)
+      {
+        buffer = *it;
+        m_freeList->buffers.erase(std::next(it).base());
+        break;
+      }
+    }
+
+    // The state grew. Retire the oldest buffer so the pool doesn't fill up
+    // with buffers that no longer fit.
+    if (buffer == NULL && !m_freeList->buffers.empty())
+    {
+      tooSmall = m_freeList->buffers.front();
+      m_freeList->buffers.erase(m_freeList->buffers.begin());
+    }
+  }
+
+  if (tooSmall)
+    StateFreeList::Free(tooSmall);
+
+  if (buffer == NULL)
+  {
+    buffer = StateFreeList::Allocate(size);
+    if (buffer == NULL)
+      return StatePtr();
+  }
+
+  buffer->size = size;
+
+  StateDeleter deleter;
+  deleter.freeList = m_freeList;
+
+  return StatePtr(buffer, deleter);
+}
+
+bool CStatePool::Reserve(StatePtr& state, size_t size)
+{
+  if (state && state->capacity >= size)
+  {
+    state->size = size;
+    return true;
+  }
+
+  state = Acquire(size);
+
+  return state.get() != NULL;
+}
@@ -0,0 +1,105 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "platform/threads/mutex.h"
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief A savestate. The data is page-aligned, and capacity is rounded up
+   *        to whole pages.
+   */
+  struct StateBuffer
+  {
+    uint8_t* data;
+    size_t   size;     // Bytes of state
+    size_t   capacity; // Bytes allocated
+  };
+
+  struct StateFreeList;
+
+  /*!
+   * \brief Returns a state buffer to the pool it came from
+   */
+  struct StateDeleter
+  {
+    std::shared_ptr<StateFreeList> freeList;
+
+    void operator()(StateBuffer* buffer) const;
+  };
+
+  /*!
+   * \brief Owning reference to a pooled state buffer. Unlike a shared_ptr,
+   *        passing one around never allocates.
+   */
+  typedef std::unique_ptr<StateBuffer, StateDeleter> StatePtr;
+
+  /*!
+   * \brief Recycles savestate buffers so that taking a state every frame
+   *        (rewind, rollback) doesn't allocate once the pool is warm
+   *
+   * Buffers can be released from any thread, and may outlive the pool.
+   */
+  class CStatePool
+  {
+  public:
+    /*!
+     * \param maxFree Buffers kept for reuse, size it to the states in flight
+     */
+    CStatePool(unsigned int maxFree = 8);
+
+    /*!
+     * \brief Get a buffer that can hold at least size bytes
+     *
+     * The buffer's size is set to the requested size. Its contents are
+     * undefined.
+     *
+     * \return The buffer, or an empty pointer if allocation failed
+     */
+    StatePtr Acquire(size_t size);
+
+    /*!
+     * \brief Make state hold size bytes, keeping its buffer if it's large
+     *        enough and acquiring a new one otherwise
+     */
+    bool Reserve(StatePtr& state, size_t size);
+
+  private:
+    std::shared_ptr<StateFreeList> m_freeList;
+  };
+
+  struct StateFreeList
+  {
+    std::vector<StateBuffer*> buffers;
+    unsigned int              maxFree;
+    PLATFORM::CMutex          mutex;
+
+    ~StateFreeList(void);
+
+    static StateBuffer* Allocate(size_t size);
+    static void Free(StateBuffer* buffer);
+  };
+}
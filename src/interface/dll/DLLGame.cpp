@@ -21,14 +21,22 @@
 #include "DLLGame.h"
 #include "FrontendCallbackLib.h"
 #include "log/Log.h"
+#include "utils/PathUtils.h"
+
+#include <thread>
 
 #ifdef _WIN32
   #include "dlfcn-win32.h"
+  #include <windows.h>
 #else
   #include <dlfcn.h>
+  #include <fcntl.h>
+  #include <stdlib.h>
+  #include <unistd.h>
 #endif
 
 using namespace NETPLAY;
+using namespace PLATFORM;
 
 // --- REGISTER_SYMBOL() macro -------------------------------------------------
 
@@ -44,15 +52,99 @@ namespace NETPLAY
   }
 }
 
+// --- Call statistics ---------------------------------------------------------
+
+namespace NETPLAY
+{
+  enum GAME_CALL
+  {
+    GAME_CALL_STOP,
+    GAME_CALL_GET_STATUS,
+    GAME_CALL_HAS_SETTINGS,
+    GAME_CALL_GET_SETTINGS,
+    GAME_CALL_SET_SETTING,
+    GAME_CALL_FREE_SETTINGS,
+    GAME_CALL_ANNOUNCE,
+    GAME_CALL_GET_GAME_API_VERSION,
+    GAME_CALL_GET_MININUM_GAME_API_VERSION,
+    GAME_CALL_LOAD_GAME,
+    GAME_CALL_LOAD_GAME_SPECIAL,
+    GAME_CALL_LOAD_STANDALONE,
+    GAME_CALL_UNLOAD_GAME,
+    GAME_CALL_GET_GAME_INFO,
+    GAME_CALL_GET_REGION,
+    GAME_CALL_FRAME_EVENT,
+    GAME_CALL_RESET,
+    GAME_CALL_HW_CONTEXT_RESET,
+    GAME_CALL_HW_CONTEXT_DESTROY,
+    GAME_CALL_UPDATE_PORT,
+    GAME_CALL_INPUT_EVENT,
+    GAME_CALL_INPUT_EVENTS,
+    GAME_CALL_SERIALIZE_SIZE,
+    GAME_CALL_SERIALIZE,
+    GAME_CALL_DESERIALIZE,
+    GAME_CALL_CHEAT_RESET,
+    GAME_CALL_GET_MEMORY,
+    GAME_CALL_SET_CHEAT,
+    GAME_CALL_COUNT
+  };
+
+  // Statistics entry of each direct call
+  const unsigned int DirectCallIds[DIRECT_CALL_COUNT] =
+  {
+    GAME_CALL_FRAME_EVENT,
+    GAME_CALL_INPUT_EVENT,
+    GAME_CALL_SERIALIZE,
+    GAME_CALL_DESERIALIZE,
+    GAME_CALL_GET_MEMORY,
+  };
+
+  const char* const GameCallNames[GAME_CALL_COUNT] =
+  {
+    "Stop",
+    "GetStatus",
+    "HasSettings",
+    "GetSettings",
+    "SetSetting",
+    "FreeSettings",
+    "Announce",
+    "GetGameAPIVersion",
+    "GetMininumGameAPIVersion",
+    "LoadGame",
+    "LoadGameSpecial",
+    "LoadStandalone",
+    "UnloadGame",
+    "GetGameInfo",
+    "GetRegion",
+    "FrameEvent",
+    "Reset",
+    "HwContextReset",
+    "HwContextDestroy",
+    "UpdatePort",
+    "InputEvent",
+    "InputEvents",
+    "SerializeSize",
+    "Serialize",
+    "Deserialize",
+    "CheatReset",
+    "GetMemory",
+    "SetCheat",
+  };
+}
+
 // --- CDLLGame ----------------------------------------------------------------
 
-CDLLGame::CDLLGame(IFrontend* callbacks, const GameClientProperties& properties, const std::string& strLibBasePath) :
+CDLLGame::CDLLGame(IFrontend* callbacks, const GameClientProperties& properties, const std::string& strLibBasePath, bool bPrivateCopy /* = false */) :
   m_callbacks(callbacks),
   m_properties(properties),
   m_strLibBasePath(strLibBasePath),
-  m_bInitialized(false),
+  m_bPrivateCopy(bPrivateCopy),
   m_dll(NULL),
   m_pHelper(NULL),
+  m_state(DLL_STATE_UNLOADED),
+  m_activeCalls(0),
+  m_serializeSize(0),
+  m_stats(PathUtils::GetFileName(properties.game_client_dll_path), GameCallNames, GAME_CALL_COUNT),
   m_ADDON_Create(NULL),
   m_ADDON_Stop(NULL),
   m_ADDON_Destroy(NULL),
@@ -87,19 +179,36 @@ CDLLGame::CDLLGame(IFrontend* callbacks, const GameClientProperties& properties,
 
 ADDON_STATUS CDLLGame::Initialize(void)
 {
-  if (m_bInitialized)
+  CLockObject lock(m_lifecycleMutex);
+
+  if (m_state != DLL_STATE_UNLOADED)
     return ADDON_STATUS_OK;
 
   std::string strDllPath;
 
-  if (!m_properties.proxy_dll_paths.empty())
+  if (m_bPrivateCopy)
+  {
+    // dlopen() returns the already loaded library when given the same path
+    strDllPath = CopyLibrary(m_properties.game_client_dll_path);
+    if (strDllPath.empty())
+    {
+      esyslog("Unable to copy %s", m_properties.game_client_dll_path.c_str());
+      return ADDON_STATUS_PERMANENT_FAILURE;
+    }
+  }
+  else if (!m_properties.proxy_dll_paths.empty())
     strDllPath = m_properties.proxy_dll_paths[0];
   else
     strDllPath = m_properties.game_client_dll_path;
 
-  CWriteLockObject lock(m_mutex);
-
   m_dll = dlopen(strDllPath.c_str(), RTLD_LAZY);
+
+#if !defined(_WIN32)
+  // The mapping keeps the copy alive
+  if (m_bPrivateCopy)
+    unlink(strDllPath.c_str());
+#endif
+
   if (m_dll == NULL)
   {
     esyslog("Unable to load %s: %s", strDllPath.c_str(), dlerror());
@@ -154,17 +263,22 @@ ADDON_STATUS CDLLGame::Initialize(void)
   FreeProperties(props);
 
   if (status != ADDON_STATUS_UNKNOWN || status != ADDON_STATUS_PERMANENT_FAILURE)
-    m_bInitialized = true;
+    m_state = DLL_STATE_LOADED;
 
   return status;
 }
 
 void CDLLGame::Deinitialize(void)
 {
-  CWriteLockObject lock(m_mutex);
+  CLockObject lock(m_lifecycleMutex);
 
-  if (m_bInitialized)
+  if (m_state == DLL_STATE_LOADED)
   {
+    // New calls now fail. Wait for calls that saw the game client loaded.
+    m_state = DLL_STATE_UNLOADING;
+    while (m_activeCalls != 0)
+      std::this_thread::yield();
+
     if (m_ADDON_Destroy)
     {
       m_ADDON_Destroy();
@@ -180,172 +294,361 @@ void CDLLGame::Deinitialize(void)
       m_dll = NULL;
     }
 
-    m_bInitialized = false;
+    m_serializeSize = 0;
+    m_state = DLL_STATE_UNLOADED;
   }
 }
 
 void CDLLGame::Stop(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_ADDON_Stop();
+  CCallTimer timer(&m_stats, GAME_CALL_STOP);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return;
+
+  m_ADDON_Stop();
 }
 
 ADDON_STATUS CDLLGame::GetStatus(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_STATUS);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return ADDON_STATUS_UNKNOWN;
+
   return m_ADDON_GetStatus();
 }
 
 bool CDLLGame::HasSettings(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_HAS_SETTINGS);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return false;
+
   return m_ADDON_HasSettings();
 }
 
 unsigned int CDLLGame::GetSettings(ADDON_StructSetting*** sSet)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_SETTINGS);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return 0;
+
   return m_ADDON_GetSettings(sSet);
 }
 
 ADDON_STATUS CDLLGame::SetSetting(const char* settingName, const void* settingValue)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_SET_SETTING);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return ADDON_STATUS_UNKNOWN;
+
   return m_ADDON_SetSetting(settingName, settingValue);
 }
 
 void CDLLGame::FreeSettings(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_ADDON_FreeSettings();
+  CCallTimer timer(&m_stats, GAME_CALL_FREE_SETTINGS);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return;
+
+  m_ADDON_FreeSettings();
 }
 
 void CDLLGame::Announce(const char* flag, const char* sender, const char* message, const void* data)
 {
-  CReadLockObject lock(m_mutex);
-  return m_ADDON_Announce(flag, sender, message, data);
+  CCallTimer timer(&m_stats, GAME_CALL_ANNOUNCE);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return;
+
+  m_ADDON_Announce(flag, sender, message, data);
 }
 
 std::string CDLLGame::GetGameAPIVersion(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_GAME_API_VERSION);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return "";
+
   return m_GetGameAPIVersion();
 }
 
 std::string CDLLGame::GetMininumGameAPIVersion(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_MININUM_GAME_API_VERSION);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return "";
+
   return m_GetMininumGameAPIVersion();
 }
 
 GAME_ERROR CDLLGame::LoadGame(const char* url)
 {
-  CReadLockObject lock(m_mutex);
-  return m_LoadGame(url);
+  CCallTimer timer(&m_stats, GAME_CALL_LOAD_GAME);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
+  const GAME_ERROR error = m_LoadGame(url);
+  if (error == GAME_ERROR_NO_ERROR)
+    UpdateSerializeSize();
+
+  return error;
 }
 
 GAME_ERROR CDLLGame::LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount)
 {
-  CReadLockObject lock(m_mutex);
-  return m_LoadGameSpecial(type, urls, urlCount);
+  CCallTimer timer(&m_stats, GAME_CALL_LOAD_GAME_SPECIAL);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
+  const GAME_ERROR error = m_LoadGameSpecial(type, urls, urlCount);
+  if (error == GAME_ERROR_NO_ERROR)
+    UpdateSerializeSize();
+
+  return error;
 }
 
 GAME_ERROR CDLLGame::LoadStandalone(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_LoadStandalone();
+  CCallTimer timer(&m_stats, GAME_CALL_LOAD_STANDALONE);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
+  const GAME_ERROR error = m_LoadStandalone();
+  if (error == GAME_ERROR_NO_ERROR)
+    UpdateSerializeSize();
+
+  return error;
 }
 
 GAME_ERROR CDLLGame::UnloadGame(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_UNLOAD_GAME);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
+  m_serializeSize = 0;
+
   return m_UnloadGame();
 }
 
 GAME_ERROR CDLLGame::GetGameInfo(game_system_av_info* info)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_GAME_INFO);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_GetGameInfo(info);
 }
 
 GAME_REGION CDLLGame::GetRegion(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_REGION);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_REGION_UNKNOWN;
+
   return m_GetRegion();
 }
 
 void CDLLGame::FrameEvent(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_FrameEvent();
+  CCallTimer timer(&m_stats, GAME_CALL_FRAME_EVENT);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return;
+
+  m_FrameEvent();
 }
 
 GAME_ERROR CDLLGame::Reset(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_Reset();
+  CCallTimer timer(&m_stats, GAME_CALL_RESET);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
+  const GAME_ERROR error = m_Reset();
+  if (error == GAME_ERROR_NO_ERROR)
+    UpdateSerializeSize();
+
+  return error;
 }
 
 GAME_ERROR CDLLGame::HwContextReset(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_HW_CONTEXT_RESET);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_HwContextReset();
 }
 
 GAME_ERROR CDLLGame::HwContextDestroy(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_HW_CONTEXT_DESTROY);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_HwContextDestroy();
 }
 
 void CDLLGame::UpdatePort(unsigned int port, bool connected, const game_controller* controller)
 {
-  CReadLockObject lock(m_mutex);
-  return m_UpdatePort(port, connected, controller);
+  CCallTimer timer(&m_stats, GAME_CALL_UPDATE_PORT);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return;
+
+  m_UpdatePort(port, connected, controller);
 }
 
 bool CDLLGame::InputEvent(unsigned int port, const game_input_event* event)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_INPUT_EVENT);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return false;
+
   return m_InputEvent(port, event);
 }
 
+unsigned int CDLLGame::InputEvents(unsigned int port, const game_input_event* events, unsigned int count)
+{
+  CCallTimer timer(&m_stats, GAME_CALL_INPUT_EVENTS);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return 0;
+
+  unsigned int handled = 0;
+  for (unsigned int i = 0; i < count; i++)
+  {
+    if (m_InputEvent(port, &events[i]))
+      handled++;
+  }
+
+  return handled;
+}
+
 size_t CDLLGame::SerializeSize(void)
 {
-  CReadLockObject lock(m_mutex);
-  return m_SerializeSize();
+  const size_t cached = m_serializeSize;
+  if (cached != 0)
+    return cached;
+
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return 0;
+
+  UpdateSerializeSize();
+
+  return m_serializeSize;
+}
+
+void CDLLGame::UpdateSerializeSize(void)
+{
+  CCallTimer timer(&m_stats, GAME_CALL_SERIALIZE_SIZE);
+  m_serializeSize = m_SerializeSize();
 }
 
 GAME_ERROR CDLLGame::Serialize(uint8_t* data, size_t size)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_SERIALIZE);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_Serialize(data, size);
 }
 
 GAME_ERROR CDLLGame::Deserialize(const uint8_t* data, size_t size)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_DESERIALIZE);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_Deserialize(data, size);
 }
 
 GAME_ERROR CDLLGame::CheatReset(void)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_CHEAT_RESET);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_CheatReset();
 }
 
 GAME_ERROR CDLLGame::GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_GET_MEMORY);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_GetMemory(type, data, size);
 }
 
 GAME_ERROR CDLLGame::SetCheat(unsigned int index, bool enabled, const char* code)
 {
-  CReadLockObject lock(m_mutex);
+  CCallTimer timer(&m_stats, GAME_CALL_SET_CHEAT);
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return GAME_ERROR_FAILED;
+
   return m_SetCheat(index, enabled, code);
 }
 
+bool CDLLGame::GetDirectCalls(GameDirectCalls& calls)
+{
+  CCallGuard guard(*this);
+  if (!guard.IsLoaded())
+    return false;
+
+  calls.FrameEvent  = m_FrameEvent;
+  calls.InputEvent  = m_InputEvent;
+  calls.Serialize   = m_Serialize;
+  calls.Deserialize = m_Deserialize;
+  calls.GetMemory   = m_GetMemory;
+  calls.owner       = this;
+  calls.gate        = NULL;
+
+  return true;
+}
+
+bool CDLLGame::BeginDirectCall(void)
+{
+  // Same protocol as CCallGuard, the count is held until EndDirectCall()
+  m_activeCalls++;
+  if (m_state == DLL_STATE_LOADED)
+    return true;
+
+  m_activeCalls--;
+  return false;
+}
+
+void CDLLGame::EndDirectCall(DIRECT_CALL call, uint64_t elapsedNs)
+{
+  m_stats.Record(DirectCallIds[call], elapsedNs);
+  m_activeCalls--;
+}
+
 GameClientProperties CDLLGame::TranslateProperties(const game_client_properties& props)
 {
   GameClientProperties properties = { };
@@ -361,6 +664,56 @@ GameClientProperties CDLLGame::TranslateProperties(const game_client_properties&
   return properties;
 }
 
+std::string CDLLGame::CopyLibrary(const std::string& strPath)
+{
+#if defined(_WIN32)
+  char tempDir[MAX_PATH];
+  char tempPath[MAX_PATH];
+  if (GetTempPath(MAX_PATH, tempDir) == 0 || GetTempFileName(tempDir, "npl", 0, tempPath) == 0)
+    return "";
+
+  if (!CopyFile(strPath.c_str(), tempPath, FALSE))
+    return "";
+
+  return tempPath;
+#else
+  const char* tempDir = getenv("TMPDIR");
+  std::string strTemplate = std::string(tempDir ? tempDir : "/tmp") + "/netplay-XXXXXX";
+
+  std::vector<char> tempPath(strTemplate.begin(), strTemplate.end());
+  tempPath.push_back('\0');
+
+  int out = mkstemp(tempPath.data());
+  if (out < 0)
+    return "";
+
+  bool bSuccess = false;
+
+  int in = open(strPath.c_str(), O_RDONLY);
+  if (in >= 0)
+  {
+    char buffer[64 * 1024];
+    ssize_t bytes;
+    bSuccess = true;
+    while (bSuccess && (bytes = read(in, buffer, sizeof(buffer))) > 0)
+      bSuccess = (write(out, buffer, bytes) == bytes);
+    if (bytes < 0)
+      bSuccess = false;
+    close(in);
+  }
+
+  close(out);
+
+  if (!bSuccess)
+  {
+    unlink(tempPath.data());
+    return "";
+  }
+
+  return tempPath.data();
+#endif
+}
+
 void CDLLGame::TranslateProperties(const GameClientProperties& props, game_client_properties& propsStruct)
 {
   propsStruct.game_client_dll_path = props.game_client_dll_path.c_str();
@@ -19,12 +19,15 @@
  */
 #pragma once
 
+#include "interface/DirectCalls.h"
 #include "interface/IGame.h"
-#include "utils/ReadWriteLock.h"
+#include "utils/CallStats.h"
 
 #include "kodi/xbmc_addon_types.h"
 #include "kodi/kodi_game_types.h"
+#include "platform/threads/mutex.h"
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -42,10 +45,28 @@ namespace NETPLAY
     std::string              save_directory;
   };
 
-  class CDLLGame : public IGame
+  /*!
+   * \brief Game client loaded from a shared library
+   *
+   * The serialize size is cached when a game is loaded or reset, so taking a
+   * savestate every frame costs one call into the game client instead of two.
+   *
+   * Calls into the game client don't take a lock. Each call counts itself in
+   * m_activeCalls and checks that the library is loaded; Deinitialize() marks
+   * the library as unloading and waits for the count to drain before closing
+   * it. Deinitialize() must therefore not be called from within a call into
+   * the game client. Direct calls (see GetDirectCalls()) are counted the same
+   * way.
+   */
+  class CDLLGame : public IGame, public IDirectCallOwner
   {
   public:
-    CDLLGame(IFrontend* frontend, const GameClientProperties& properties, const std::string& strLibBasePath);
+    /*!
+     * \param bPrivateCopy Load a private copy of the game client, bypassing
+     *        any proxy DLLs, so that it doesn't share global state with
+     *        another instance of the same library in this process
+     */
+    CDLLGame(IFrontend* frontend, const GameClientProperties& properties, const std::string& strLibBasePath, bool bPrivateCopy = false);
     virtual ~CDLLGame(void) { Deinitialize(); }
 
     // implementation of IGame
@@ -72,26 +93,82 @@ namespace NETPLAY
     virtual GAME_ERROR HwContextDestroy(void);
     virtual void UpdatePort(unsigned int port, bool connected, const game_controller* controller);
     virtual bool InputEvent(unsigned int port, const game_input_event* event);
+    virtual unsigned int InputEvents(unsigned int port, const game_input_event* events, unsigned int count);
     virtual size_t SerializeSize(void);
     virtual GAME_ERROR Serialize(uint8_t* data, size_t size);
     virtual GAME_ERROR Deserialize(const uint8_t* data, size_t size);
     virtual GAME_ERROR CheatReset(void);
     virtual GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size);
     virtual GAME_ERROR SetCheat(unsigned int index, bool enabled, const char* code);
+    virtual bool GetDirectCalls(GameDirectCalls& calls);
+
+    // implementation of IDirectCallOwner
+    virtual bool BeginDirectCall(void);
+    virtual void EndDirectCall(DIRECT_CALL call, uint64_t elapsedNs);
+
+    /*!
+     * \brief Call counts and latencies of every call into the game client
+     */
+    const CCallStats& GetStats(void) const { return m_stats; }
 
     static GameClientProperties TranslateProperties(const game_client_properties& props);
 
   private:
+    enum DLL_STATE
+    {
+      DLL_STATE_UNLOADED,
+      DLL_STATE_LOADED,
+      DLL_STATE_UNLOADING,
+    };
+
+    /*!
+     * \brief Keeps the library loaded for the lifetime of a call
+     */
+    class CCallGuard
+    {
+    public:
+      CCallGuard(CDLLGame& game) :
+        m_activeCalls(game.m_activeCalls)
+      {
+        // Count the call before checking the state, Deinitialize() does the opposite
+        m_activeCalls++;
+        m_bLoaded = (game.m_state == DLL_STATE_LOADED);
+      }
+
+      ~CCallGuard(void) { m_activeCalls--; }
+
+      bool IsLoaded(void) const { return m_bLoaded; }
+
+    private:
+      std::atomic<unsigned int>& m_activeCalls;
+      bool                       m_bLoaded;
+    };
+
+    /*!
+     * \brief Refresh the cached serialize size, called with a CCallGuard held
+     */
+    void UpdateSerializeSize(void);
+
+    /*!
+     * \brief Copy a library to a temporary file
+     * \return The path of the copy, or empty on failure
+     */
+    static std::string CopyLibrary(const std::string& strPath);
+
     static void TranslateProperties(const GameClientProperties& props, game_client_properties& propsStruct);
     static void FreeProperties(game_client_properties& propsStruct);
 
     IFrontend* const           m_callbacks;
     const GameClientProperties m_properties;
     const std::string          m_strLibBasePath;
-    bool                       m_bInitialized;
+    const bool                 m_bPrivateCopy;
     void*                      m_dll;
     CFrontendCallbackLib*      m_pHelper;
-    CReadWriteLock             m_mutex;
+    std::atomic<DLL_STATE>     m_state;
+    std::atomic<unsigned int>  m_activeCalls;
+    std::atomic<size_t>        m_serializeSize; // 0 if unknown
+    PLATFORM::CMutex           m_lifecycleMutex; // Serializes Initialize() and Deinitialize()
+    CCallStats                 m_stats;
 
     ADDON_STATUS (*m_ADDON_Create)(void* callbacks, void* props);
     void         (*m_ADDON_Stop)(void);
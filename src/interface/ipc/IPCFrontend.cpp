@@ -0,0 +1,357 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IPCFrontend.h"
+#include "IPCSerialization.h"
+#include "filesystem/StatStructure.h"
+#include "ipc/IPCChannel.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define TEXT_TIMEOUT_MS    100  // Log lines are dropped if the host stops draining them
+#define FRAME_TIMEOUT_MS   1000
+#define POLL_INTERVAL_MS   100  // How often a blocked callback checks that the host is alive
+
+CIPCFrontend::CIPCFrontend(CIPCChannel& channel) :
+  m_channel(channel),
+  m_bInCall(false),
+  m_callThread()
+{
+}
+
+void CIPCFrontend::SetCallInProgress(bool bInProgress)
+{
+  CLockObject lock(m_mutex);
+
+  m_bInCall = bInProgress;
+  m_callThread = pthread_self();
+}
+
+bool CIPCFrontend::Post(const IPC_MESSAGE& msg)
+{
+  CLockObject lock(m_mutex);
+
+  return m_channel.Callbacks().Push(msg, FRAME_TIMEOUT_MS);
+}
+
+bool CIPCFrontend::Send(IPC_MESSAGE& msg)
+{
+  {
+    CLockObject lock(m_mutex);
+
+    if (!m_bInCall || !pthread_equal(m_callThread, pthread_self()))
+      return false;
+
+    if (!m_channel.Callbacks().Push(msg, FRAME_TIMEOUT_MS))
+      return false;
+  }
+
+  // The host is blocked in this call, so the next request is the reply
+  IPC_MESSAGE reply;
+  do
+  {
+    while (!m_channel.Requests().Pop(reply, POLL_INTERVAL_MS))
+    {
+      // Reparented to init, the host died during the callback
+      if (getppid() == 1)
+      {
+        esyslog("Host process exited during a callback");
+        return false;
+      }
+    }
+  } while (reply.opcode != IPC_CALLBACK_RESULT);
+
+  msg = reply;
+  return true;
+}
+
+void CIPCFrontend::PostText(IPC_OPCODE opcode, uint32_t type, const char* msg)
+{
+  unsigned int slot;
+  if (!m_channel.TextSlots().Acquire(slot, TEXT_TIMEOUT_MS))
+    return;
+
+  CSlotPool& slots = m_channel.TextSlots();
+
+  // Truncate lines that don't fit in a slot
+  size_t length = std::min(std::strlen(msg), slots.SlotSize() - 1);
+  std::memcpy(slots.Data(slot), msg, length);
+  slots.Data(slot)[length] = '\0';
+
+  IPC_MESSAGE ipcMsg = { static_cast<uint32_t>(opcode) };
+  ipcMsg.slot = slot;
+  ipcMsg.args[0] = type;
+  ipcMsg.payloadSize = length + 1;
+
+  // The host only releases slots it received
+  if (!Post(ipcMsg))
+    slots.Release(slot);
+}
+
+bool CIPCFrontend::SendPath(IPC_OPCODE opcode, const char* strPath, IPC_MESSAGE& msg)
+{
+  msg.opcode = opcode;
+  msg.payloadSize = IPCSerialization::WriteString(m_channel.CallbackData(), m_channel.CallbackDataSize(), strPath);
+  if (msg.payloadSize == 0)
+    return false;
+
+  return Send(msg);
+}
+
+void CIPCFrontend::Log(const ADDON::addon_log_t loglevel, const char* msg)
+{
+  PostText(IPC_CALLBACK_LOG, loglevel, msg);
+}
+
+void CIPCFrontend::QueueNotification(const ADDON::queue_msg_t type, const char* msg)
+{
+  PostText(IPC_CALLBACK_QUEUE_NOTIFICATION, type, msg);
+}
+
+void* CIPCFrontend::OpenFile(const char* strFileName, unsigned int flags)
+{
+  IPC_MESSAGE msg = { };
+  msg.args[0] = flags;
+
+  if (!SendPath(IPC_CALLBACK_OPEN_FILE, strFileName, msg))
+    return NULL;
+
+  return reinterpret_cast<void*>(static_cast<uintptr_t>(msg.handle));
+}
+
+void* CIPCFrontend::OpenFileForWrite(const char* strFileName, bool bOverWrite)
+{
+  IPC_MESSAGE msg = { };
+  msg.args[0] = bOverWrite ? 1 : 0;
+
+  if (!SendPath(IPC_CALLBACK_OPEN_FILE_FOR_WRITE, strFileName, msg))
+    return NULL;
+
+  return reinterpret_cast<void*>(static_cast<uintptr_t>(msg.handle));
+}
+
+ssize_t CIPCFrontend::ReadFile(void* file, void* lpBuf, size_t uiBufSize)
+{
+  uint8_t* buffer = static_cast<uint8_t*>(lpBuf);
+  ssize_t total = 0;
+
+  // Large reads are split into chunks that fit in the callback data area
+  while (uiBufSize > 0)
+  {
+    IPC_MESSAGE msg = { IPC_CALLBACK_READ_FILE };
+    msg.handle = reinterpret_cast<uintptr_t>(file);
+    msg.payloadSize = std::min(uiBufSize, m_channel.CallbackDataSize());
+
+    if (!Send(msg) || msg.result < 0)
+      return total > 0 ? total : -1;
+
+    std::memcpy(buffer + total, m_channel.CallbackData(), msg.result);
+    total += msg.result;
+    uiBufSize -= msg.result;
+
+    if (msg.result < msg.payloadSize)
+      break; // End of file
+  }
+
+  return total;
+}
+
+ssize_t CIPCFrontend::WriteFile(void* file, const void* lpBuf, size_t uiBufSize)
+{
+  const uint8_t* buffer = static_cast<const uint8_t*>(lpBuf);
+  ssize_t total = 0;
+
+  while (uiBufSize > 0)
+  {
+    IPC_MESSAGE msg = { IPC_CALLBACK_WRITE_FILE };
+    msg.handle = reinterpret_cast<uintptr_t>(file);
+    msg.payloadSize = std::min(uiBufSize, m_channel.CallbackDataSize());
+    std::memcpy(m_channel.CallbackData(), buffer + total, msg.payloadSize);
+
+    if (!Send(msg) || msg.result < 0)
+      return total > 0 ? total : -1;
+
+    total += msg.result;
+    uiBufSize -= msg.result;
+
+    if (msg.result < msg.payloadSize)
+      break;
+  }
+
+  return total;
+}
+
+void CIPCFrontend::FlushFile(void* file)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_FLUSH_FILE };
+  msg.handle = reinterpret_cast<uintptr_t>(file);
+  Send(msg);
+}
+
+int64_t CIPCFrontend::SeekFile(void* file, int64_t iFilePosition, int iWhence)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_SEEK_FILE };
+  msg.handle = reinterpret_cast<uintptr_t>(file);
+  msg.arg64 = iFilePosition;
+  msg.args[0] = iWhence;
+
+  if (!Send(msg))
+    return -1;
+
+  return msg.result;
+}
+
+int64_t CIPCFrontend::GetFilePosition(void* file)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_GET_FILE_POSITION };
+  msg.handle = reinterpret_cast<uintptr_t>(file);
+
+  if (!Send(msg))
+    return -1;
+
+  return msg.result;
+}
+
+int64_t CIPCFrontend::GetFileLength(void* file)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_GET_FILE_LENGTH };
+  msg.handle = reinterpret_cast<uintptr_t>(file);
+
+  if (!Send(msg))
+    return -1;
+
+  return msg.result;
+}
+
+void CIPCFrontend::CloseFile(void* file)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_CLOSE_FILE };
+  msg.handle = reinterpret_cast<uintptr_t>(file);
+  Send(msg);
+}
+
+bool CIPCFrontend::FileExists(const char* strFileName, bool bUseCache)
+{
+  IPC_MESSAGE msg = { };
+  msg.args[0] = bUseCache ? 1 : 0;
+
+  return SendPath(IPC_CALLBACK_FILE_EXISTS, strFileName, msg) && msg.result != 0;
+}
+
+bool CIPCFrontend::StatFile(const char* strFileName, STAT_STRUCTURE& buffer)
+{
+  IPC_MESSAGE msg = { };
+
+  if (!SendPath(IPC_CALLBACK_STAT_FILE, strFileName, msg) || msg.result == 0)
+    return false;
+
+  std::memcpy(&buffer, m_channel.CallbackData(), sizeof(buffer));
+  return true;
+}
+
+bool CIPCFrontend::DirectoryExists(const char* strPath)
+{
+  IPC_MESSAGE msg = { };
+
+  return SendPath(IPC_CALLBACK_DIRECTORY_EXISTS, strPath, msg) && msg.result != 0;
+}
+
+void CIPCFrontend::CloseGame(void)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_CLOSE_GAME };
+  Post(msg);
+}
+
+void CIPCFrontend::VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format)
+{
+  CSlotPool& slots = m_channel.VideoSlots();
+
+  if (size > slots.SlotSize())
+    return;
+
+  unsigned int slot;
+  if (!slots.Acquire(slot, FRAME_TIMEOUT_MS))
+    return; // Host isn't consuming frames, drop this one
+
+  std::memcpy(slots.Data(slot), data, size);
+
+  IPC_MESSAGE msg = { IPC_CALLBACK_VIDEO_FRAME };
+  msg.slot = slot;
+  msg.args[0] = width;
+  msg.args[1] = height;
+  msg.args[2] = format;
+  msg.payloadSize = size;
+
+  if (!Post(msg))
+    slots.Release(slot);
+}
+
+void CIPCFrontend::AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format)
+{
+  CSlotPool& slots = m_channel.AudioSlots();
+
+  if (size > slots.SlotSize())
+    return;
+
+  unsigned int slot;
+  if (!slots.Acquire(slot, FRAME_TIMEOUT_MS))
+    return;
+
+  std::memcpy(slots.Data(slot), data, size);
+
+  IPC_MESSAGE msg = { IPC_CALLBACK_AUDIO_FRAMES };
+  msg.slot = slot;
+  msg.args[0] = frames;
+  msg.args[1] = format;
+  msg.payloadSize = size;
+
+  if (!Post(msg))
+    slots.Release(slot);
+}
+
+bool CIPCFrontend::OpenPort(unsigned int port)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_OPEN_PORT };
+  msg.args[0] = port;
+
+  return Send(msg) && msg.result != 0;
+}
+
+void CIPCFrontend::ClosePort(unsigned int port)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_CLOSE_PORT };
+  msg.args[0] = port;
+  Post(msg);
+}
+
+void CIPCFrontend::RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength)
+{
+  IPC_MESSAGE msg = { IPC_CALLBACK_RUMBLE_SET_STATE };
+  msg.args[0] = port;
+  msg.args[1] = effect;
+  msg.fArg = strength;
+  Post(msg);
+}
@@ -0,0 +1,114 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "interface/IFrontend.h"
+#include "ipc/IPCProtocol.h"
+
+#include "platform/threads/mutex.h"
+
+#include <pthread.h>
+
+namespace NETPLAY
+{
+  class CIPCChannel;
+
+  /*!
+   * \brief Frontend living in the netplay_server process that forwards the
+   *        game client's callbacks to the host (see CIPCGame)
+   *
+   * Callbacks that return a value can only be answered while the host is
+   * blocked in a call, so they are only forwarded from the thread servicing
+   * that call. Fire-and-forget callbacks may come from any thread.
+   */
+  class CIPCFrontend : public IFrontend
+  {
+  public:
+    CIPCFrontend(CIPCChannel& channel);
+    virtual ~CIPCFrontend(void) { }
+
+    /*!
+     * \brief Called by the server around each call it services
+     */
+    void SetCallInProgress(bool bInProgress);
+
+    virtual bool Initialize(void) { return true; }
+    virtual void Deinitialize(void) { }
+
+    // implementation of IFrontend
+    virtual void Log(const ADDON::addon_log_t loglevel, const char* msg);
+    virtual bool GetSetting(const char* settingName, void* settingValue) { return false; }
+    virtual void QueueNotification(const ADDON::queue_msg_t type, const char* msg);
+    virtual bool WakeOnLan(const char* mac) { return false; }
+    virtual std::string UnknownToUTF8(const char* str) { return str; }
+    virtual std::string GetLocalizedString(int dwCode, const char* strDefault = "") { return strDefault; }
+    virtual std::string GetDVDMenuLanguage(void) { return ""; }
+    virtual void* OpenFile(const char* strFileName, unsigned int flags);
+    virtual void* OpenFileForWrite(const char* strFileName, bool bOverWrite);
+    virtual ssize_t ReadFile(void* file, void* lpBuf, size_t uiBufSize);
+    virtual bool ReadFileString(void* file, char* szLine, int iLineLength) { return false; }
+    virtual ssize_t WriteFile(void* file, const void* lpBuf, size_t uiBufSize);
+    virtual void FlushFile(void* file);
+    virtual int64_t SeekFile(void* file, int64_t iFilePosition, int iWhence);
+    virtual int TruncateFile(void* file, int64_t iSize) { return -1; }
+    virtual int64_t GetFilePosition(void* file);
+    virtual int64_t GetFileLength(void* file);
+    virtual void CloseFile(void* file);
+    virtual int GetFileChunkSize(void* file) { return -1; }
+    virtual bool FileExists(const char* strFileName, bool bUseCache);
+    virtual bool StatFile(const char* strFileName, STAT_STRUCTURE& buffer);
+    virtual bool DeleteFile(const char* strFileName) { return false; }
+    virtual bool CanOpenDirectory(const char* strUrl) { return false; }
+    virtual bool CreateDirectory(const char* strPath) { return false; }
+    virtual bool DirectoryExists(const char* strPath);
+    virtual bool RemoveDirectory(const char* strPath) { return false; }
+    virtual void CloseGame(void);
+    virtual void VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format);
+    virtual void AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format);
+    virtual void HwSetInfo(const game_hw_info* hw_info) { } // Hardware rendering can't cross processes
+    virtual uintptr_t HwGetCurrentFramebuffer(void) { return 0; }
+    virtual game_proc_address_t HwGetProcAddress(const char* symbol) { return NULL; }
+    virtual bool OpenPort(unsigned int port);
+    virtual void ClosePort(unsigned int port);
+    virtual void RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength);
+
+  private:
+    /*!
+     * \brief Send a fire-and-forget callback
+     * \return false if the host stopped taking callbacks. A slot attached to
+     *         the message is still owned by the caller.
+     */
+    bool Post(const IPC_MESSAGE& msg);
+
+    /*!
+     * \brief Send a callback and wait for the host's reply
+     * \return false if the callback can't be forwarded from this thread
+     */
+    bool Send(IPC_MESSAGE& msg);
+
+    void PostText(IPC_OPCODE opcode, uint32_t type, const char* msg);
+    bool SendPath(IPC_OPCODE opcode, const char* strPath, IPC_MESSAGE& msg);
+
+    CIPCChannel&     m_channel;
+    bool             m_bInCall;
+    pthread_t        m_callThread;
+    PLATFORM::CMutex m_mutex;
+  };
+}
@@ -0,0 +1,697 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IPCGame.h"
+#include "IPCSerialization.h"
+#include "filesystem/StatStructure.h"
+#include "input/GameInputEvent.h"
+#include "interface/IFrontend.h"
+#include "log/Log.h"
+#include "utils/StringUtils.h"
+
+#include "platform/util/timeutils.h"
+
+#include <cstring>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define SHM_NAME_FORMAT           "/game.netplay-%d-%u"
+#define POLL_INTERVAL_MS          100   // How often a blocked call checks that the server is alive
+#define STARTUP_TIMEOUT_MS        10000
+#define SHUTDOWN_TIMEOUT_MS       2000
+
+CIPCGame::CIPCGame(IFrontend* callbacks, const GameClientProperties& properties, const std::string& strServerPath) :
+  m_callbacks(callbacks),
+  m_properties(properties),
+  m_strServerPath(strServerPath),
+  m_pid(-1),
+  m_bConnected(false)
+{
+}
+
+ADDON_STATUS CIPCGame::Initialize(void)
+{
+  CLockObject lock(m_mutex);
+
+  if (m_bConnected)
+    return ADDON_STATUS_OK;
+
+  if (!StartServer())
+    return ADDON_STATUS_PERMANENT_FAILURE;
+
+  IPC_MESSAGE msg = { IPC_CALL_INITIALIZE };
+  if (!Call(msg))
+    return ADDON_STATUS_PERMANENT_FAILURE;
+
+  ADDON_STATUS status = static_cast<ADDON_STATUS>(msg.result);
+  if (status == ADDON_STATUS_UNKNOWN || status == ADDON_STATUS_PERMANENT_FAILURE)
+    StopServer();
+
+  return status;
+}
+
+void CIPCGame::Deinitialize(void)
+{
+  CLockObject lock(m_mutex);
+
+  if (m_bConnected)
+  {
+    IPC_MESSAGE msg = { IPC_CALL_DEINITIALIZE };
+    Call(msg);
+  }
+
+  StopServer();
+}
+
+bool CIPCGame::StartServer(void)
+{
+  static unsigned int channelCount = 0;
+
+  const std::string strName = StringUtils::Format(SHM_NAME_FORMAT, getpid(), channelCount++);
+  if (!m_channel.Create(strName))
+    return false;
+
+  // netplay_server --host <channel> [<proxy DLL>] <DLL> <system dir> <content dir> <save dir>
+  std::vector<std::string> args;
+  args.push_back(m_strServerPath);
+  args.push_back("--host");
+  args.push_back(strName);
+  if (!m_properties.proxy_dll_paths.empty())
+    args.push_back(m_properties.proxy_dll_paths[0]);
+  args.push_back(m_properties.game_client_dll_path);
+  args.push_back(m_properties.system_directory);
+  args.push_back(m_properties.content_directory);
+  args.push_back(m_properties.save_directory);
+
+  std::vector<char*> argv;
+  for (std::vector<std::string>::iterator it = args.begin(); it != args.end(); ++it)
+    argv.push_back(const_cast<char*>(it->c_str()));
+  argv.push_back(NULL);
+
+  if (posix_spawn(&m_pid, m_strServerPath.c_str(), NULL, NULL, argv.data(), environ) != 0)
+  {
+    LOG_ERROR_STR(m_strServerPath.c_str());
+    m_pid = -1;
+    m_channel.Close();
+    return false;
+  }
+
+  isyslog("Started game host %s (pid %d)", m_strServerPath.c_str(), m_pid);
+
+  m_bConnected = true;
+
+  return true;
+}
+
+void CIPCGame::StopServer(void)
+{
+  if (m_pid > 0)
+  {
+    if (m_bConnected)
+    {
+      IPC_MESSAGE msg = { IPC_SHUTDOWN };
+      m_channel.Requests().Push(msg, POLL_INTERVAL_MS);
+    }
+
+    int status;
+    unsigned int waitedMs = 0;
+    while (waitpid(m_pid, &status, WNOHANG) == 0)
+    {
+      if (waitedMs >= SHUTDOWN_TIMEOUT_MS)
+      {
+        esyslog("Game host %d didn't exit, killing it", m_pid);
+        kill(m_pid, SIGKILL);
+        waitpid(m_pid, &status, 0);
+        break;
+      }
+      usleep(10 * 1000);
+      waitedMs += 10;
+    }
+
+    m_pid = -1;
+  }
+
+  m_bConnected = false;
+  m_channel.Close();
+}
+
+bool CIPCGame::IsServerAlive(void)
+{
+  if (m_pid <= 0)
+    return false;
+
+  int status;
+  return waitpid(m_pid, &status, WNOHANG) == 0;
+}
+
+void CIPCGame::OnServerLost(void)
+{
+  esyslog("Game host %d exited unexpectedly", m_pid);
+
+  m_pid = -1;
+  m_bConnected = false;
+  m_channel.Close();
+
+  m_callbacks->CloseGame();
+}
+
+bool CIPCGame::Call(IPC_MESSAGE& msg)
+{
+  if (!m_bConnected)
+    return false;
+
+  const int64_t start = GetTimeMs();
+
+  while (!m_channel.Requests().Push(msg, POLL_INTERVAL_MS))
+  {
+    if (!IsServerAlive() || GetTimeMs() - start > STARTUP_TIMEOUT_MS)
+    {
+      OnServerLost();
+      return false;
+    }
+  }
+
+  while (true)
+  {
+    IPC_MESSAGE reply;
+    if (!m_channel.Callbacks().Pop(reply, POLL_INTERVAL_MS))
+    {
+      if (!IsServerAlive())
+      {
+        OnServerLost();
+        return false;
+      }
+      continue;
+    }
+
+    if (reply.opcode == IPC_CALL_RESULT)
+    {
+      msg = reply;
+      return true;
+    }
+
+    HandleCallback(reply);
+  }
+}
+
+GAME_ERROR CIPCGame::CallForError(IPC_OPCODE opcode, uint32_t payloadSize /* = 0 */)
+{
+  IPC_MESSAGE msg = { static_cast<uint32_t>(opcode) };
+  msg.payloadSize = payloadSize;
+
+  if (!Call(msg))
+    return GAME_ERROR_FAILED;
+
+  return static_cast<GAME_ERROR>(msg.result);
+}
+
+std::string CIPCGame::CallForString(IPC_OPCODE opcode)
+{
+  IPC_MESSAGE msg = { static_cast<uint32_t>(opcode) };
+
+  if (!Call(msg))
+    return "";
+
+  return IPCSerialization::ReadString(m_channel.Data(), msg.payloadSize);
+}
+
+void CIPCGame::HandleCallback(const IPC_MESSAGE& msg)
+{
+  switch (msg.opcode)
+  {
+    case IPC_CALLBACK_LOG:
+    {
+      std::string strMsg = IPCSerialization::ReadString(m_channel.TextSlots().Data(msg.slot), msg.payloadSize);
+      m_channel.TextSlots().Release(msg.slot);
+      m_callbacks->Log(static_cast<ADDON::addon_log_t>(msg.args[0]), strMsg.c_str());
+      break;
+    }
+    case IPC_CALLBACK_QUEUE_NOTIFICATION:
+    {
+      std::string strMsg = IPCSerialization::ReadString(m_channel.TextSlots().Data(msg.slot), msg.payloadSize);
+      m_channel.TextSlots().Release(msg.slot);
+      m_callbacks->QueueNotification(static_cast<ADDON::queue_msg_t>(msg.args[0]), strMsg.c_str());
+      break;
+    }
+    case IPC_CALLBACK_CLOSE_GAME:
+    {
+      m_callbacks->CloseGame();
+      break;
+    }
+    case IPC_CALLBACK_VIDEO_FRAME:
+    {
+      // The frontend reads straight out of shared memory
+      m_callbacks->VideoFrame(m_channel.VideoSlots().Data(msg.slot), msg.payloadSize,
+                              msg.args[0], msg.args[1], static_cast<GAME_RENDER_FORMAT>(msg.args[2]));
+      m_channel.VideoSlots().Release(msg.slot);
+      break;
+    }
+    case IPC_CALLBACK_AUDIO_FRAMES:
+    {
+      m_callbacks->AudioFrames(m_channel.AudioSlots().Data(msg.slot), msg.payloadSize,
+                               msg.args[0], static_cast<GAME_AUDIO_FORMAT>(msg.args[1]));
+      m_channel.AudioSlots().Release(msg.slot);
+      break;
+    }
+    case IPC_CALLBACK_OPEN_PORT:
+    {
+      IPC_MESSAGE reply = { IPC_CALLBACK_RESULT };
+      reply.result = m_callbacks->OpenPort(msg.args[0]) ? 1 : 0;
+      m_channel.Requests().Push(reply);
+      break;
+    }
+    case IPC_CALLBACK_CLOSE_PORT:
+    {
+      m_callbacks->ClosePort(msg.args[0]);
+      break;
+    }
+    case IPC_CALLBACK_RUMBLE_SET_STATE:
+    {
+      m_callbacks->RumbleSetState(msg.args[0], static_cast<GAME_RUMBLE_EFFECT>(msg.args[1]), msg.fArg);
+      break;
+    }
+    case IPC_CALLBACK_OPEN_FILE:
+    case IPC_CALLBACK_OPEN_FILE_FOR_WRITE:
+    case IPC_CALLBACK_READ_FILE:
+    case IPC_CALLBACK_WRITE_FILE:
+    case IPC_CALLBACK_FLUSH_FILE:
+    case IPC_CALLBACK_SEEK_FILE:
+    case IPC_CALLBACK_GET_FILE_POSITION:
+    case IPC_CALLBACK_GET_FILE_LENGTH:
+    case IPC_CALLBACK_CLOSE_FILE:
+    case IPC_CALLBACK_FILE_EXISTS:
+    case IPC_CALLBACK_STAT_FILE:
+    case IPC_CALLBACK_DIRECTORY_EXISTS:
+    {
+      HandleFileCallback(msg);
+      break;
+    }
+    default:
+    {
+      esyslog("Game host sent unknown message %u", msg.opcode);
+      break;
+    }
+  }
+}
+
+void CIPCGame::HandleFileCallback(const IPC_MESSAGE& msg)
+{
+  uint8_t* const data = m_channel.CallbackData();
+  void* const file = reinterpret_cast<void*>(static_cast<uintptr_t>(msg.handle));
+
+  IPC_MESSAGE reply = { IPC_CALLBACK_RESULT };
+
+  switch (msg.opcode)
+  {
+    case IPC_CALLBACK_OPEN_FILE:
+    {
+      std::string strPath = IPCSerialization::ReadString(data, msg.payloadSize);
+      reply.handle = reinterpret_cast<uintptr_t>(m_callbacks->OpenFile(strPath.c_str(), msg.args[0]));
+      break;
+    }
+    case IPC_CALLBACK_OPEN_FILE_FOR_WRITE:
+    {
+      std::string strPath = IPCSerialization::ReadString(data, msg.payloadSize);
+      reply.handle = reinterpret_cast<uintptr_t>(m_callbacks->OpenFileForWrite(strPath.c_str(), msg.args[0] != 0));
+      break;
+    }
+    case IPC_CALLBACK_READ_FILE:
+    {
+      reply.result = m_callbacks->ReadFile(file, data, msg.payloadSize);
+      break;
+    }
+    case IPC_CALLBACK_WRITE_FILE:
+    {
+      reply.result = m_callbacks->WriteFile(file, data, msg.payloadSize);
+      break;
+    }
+    case IPC_CALLBACK_FLUSH_FILE:
+    {
+      m_callbacks->FlushFile(file);
+      break;
+    }
+    case IPC_CALLBACK_SEEK_FILE:
+    {
+      reply.result = m_callbacks->SeekFile(file, msg.arg64, msg.args[0]);
+      break;
+    }
+    case IPC_CALLBACK_GET_FILE_POSITION:
+    {
+      reply.result = m_callbacks->GetFilePosition(file);
+      break;
+    }
+    case IPC_CALLBACK_GET_FILE_LENGTH:
+    {
+      reply.result = m_callbacks->GetFileLength(file);
+      break;
+    }
+    case IPC_CALLBACK_CLOSE_FILE:
+    {
+      m_callbacks->CloseFile(file);
+      break;
+    }
+    case IPC_CALLBACK_FILE_EXISTS:
+    {
+      std::string strPath = IPCSerialization::ReadString(data, msg.payloadSize);
+      reply.result = m_callbacks->FileExists(strPath.c_str(), msg.args[0] != 0) ? 1 : 0;
+      break;
+    }
+    case IPC_CALLBACK_STAT_FILE:
+    {
+      std::string strPath = IPCSerialization::ReadString(data, msg.payloadSize);
+      STAT_STRUCTURE buffer = { };
+      reply.result = m_callbacks->StatFile(strPath.c_str(), buffer) ? 1 : 0;
+      std::memcpy(data, &buffer, sizeof(buffer));
+      break;
+    }
+    case IPC_CALLBACK_DIRECTORY_EXISTS:
+    {
+      std::string strPath = IPCSerialization::ReadString(data, msg.payloadSize);
+      reply.result = m_callbacks->DirectoryExists(strPath.c_str()) ? 1 : 0;
+      break;
+    }
+    default:
+      break;
+  }
+
+  m_channel.Requests().Push(reply);
+}
+
+void CIPCGame::Stop(void)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_STOP };
+  Call(msg);
+}
+
+ADDON_STATUS CIPCGame::GetStatus(void)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_GET_STATUS };
+  if (!Call(msg))
+    return ADDON_STATUS_LOST_CONNECTION;
+
+  return static_cast<ADDON_STATUS>(msg.result);
+}
+
+std::string CIPCGame::GetGameAPIVersion(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForString(IPC_CALL_GET_GAME_API_VERSION);
+}
+
+std::string CIPCGame::GetMininumGameAPIVersion(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForString(IPC_CALL_GET_MIN_GAME_API_VERSION);
+}
+
+GAME_ERROR CIPCGame::LoadGame(const char* url)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return GAME_ERROR_FAILED;
+
+  size_t size = IPCSerialization::WriteString(m_channel.Data(), m_channel.DataSize(), url);
+  if (size == 0)
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  return CallForError(IPC_CALL_LOAD_GAME, size);
+}
+
+GAME_ERROR CIPCGame::LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return GAME_ERROR_FAILED;
+
+  size_t size = 0;
+  for (size_t i = 0; i < urlCount; i++)
+  {
+    size_t written = IPCSerialization::WriteString(m_channel.Data() + size, m_channel.DataSize() - size, urls[i]);
+    if (written == 0)
+      return GAME_ERROR_INVALID_PARAMETERS;
+    size += written;
+  }
+
+  IPC_MESSAGE msg = { IPC_CALL_LOAD_GAME_SPECIAL };
+  msg.args[0] = type;
+  msg.args[1] = urlCount;
+  msg.payloadSize = size;
+
+  if (!Call(msg))
+    return GAME_ERROR_FAILED;
+
+  return static_cast<GAME_ERROR>(msg.result);
+}
+
+GAME_ERROR CIPCGame::LoadStandalone(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_LOAD_STANDALONE);
+}
+
+GAME_ERROR CIPCGame::UnloadGame(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_UNLOAD_GAME);
+}
+
+GAME_ERROR CIPCGame::GetGameInfo(game_system_av_info* info)
+{
+  CLockObject lock(m_mutex);
+
+  GAME_ERROR error = CallForError(IPC_CALL_GET_GAME_INFO);
+  if (error == GAME_ERROR_NO_ERROR)
+    std::memcpy(info, m_channel.Data(), sizeof(*info));
+
+  return error;
+}
+
+GAME_REGION CIPCGame::GetRegion(void)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_GET_REGION };
+  if (!Call(msg))
+    return GAME_REGION_UNKNOWN;
+
+  return static_cast<GAME_REGION>(msg.result);
+}
+
+void CIPCGame::FrameEvent(void)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_FRAME_EVENT };
+  Call(msg);
+}
+
+GAME_ERROR CIPCGame::Reset(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_RESET);
+}
+
+GAME_ERROR CIPCGame::HwContextReset(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_HW_CONTEXT_RESET);
+}
+
+GAME_ERROR CIPCGame::HwContextDestroy(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_HW_CONTEXT_DESTROY);
+}
+
+void CIPCGame::UpdatePort(unsigned int port, bool connected, const game_controller* controller)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return;
+
+  IPC_MESSAGE msg = { IPC_CALL_UPDATE_PORT };
+  msg.args[0] = port;
+  msg.args[1] = connected ? 1 : 0;
+  msg.payloadSize = IPCSerialization::WriteController(m_channel.Data(), m_channel.DataSize(), *controller);
+
+  Call(msg);
+}
+
+bool CIPCGame::InputEvent(unsigned int port, const game_input_event* event)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return false;
+
+  IPC_MESSAGE msg = { IPC_CALL_INPUT_EVENT };
+  msg.args[0] = port;
+  msg.payloadSize = CGameInputEvent(*event).Serialize(m_channel.Data(), m_channel.DataSize());
+
+  if (!Call(msg))
+    return false;
+
+  return msg.result != 0;
+}
+
+unsigned int CIPCGame::InputEvents(unsigned int port, const game_input_event* events, unsigned int count)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return 0;
+
+  IPC_MESSAGE msg = { IPC_CALL_INPUT_EVENTS };
+  msg.args[0] = port;
+
+  uint8_t* const data = m_channel.Data();
+  const size_t dataSize = m_channel.DataSize();
+
+  size_t offset = 0;
+  unsigned int packed = 0;
+  for ( ; packed < count; packed++)
+  {
+    if (dataSize - offset < sizeof(uint32_t))
+      break;
+
+    const uint32_t size = CGameInputEvent(events[packed]).Serialize(data + offset + sizeof(uint32_t), dataSize - offset - sizeof(uint32_t));
+    if (size == 0)
+      break;
+
+    std::memcpy(data + offset, &size, sizeof(size));
+    offset += sizeof(size) + size;
+  }
+
+  if (packed < count)
+    esyslog("Input batch too large, dropping %u events", count - packed);
+
+  msg.args[1] = packed;
+  msg.payloadSize = offset;
+
+  if (!Call(msg))
+    return 0;
+
+  return static_cast<unsigned int>(msg.result);
+}
+
+size_t CIPCGame::SerializeSize(void)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_SERIALIZE_SIZE };
+  if (!Call(msg))
+    return 0;
+
+  return static_cast<size_t>(msg.result);
+}
+
+GAME_ERROR CIPCGame::Serialize(uint8_t* data, size_t size)
+{
+  CLockObject lock(m_mutex);
+
+  if (size > m_channel.DataSize())
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  IPC_MESSAGE msg = { IPC_CALL_SERIALIZE };
+  msg.payloadSize = size;
+
+  if (!Call(msg))
+    return GAME_ERROR_FAILED;
+
+  if (msg.result == GAME_ERROR_NO_ERROR)
+    std::memcpy(data, m_channel.Data(), size);
+
+  return static_cast<GAME_ERROR>(msg.result);
+}
+
+GAME_ERROR CIPCGame::Deserialize(const uint8_t* data, size_t size)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return GAME_ERROR_FAILED;
+
+  if (size > m_channel.DataSize())
+    return GAME_ERROR_INVALID_PARAMETERS;
+
+  std::memcpy(m_channel.Data(), data, size);
+
+  return CallForError(IPC_CALL_DESERIALIZE, size);
+}
+
+GAME_ERROR CIPCGame::CheatReset(void)
+{
+  CLockObject lock(m_mutex);
+  return CallForError(IPC_CALL_CHEAT_RESET);
+}
+
+GAME_ERROR CIPCGame::GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size)
+{
+  CLockObject lock(m_mutex);
+
+  IPC_MESSAGE msg = { IPC_CALL_GET_MEMORY };
+  msg.args[0] = type;
+
+  if (!Call(msg))
+    return GAME_ERROR_FAILED;
+
+  // The server copies the region into the data area. The pointer is a
+  // snapshot and is only valid until the next call.
+  if (msg.result == GAME_ERROR_NO_ERROR)
+  {
+    *data = m_channel.Data();
+    *size = msg.payloadSize;
+  }
+
+  return static_cast<GAME_ERROR>(msg.result);
+}
+
+GAME_ERROR CIPCGame::SetCheat(unsigned int index, bool enabled, const char* code)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_bConnected)
+    return GAME_ERROR_FAILED;
+
+  IPC_MESSAGE msg = { IPC_CALL_SET_CHEAT };
+  msg.args[0] = index;
+  msg.args[1] = enabled ? 1 : 0;
+  msg.payloadSize = IPCSerialization::WriteString(m_channel.Data(), m_channel.DataSize(), code);
+
+  if (!Call(msg))
+    return GAME_ERROR_FAILED;
+
+  return static_cast<GAME_ERROR>(msg.result);
+}
@@ -0,0 +1,107 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "interface/IGame.h"
+#include "interface/dll/DLLGame.h"
+#include "ipc/IPCChannel.h"
+
+#include "platform/threads/mutex.h"
+
+#include <string>
+#include <sys/types.h>
+
+namespace NETPLAY
+{
+  class IFrontend;
+
+  /*!
+   * \brief Game client hosted by a child netplay_server process
+   *
+   * Calls are forwarded over a shared memory control ring. Callbacks made by
+   * the game client while a call is in progress are delivered to the frontend
+   * on the calling thread; video and audio are handed over as pointers into
+   * shared memory. If the server crashes, calls fail instead of taking down
+   * the frontend.
+   */
+  class CIPCGame : public IGame
+  {
+  public:
+    CIPCGame(IFrontend* callbacks, const GameClientProperties& properties, const std::string& strServerPath);
+    virtual ~CIPCGame(void) { Deinitialize(); }
+
+    // implementation of IGame
+    virtual ADDON_STATUS Initialize(void);
+    virtual void         Deinitialize(void);
+    virtual void         Stop(void);
+    virtual ADDON_STATUS GetStatus(void);
+    virtual bool         HasSettings(void) { return false; }
+    virtual unsigned int GetSettings(ADDON_StructSetting*** sSet) { return 0; }
+    virtual ADDON_STATUS SetSetting(const char* settingName, const void* settingValue) { return ADDON_STATUS_OK; }
+    virtual void         FreeSettings(void) { }
+    virtual void         Announce(const char* flag, const char* sender, const char* message, const void* data) { }
+    virtual std::string GetGameAPIVersion(void);
+    virtual std::string GetMininumGameAPIVersion(void);
+    virtual GAME_ERROR LoadGame(const char* url);
+    virtual GAME_ERROR LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount);
+    virtual GAME_ERROR LoadStandalone(void);
+    virtual GAME_ERROR UnloadGame(void);
+    virtual GAME_ERROR GetGameInfo(game_system_av_info* info);
+    virtual GAME_REGION GetRegion(void);
+    virtual void FrameEvent(void);
+    virtual GAME_ERROR Reset(void);
+    virtual GAME_ERROR HwContextReset(void);
+    virtual GAME_ERROR HwContextDestroy(void);
+    virtual void UpdatePort(unsigned int port, bool connected, const game_controller* controller);
+    virtual bool InputEvent(unsigned int port, const game_input_event* event);
+    virtual unsigned int InputEvents(unsigned int port, const game_input_event* events, unsigned int count);
+    virtual size_t SerializeSize(void);
+    virtual GAME_ERROR Serialize(uint8_t* data, size_t size);
+    virtual GAME_ERROR Deserialize(const uint8_t* data, size_t size);
+    virtual GAME_ERROR CheatReset(void);
+    virtual GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size);
+    virtual GAME_ERROR SetCheat(unsigned int index, bool enabled, const char* code);
+
+  private:
+    bool StartServer(void);
+    void StopServer(void);
+    bool IsServerAlive(void);
+    void OnServerLost(void);
+
+    /*!
+     * \brief Send a call and service callbacks until its result arrives
+     * \return false if the server is gone
+     */
+    bool Call(IPC_MESSAGE& msg);
+    GAME_ERROR CallForError(IPC_OPCODE opcode, uint32_t payloadSize = 0);
+    std::string CallForString(IPC_OPCODE opcode);
+
+    void HandleCallback(const IPC_MESSAGE& msg);
+    void HandleFileCallback(const IPC_MESSAGE& msg);
+
+    IFrontend* const           m_callbacks;
+    const GameClientProperties m_properties;
+    const std::string          m_strServerPath;
+    CIPCChannel                m_channel;
+    pid_t                      m_pid;
+    bool                       m_bConnected;
+    PLATFORM::CMutex           m_mutex;
+  };
+}
@@ -0,0 +1,236 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IPCGameServer.h"
+#include "IPCFrontend.h"
+#include "IPCSerialization.h"
+#include "input/GameInputEvent.h"
+#include "interface/IGame.h"
+#include "ipc/IPCChannel.h"
+#include "log/Log.h"
+
+#include <cstring>
+#include <unistd.h>
+#include <vector>
+
+using namespace NETPLAY;
+
+#define IDLE_TIMEOUT_MS  1000 // How often an idle server checks that its parent is alive
+
+CIPCGameServer::CIPCGameServer(IGame* game, CIPCChannel& channel, CIPCFrontend& frontend) :
+  m_game(game),
+  m_channel(channel),
+  m_frontend(frontend)
+{
+}
+
+int CIPCGameServer::Run(void)
+{
+  while (true)
+  {
+    IPC_MESSAGE msg;
+    if (!m_channel.Requests().Pop(msg, IDLE_TIMEOUT_MS))
+    {
+      // Reparented to init, the host is gone
+      if (getppid() == 1)
+      {
+        esyslog("Host process exited, shutting down");
+        return 1;
+      }
+      continue;
+    }
+
+    if (msg.opcode == IPC_SHUTDOWN)
+      break;
+
+    m_frontend.SetCallInProgress(true);
+    HandleCall(msg);
+    m_frontend.SetCallInProgress(false);
+
+    msg.opcode = IPC_CALL_RESULT;
+    m_channel.Callbacks().Push(msg);
+  }
+
+  return 0;
+}
+
+void CIPCGameServer::HandleCall(IPC_MESSAGE& msg)
+{
+  uint8_t* const data = m_channel.Data();
+  const size_t dataSize = m_channel.DataSize();
+
+  switch (msg.opcode)
+  {
+    case IPC_CALL_INITIALIZE:
+      msg.result = m_game->Initialize();
+      break;
+    case IPC_CALL_DEINITIALIZE:
+      m_game->Deinitialize();
+      break;
+    case IPC_CALL_STOP:
+      m_game->Stop();
+      break;
+    case IPC_CALL_GET_STATUS:
+      msg.result = m_game->GetStatus();
+      break;
+    case IPC_CALL_GET_GAME_API_VERSION:
+      msg.payloadSize = IPCSerialization::WriteString(data, dataSize, m_game->GetGameAPIVersion().c_str());
+      break;
+    case IPC_CALL_GET_MIN_GAME_API_VERSION:
+      msg.payloadSize = IPCSerialization::WriteString(data, dataSize, m_game->GetMininumGameAPIVersion().c_str());
+      break;
+    case IPC_CALL_LOAD_GAME:
+    {
+      std::string strUrl = IPCSerialization::ReadString(data, msg.payloadSize);
+      msg.result = m_game->LoadGame(strUrl.c_str());
+      break;
+    }
+    case IPC_CALL_LOAD_GAME_SPECIAL:
+    {
+      // URLs are packed back-to-back, each NUL-terminated
+      std::vector<std::string> strUrls;
+      size_t offset = 0;
+      for (unsigned int i = 0; i < msg.args[1] && offset < msg.payloadSize; i++)
+      {
+        strUrls.push_back(IPCSerialization::ReadString(data + offset, msg.payloadSize - offset));
+        offset += strUrls.back().length() + 1;
+      }
+
+      std::vector<const char*> urls;
+      for (std::vector<std::string>::const_iterator it = strUrls.begin(); it != strUrls.end(); ++it)
+        urls.push_back(it->c_str());
+
+      msg.result = m_game->LoadGameSpecial(static_cast<SPECIAL_GAME_TYPE>(msg.args[0]), urls.data(), urls.size());
+      break;
+    }
+    case IPC_CALL_LOAD_STANDALONE:
+      msg.result = m_game->LoadStandalone();
+      break;
+    case IPC_CALL_UNLOAD_GAME:
+      msg.result = m_game->UnloadGame();
+      break;
+    case IPC_CALL_GET_GAME_INFO:
+    {
+      game_system_av_info info = { };
+      msg.result = m_game->GetGameInfo(&info);
+      std::memcpy(data, &info, sizeof(info));
+      break;
+    }
+    case IPC_CALL_GET_REGION:
+      msg.result = m_game->GetRegion();
+      break;
+    case IPC_CALL_FRAME_EVENT:
+      m_game->FrameEvent();
+      break;
+    case IPC_CALL_RESET:
+      msg.result = m_game->Reset();
+      break;
+    case IPC_CALL_HW_CONTEXT_RESET:
+      msg.result = m_game->HwContextReset();
+      break;
+    case IPC_CALL_HW_CONTEXT_DESTROY:
+      msg.result = m_game->HwContextDestroy();
+      break;
+    case IPC_CALL_UPDATE_PORT:
+    {
+      game_controller controller = { };
+      if (IPCSerialization::ReadController(data, msg.payloadSize, controller))
+        m_game->UpdatePort(msg.args[0], msg.args[1] != 0, &controller);
+      break;
+    }
+    case IPC_CALL_INPUT_EVENT:
+    {
+      CGameInputEvent event;
+      if (event.Deserialize(data, msg.payloadSize))
+        msg.result = m_game->InputEvent(msg.args[0], &event.Get()) ? 1 : 0;
+      else
+        msg.result = 0;
+      break;
+    }
+    case IPC_CALL_INPUT_EVENTS:
+    {
+      std::vector<CGameInputEvent> events(msg.args[1]);
+      std::vector<game_input_event> batch;
+      batch.reserve(events.size());
+
+      size_t offset = 0;
+      for (std::vector<CGameInputEvent>::iterator it = events.begin(); it != events.end(); ++it)
+      {
+        uint32_t size;
+        if (msg.payloadSize - offset < sizeof(size))
+          break;
+        std::memcpy(&size, data + offset, sizeof(size));
+        offset += sizeof(size);
+
+        if (msg.payloadSize - offset < size || !it->Deserialize(data + offset, size))
+          break;
+        offset += size;
+
+        batch.push_back(it->Get());
+      }
+
+      msg.result = batch.empty() ? 0 : m_game->InputEvents(msg.args[0], batch.data(), batch.size());
+      break;
+    }
+    case IPC_CALL_SERIALIZE_SIZE:
+      msg.result = m_game->SerializeSize();
+      break;
+    case IPC_CALL_SERIALIZE:
+      msg.result = m_game->Serialize(data, msg.payloadSize);
+      break;
+    case IPC_CALL_DESERIALIZE:
+      msg.result = m_game->Deserialize(data, msg.payloadSize);
+      break;
+    case IPC_CALL_CHEAT_RESET:
+      msg.result = m_game->CheatReset();
+      break;
+    case IPC_CALL_GET_MEMORY:
+    {
+      const uint8_t* memory = NULL;
+      size_t size = 0;
+      msg.result = m_game->GetMemory(static_cast<GAME_MEMORY>(msg.args[0]), &memory, &size);
+      if (msg.result == GAME_ERROR_NO_ERROR)
+      {
+        if (memory == NULL || size > dataSize)
+        {
+          msg.result = GAME_ERROR_FAILED;
+        }
+        else
+        {
+          std::memcpy(data, memory, size);
+          msg.payloadSize = size;
+        }
+      }
+      break;
+    }
+    case IPC_CALL_SET_CHEAT:
+    {
+      std::string strCode = IPCSerialization::ReadString(data, msg.payloadSize);
+      msg.result = m_game->SetCheat(msg.args[0], msg.args[1] != 0, strCode.c_str());
+      break;
+    }
+    default:
+    {
+      esyslog("Host sent unknown call %u", msg.opcode);
+      msg.result = GAME_ERROR_FAILED;
+      break;
+    }
+  }
+}
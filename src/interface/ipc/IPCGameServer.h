@@ -0,0 +1,51 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "ipc/IPCProtocol.h"
+
+namespace NETPLAY
+{
+  class CIPCChannel;
+  class CIPCFrontend;
+  class IGame;
+
+  /*!
+   * \brief Services calls from a CIPCGame in the parent process
+   */
+  class CIPCGameServer
+  {
+  public:
+    CIPCGameServer(IGame* game, CIPCChannel& channel, CIPCFrontend& frontend);
+
+    /*!
+     * \brief Process calls until the host asks us to quit or goes away
+     * \return The process exit code
+     */
+    int Run(void);
+
+  private:
+    void HandleCall(IPC_MESSAGE& msg);
+
+    IGame* const  m_game;
+    CIPCChannel&  m_channel;
+    CIPCFrontend& m_frontend;
+  };
+}
@@ -0,0 +1,75 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IPCSerialization.h"
+
+#include <cstring>
+
+using namespace NETPLAY;
+
+size_t IPCSerialization::WriteString(uint8_t* data, size_t size, const char* str)
+{
+  if (str == NULL)
+    str = "";
+
+  const size_t length = std::strlen(str) + 1;
+  if (length > size)
+    return 0;
+
+  std::memcpy(data, str, length);
+
+  return length;
+}
+
+std::string IPCSerialization::ReadString(const uint8_t* data, size_t size)
+{
+  const char* str = reinterpret_cast<const char*>(data);
+
+  size_t length = 0;
+  while (length < size && str[length] != '\0')
+    length++;
+
+  return std::string(str, length);
+}
+
+size_t IPCSerialization::WriteController(uint8_t* data, size_t size, const game_controller& controller)
+{
+  if (size < sizeof(controller))
+    return 0;
+
+  std::memcpy(data, &controller, sizeof(controller));
+
+  size_t length = WriteString(data + sizeof(controller), size - sizeof(controller), controller.controller_id);
+  if (length == 0)
+    return 0;
+
+  return sizeof(controller) + length;
+}
+
+bool IPCSerialization::ReadController(const uint8_t* data, size_t size, game_controller& controller)
+{
+  if (size <= sizeof(controller) || data[size - 1] != '\0')
+    return false;
+
+  std::memcpy(&controller, data, sizeof(controller));
+  controller.controller_id = reinterpret_cast<const char*>(data + sizeof(controller));
+
+  return true;
+}
@@ -0,0 +1,58 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Flat encodings of call arguments placed in the IPC data area
+   */
+  class IPCSerialization
+  {
+  public:
+    /*!
+     * \brief Write a NUL-terminated string
+     * \return The number of bytes written, or 0 if the buffer is too small
+     */
+    static size_t WriteString(uint8_t* data, size_t size, const char* str);
+
+    /*!
+     * \brief Read a string of at most size bytes
+     */
+    static std::string ReadString(const uint8_t* data, size_t size);
+
+    /*!
+     * \brief Write a controller, followed by its ID
+     */
+    static size_t WriteController(uint8_t* data, size_t size, const game_controller& controller);
+
+    /*!
+     * \brief Read a controller written by WriteController(). The controller ID
+     *        points into data, so data must outlive the controller.
+     */
+    static bool ReadController(const uint8_t* data, size_t size, game_controller& controller);
+  };
+}
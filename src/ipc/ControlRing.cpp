@@ -0,0 +1,127 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ControlRing.h"
+#include "Futex.h"
+
+#include "platform/util/timeutils.h"
+
+using namespace NETPLAY;
+
+// Number of polls before falling back to the futex. A few microseconds on
+// current hardware, which covers a round trip to a busy peer.
+#define SPIN_COUNT  4000
+
+void CControlRing::Reset(void)
+{
+  m_ring->head.store(0);
+  m_ring->tail.store(0);
+  m_ring->sequence.store(0);
+  m_ring->waiters.store(0);
+}
+
+bool CControlRing::Push(const IPC_MESSAGE& msg, unsigned int timeoutMs /* = 0 */)
+{
+  if (!IsWritable() && !WaitForChange(&CControlRing::IsWritable, timeoutMs))
+    return false;
+
+  const uint32_t head = m_ring->head.load(std::memory_order_relaxed);
+  m_ring->messages[head & (IPC_RING_SIZE - 1)] = msg;
+  m_ring->head.store(head + 1, std::memory_order_release);
+
+  Signal();
+
+  return true;
+}
+
+bool CControlRing::Pop(IPC_MESSAGE& msg, unsigned int timeoutMs /* = 0 */)
+{
+  if (!IsReadable() && !WaitForChange(&CControlRing::IsReadable, timeoutMs))
+    return false;
+
+  const uint32_t tail = m_ring->tail.load(std::memory_order_relaxed);
+  msg = m_ring->messages[tail & (IPC_RING_SIZE - 1)];
+  m_ring->tail.store(tail + 1, std::memory_order_release);
+
+  Signal();
+
+  return true;
+}
+
+bool CControlRing::WaitForChange(bool (CControlRing::*ready)(void) const, unsigned int timeoutMs)
+{
+  for (unsigned int i = 0; i < SPIN_COUNT; i++)
+  {
+    if ((this->*ready)())
+      return true;
+  }
+
+  const int64_t start = PLATFORM::GetTimeMs();
+
+  while (true)
+  {
+    // Register as a waiter before sampling the futex word, so that a peer
+    // that doesn't see us waiting has already bumped the word we sample
+    m_ring->waiters.fetch_add(1);
+    const uint32_t sequence = m_ring->sequence.load();
+
+    bool bReady = (this->*ready)();
+    if (!bReady)
+    {
+      unsigned int remainingMs = 0;
+      if (timeoutMs > 0)
+      {
+        const int64_t elapsedMs = PLATFORM::GetTimeMs() - start;
+        if (elapsedMs >= static_cast<int64_t>(timeoutMs))
+        {
+          m_ring->waiters.fetch_sub(1);
+          return false;
+        }
+        remainingMs = timeoutMs - static_cast<unsigned int>(elapsedMs);
+      }
+
+      Futex::Wait(m_ring->sequence, sequence, remainingMs);
+      bReady = (this->*ready)();
+    }
+
+    m_ring->waiters.fetch_sub(1);
+
+    if (bReady)
+      return true;
+  }
+}
+
+bool CControlRing::IsReadable(void) const
+{
+  return m_ring->head.load(std::memory_order_acquire) != m_ring->tail.load(std::memory_order_relaxed);
+}
+
+bool CControlRing::IsWritable(void) const
+{
+  return m_ring->head.load(std::memory_order_relaxed) - m_ring->tail.load(std::memory_order_acquire) < IPC_RING_SIZE;
+}
+
+void CControlRing::Signal(void)
+{
+  m_ring->sequence.fetch_add(1);
+
+  if (m_ring->waiters.load() > 0)
+    Futex::WakeAll(m_ring->sequence);
+}
@@ -0,0 +1,68 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "IPCProtocol.h"
+
+#include <stddef.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Futex-signalled SPSC message ring in shared memory
+   *
+   * Both ends spin briefly before sleeping, so a peer that answers within a
+   * few microseconds never pays for a syscall. Wakeups are only issued when
+   * the other side is actually asleep.
+   */
+  class CControlRing
+  {
+  public:
+    CControlRing(void) : m_ring(NULL) { }
+
+    void Attach(IPC_RING* ring) { m_ring = ring; }
+
+    /*!
+     * \brief Reset the ring indices (creator only, before the peer attaches)
+     */
+    void Reset(void);
+
+    /*!
+     * \brief Append a message, waiting for space if the ring is full
+     * \return false if no space became available within timeoutMs
+     */
+    bool Push(const IPC_MESSAGE& msg, unsigned int timeoutMs = 0);
+
+    /*!
+     * \brief Remove the oldest message
+     * \param timeoutMs Timeout in milliseconds, or 0 to wait forever
+     * \return false if the ring stayed empty for timeoutMs
+     */
+    bool Pop(IPC_MESSAGE& msg, unsigned int timeoutMs = 0);
+
+  private:
+    bool WaitForChange(bool (CControlRing::*ready)(void) const, unsigned int timeoutMs);
+    bool IsReadable(void) const;
+    bool IsWritable(void) const;
+    void Signal(void);
+
+    IPC_RING* m_ring;
+  };
+}
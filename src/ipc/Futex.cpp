@@ -0,0 +1,81 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "Futex.h"
+
+#if defined(__linux__)
+  #include <errno.h>
+  #include <limits.h>
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <time.h>
+  #include <unistd.h>
+#else
+  #include "platform/util/timeutils.h"
+
+  #include <unistd.h>
+#endif
+
+using namespace NETPLAY;
+
+#if !defined(__linux__)
+  #define FUTEX_POLL_INTERVAL_US  100
+#endif
+
+bool Futex::Wait(std::atomic<uint32_t>& word, uint32_t expected, unsigned int timeoutMs /* = 0 */)
+{
+#if defined(__linux__)
+  struct timespec timeout = { };
+  struct timespec* pTimeout = NULL;
+
+  if (timeoutMs > 0)
+  {
+    timeout.tv_sec  = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+    pTimeout = &timeout;
+  }
+
+  // Not FUTEX_WAIT_PRIVATE: the word may be shared with another process
+  if (syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, pTimeout, NULL, 0) < 0)
+    return errno != ETIMEDOUT;
+
+  return true;
+#else
+  const int64_t start = PLATFORM::GetTimeMs();
+
+  while (word.load() == expected)
+  {
+    if (timeoutMs > 0 && PLATFORM::GetTimeMs() - start >= static_cast<int64_t>(timeoutMs))
+      return false;
+    usleep(FUTEX_POLL_INTERVAL_US);
+  }
+
+  return true;
+#endif
+}
+
+void Futex::WakeAll(std::atomic<uint32_t>& word)
+{
+#if defined(__linux__)
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#else
+  (void)word; // Waiters poll
+#endif
+}
@@ -0,0 +1,48 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Wait/wake on a 32-bit word, which may live in shared memory
+   *
+   * On Linux this is a thin wrapper around the futex syscall. Elsewhere the
+   * wait degrades to a short sleep-and-poll loop.
+   */
+  class Futex
+  {
+  public:
+    /*!
+     * \brief Block while word == expected
+     * \param timeoutMs Timeout in milliseconds, or 0 to wait forever
+     * \return false if the wait timed out, true if woken (possibly spuriously)
+     */
+    static bool Wait(std::atomic<uint32_t>& word, uint32_t expected, unsigned int timeoutMs = 0);
+
+    /*!
+     * \brief Wake all threads and processes blocked on word
+     */
+    static void WakeAll(std::atomic<uint32_t>& word);
+  };
+}
@@ -0,0 +1,107 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "IPCChannel.h"
+#include "log/Log.h"
+
+using namespace NETPLAY;
+
+#define PAGE_SIZE_ALIGN  4096
+
+namespace NETPLAY
+{
+  size_t AlignToPage(size_t size)
+  {
+    return (size + PAGE_SIZE_ALIGN - 1) & ~static_cast<size_t>(PAGE_SIZE_ALIGN - 1);
+  }
+
+  // Offsets of the bulk areas, each starting on a page boundary
+  size_t VideoOffset(void) { return AlignToPage(sizeof(IPC_SEGMENT)); }
+  size_t AudioOffset(void) { return VideoOffset() + AlignToPage(IPC_VIDEO_SLOT_COUNT * IPC_VIDEO_SLOT_SIZE); }
+  size_t TextOffset(void)  { return AudioOffset() + AlignToPage(IPC_AUDIO_SLOT_COUNT * IPC_AUDIO_SLOT_SIZE); }
+  size_t DataOffset(void)  { return TextOffset()  + AlignToPage(IPC_TEXT_SLOT_COUNT * IPC_TEXT_SLOT_SIZE); }
+  size_t CallbackDataOffset(void) { return DataOffset() + AlignToPage(IPC_DATA_SIZE); }
+}
+
+size_t CIPCChannel::GetSegmentSize(void)
+{
+  return CallbackDataOffset() + AlignToPage(IPC_CALLBACK_DATA_SIZE);
+}
+
+bool CIPCChannel::Create(const std::string& strName)
+{
+  if (!m_memory.Create(strName, GetSegmentSize()))
+    return false;
+
+  IPC_SEGMENT* segment = reinterpret_cast<IPC_SEGMENT*>(m_memory.Get());
+  segment->magic   = IPC_MAGIC;
+  segment->version = IPC_VERSION;
+
+  Attach();
+
+  m_requests.Reset();
+  m_callbacks.Reset();
+  m_videoSlots.Reset();
+  m_audioSlots.Reset();
+  m_textSlots.Reset();
+
+  return true;
+}
+
+bool CIPCChannel::Open(const std::string& strName)
+{
+  if (!m_memory.Open(strName, GetSegmentSize()))
+    return false;
+
+  const IPC_SEGMENT* segment = reinterpret_cast<const IPC_SEGMENT*>(m_memory.Get());
+  if (segment->magic != IPC_MAGIC || segment->version != IPC_VERSION)
+  {
+    esyslog("Shared memory segment %s has an invalid header (version %u)", strName.c_str(), segment->version);
+    m_memory.Close();
+    return false;
+  }
+
+  Attach();
+
+  return true;
+}
+
+void CIPCChannel::Close(void)
+{
+  m_memory.Close();
+  m_data = NULL;
+  m_callbackData = NULL;
+}
+
+void CIPCChannel::Attach(void)
+{
+  uint8_t* base = m_memory.Get();
+  IPC_SEGMENT* segment = reinterpret_cast<IPC_SEGMENT*>(base);
+
+  m_requests.Attach(&segment->requests);
+  m_callbacks.Attach(&segment->callbacks);
+
+  m_videoSlots.Attach(segment->videoSlots, base + VideoOffset(), IPC_VIDEO_SLOT_COUNT, IPC_VIDEO_SLOT_SIZE);
+  m_audioSlots.Attach(segment->audioSlots, base + AudioOffset(), IPC_AUDIO_SLOT_COUNT, IPC_AUDIO_SLOT_SIZE);
+  m_textSlots.Attach(segment->textSlots, base + TextOffset(), IPC_TEXT_SLOT_COUNT, IPC_TEXT_SLOT_SIZE);
+
+  m_data = base + DataOffset();
+  m_callbackData = base + CallbackDataOffset();
+}
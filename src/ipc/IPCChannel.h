@@ -0,0 +1,87 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "ControlRing.h"
+#include "SharedMemory.h"
+#include "SlotPool.h"
+
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Shared memory channel between Kodi and an out-of-process game host
+   */
+  class CIPCChannel
+  {
+  public:
+    CIPCChannel(void) : m_data(NULL), m_callbackData(NULL) { }
+
+    /*!
+     * \brief Create the channel (host side)
+     */
+    bool Create(const std::string& strName);
+
+    /*!
+     * \brief Attach to a channel created by the host (server side)
+     */
+    bool Open(const std::string& strName);
+
+    void Close(void);
+
+    bool IsOpen(void) const { return m_data != NULL; }
+
+    CControlRing& Requests(void)  { return m_requests; }
+    CControlRing& Callbacks(void) { return m_callbacks; }
+
+    CSlotPool& VideoSlots(void) { return m_videoSlots; }
+    CSlotPool& AudioSlots(void) { return m_audioSlots; }
+    CSlotPool& TextSlots(void)  { return m_textSlots; }
+
+    /*!
+     * \brief Scratch area for call arguments and results. Owned by whichever
+     *        side is currently processing a call.
+     */
+    uint8_t* Data(void) const { return m_data; }
+    size_t DataSize(void) const { return IPC_DATA_SIZE; }
+
+    /*!
+     * \brief Scratch area for callbacks that return a value. Only used by the
+     *        thread whose call is in progress, while it waits for the reply.
+     */
+    uint8_t* CallbackData(void) const { return m_callbackData; }
+    size_t CallbackDataSize(void) const { return IPC_CALLBACK_DATA_SIZE; }
+
+    static size_t GetSegmentSize(void);
+
+  private:
+    void Attach(void);
+
+    CSharedMemory m_memory;
+    CControlRing  m_requests;
+    CControlRing  m_callbacks;
+    CSlotPool     m_videoSlots;
+    CSlotPool     m_audioSlots;
+    CSlotPool     m_textSlots;
+    uint8_t*      m_data;
+    uint8_t*      m_callbackData;
+  };
+}
@@ -0,0 +1,160 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// --- Shared memory layout ----------------------------------------------------
+//
+// [ IPC_SEGMENT ][ video slots ][ audio slots ][ text slots ][ data area ][ callback data area ]
+//
+// The control rings carry fixed-size messages. Bulk data (video, audio, log
+// lines, savestates, file contents) lives in the slots and data areas and is
+// referenced from the messages by slot index or payload size.
+
+#define IPC_MAGIC               0x4E504C59 // "NPLY"
+#define IPC_VERSION             2
+
+#define IPC_RING_SIZE           64 // Must be a power of two
+
+#define IPC_VIDEO_SLOT_COUNT    2
+#define IPC_VIDEO_SLOT_SIZE     (16 * 1024 * 1024)
+
+#define IPC_AUDIO_SLOT_COUNT    8
+#define IPC_AUDIO_SLOT_SIZE     (64 * 1024)
+
+#define IPC_TEXT_SLOT_COUNT     8
+#define IPC_TEXT_SLOT_SIZE      (4 * 1024)
+
+#define IPC_DATA_SIZE           (32 * 1024 * 1024)
+#define IPC_CALLBACK_DATA_SIZE  (4 * 1024 * 1024)
+
+#define IPC_CACHE_LINE          64
+
+namespace NETPLAY
+{
+  enum IPC_OPCODE
+  {
+    IPC_NONE = 0,
+
+    // Host -> server: calls into the game client
+    IPC_CALL_INITIALIZE,
+    IPC_CALL_DEINITIALIZE,
+    IPC_CALL_STOP,
+    IPC_CALL_GET_STATUS,
+    IPC_CALL_GET_GAME_API_VERSION,
+    IPC_CALL_GET_MIN_GAME_API_VERSION,
+    IPC_CALL_LOAD_GAME,
+    IPC_CALL_LOAD_GAME_SPECIAL,
+    IPC_CALL_LOAD_STANDALONE,
+    IPC_CALL_UNLOAD_GAME,
+    IPC_CALL_GET_GAME_INFO,
+    IPC_CALL_GET_REGION,
+    IPC_CALL_FRAME_EVENT,
+    IPC_CALL_RESET,
+    IPC_CALL_HW_CONTEXT_RESET,
+    IPC_CALL_HW_CONTEXT_DESTROY,
+    IPC_CALL_UPDATE_PORT,
+    IPC_CALL_INPUT_EVENT,
+    IPC_CALL_INPUT_EVENTS,  // args[1] events, each prefixed with its size
+    IPC_CALL_SERIALIZE_SIZE,
+    IPC_CALL_SERIALIZE,
+    IPC_CALL_DESERIALIZE,
+    IPC_CALL_CHEAT_RESET,
+    IPC_CALL_GET_MEMORY,
+    IPC_CALL_SET_CHEAT,
+    IPC_CALLBACK_RESULT,  // Reply to a callback that returns a value
+    IPC_SHUTDOWN,
+
+    // Server -> host: results and frontend callbacks
+    IPC_CALL_RESULT,      // Reply to an IPC_CALL_* message
+    IPC_CALLBACK_LOG,
+    IPC_CALLBACK_QUEUE_NOTIFICATION,
+    IPC_CALLBACK_CLOSE_GAME,
+    IPC_CALLBACK_VIDEO_FRAME,
+    IPC_CALLBACK_AUDIO_FRAMES,
+    IPC_CALLBACK_OPEN_PORT,
+    IPC_CALLBACK_CLOSE_PORT,
+    IPC_CALLBACK_RUMBLE_SET_STATE,
+    IPC_CALLBACK_OPEN_FILE,
+    IPC_CALLBACK_OPEN_FILE_FOR_WRITE,
+    IPC_CALLBACK_READ_FILE,
+    IPC_CALLBACK_WRITE_FILE,
+    IPC_CALLBACK_FLUSH_FILE,
+    IPC_CALLBACK_SEEK_FILE,
+    IPC_CALLBACK_GET_FILE_POSITION,
+    IPC_CALLBACK_GET_FILE_LENGTH,
+    IPC_CALLBACK_CLOSE_FILE,
+    IPC_CALLBACK_FILE_EXISTS,
+    IPC_CALLBACK_STAT_FILE,
+    IPC_CALLBACK_DIRECTORY_EXISTS,
+  };
+
+  /*!
+   * \brief Fixed-size message exchanged over a control ring
+   */
+  struct IPC_MESSAGE
+  {
+    uint32_t opcode;
+    uint32_t slot;        // Slot index for bulk callbacks
+    uint32_t args[4];     // Opcode-specific integer arguments
+    float    fArg;        // Opcode-specific float argument
+    uint32_t payloadSize; // Bytes used in the slot or data area
+    uint64_t handle;      // Opaque file handle of the host's frontend
+    int64_t  arg64;       // Opcode-specific 64-bit argument
+    int64_t  result;      // Return value of the call
+  };
+
+  /*!
+   * \brief Single-producer, single-consumer ring of messages
+   */
+  struct IPC_RING
+  {
+    std::atomic<uint32_t> head;     // Written by the producer
+    uint8_t               pad0[IPC_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    std::atomic<uint32_t> tail;     // Written by the consumer
+    uint8_t               pad1[IPC_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    std::atomic<uint32_t> sequence; // Futex word, bumped on every push and pop
+    std::atomic<uint32_t> waiters;  // Number of threads blocked on sequence
+    uint8_t               pad2[IPC_CACHE_LINE - 2 * sizeof(std::atomic<uint32_t>)];
+    IPC_MESSAGE           messages[IPC_RING_SIZE];
+  };
+
+  /*!
+   * \brief Ownership word of a bulk slot: 0 = free, 1 = busy, 2 = busy with waiters
+   */
+  struct IPC_SLOT_STATE
+  {
+    std::atomic<uint32_t> busy;
+  };
+
+  struct IPC_SEGMENT
+  {
+    uint32_t       magic;
+    uint32_t       version;
+    uint8_t        pad[IPC_CACHE_LINE - 2 * sizeof(uint32_t)];
+    IPC_RING       requests;  // Host -> server
+    IPC_RING       callbacks; // Server -> host
+    IPC_SLOT_STATE videoSlots[IPC_VIDEO_SLOT_COUNT];
+    IPC_SLOT_STATE audioSlots[IPC_AUDIO_SLOT_COUNT];
+    IPC_SLOT_STATE textSlots[IPC_TEXT_SLOT_COUNT];
+  };
+}
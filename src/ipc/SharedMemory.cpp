@@ -0,0 +1,118 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SharedMemory.h"
+#include "log/Log.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace NETPLAY;
+
+CSharedMemory::CSharedMemory(void) :
+  m_data(NULL),
+  m_size(0),
+  m_bOwner(false)
+{
+}
+
+bool CSharedMemory::Create(const std::string& strName, size_t size)
+{
+  Close();
+
+  int fd = shm_open(strName.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+  {
+    LOG_ERROR_STR(strName.c_str());
+    return false;
+  }
+
+  // Pages are allocated lazily, so a generous size only costs what is touched
+  if (ftruncate(fd, size) < 0)
+  {
+    LOG_ERROR_STR(strName.c_str());
+    close(fd);
+    shm_unlink(strName.c_str());
+    return false;
+  }
+
+  m_strName = strName;
+  m_bOwner = true;
+
+  if (!Map(fd, size))
+  {
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+bool CSharedMemory::Open(const std::string& strName, size_t size)
+{
+  Close();
+
+  int fd = shm_open(strName.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+  if (fd < 0)
+  {
+    LOG_ERROR_STR(strName.c_str());
+    return false;
+  }
+
+  m_strName = strName;
+  m_bOwner = false;
+
+  return Map(fd, size);
+}
+
+bool CSharedMemory::Map(int fd, size_t size)
+{
+  void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED)
+  {
+    LOG_ERROR_STR(m_strName.c_str());
+    return false;
+  }
+
+  m_data = static_cast<uint8_t*>(data);
+  m_size = size;
+
+  return true;
+}
+
+void CSharedMemory::Close(void)
+{
+  if (m_data)
+  {
+    munmap(m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+  }
+
+  if (m_bOwner && !m_strName.empty())
+    shm_unlink(m_strName.c_str());
+
+  m_strName.clear();
+  m_bOwner = false;
+}
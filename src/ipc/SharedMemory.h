@@ -0,0 +1,62 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Named POSIX shared memory segment
+   */
+  class CSharedMemory
+  {
+  public:
+    CSharedMemory(void);
+    ~CSharedMemory(void) { Close(); }
+
+    /*!
+     * \brief Create and map a new segment. The creator unlinks the name when
+     *        the segment is closed.
+     */
+    bool Create(const std::string& strName, size_t size);
+
+    /*!
+     * \brief Map an existing segment created by another process
+     */
+    bool Open(const std::string& strName, size_t size);
+
+    void Close(void);
+
+    uint8_t* Get(void) const { return m_data; }
+    size_t Size(void) const { return m_size; }
+    const std::string& Name(void) const { return m_strName; }
+
+  private:
+    bool Map(int fd, size_t size);
+
+    std::string m_strName;
+    uint8_t*    m_data;
+    size_t      m_size;
+    bool        m_bOwner;
+  };
+}
@@ -0,0 +1,84 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SlotPool.h"
+#include "Futex.h"
+
+using namespace NETPLAY;
+
+#define SLOT_FREE     0
+#define SLOT_BUSY     1
+#define SLOT_WAITING  2 // Busy, and the owner-to-be is asleep on the futex
+
+CSlotPool::CSlotPool(void) :
+  m_states(NULL),
+  m_data(NULL),
+  m_count(0),
+  m_slotSize(0),
+  m_next(0)
+{
+}
+
+void CSlotPool::Attach(IPC_SLOT_STATE* states, uint8_t* data, unsigned int count, size_t slotSize)
+{
+  m_states   = states;
+  m_data     = data;
+  m_count    = count;
+  m_slotSize = slotSize;
+  m_next     = 0;
+}
+
+void CSlotPool::Reset(void)
+{
+  for (unsigned int i = 0; i < m_count; i++)
+    m_states[i].busy.store(SLOT_FREE);
+}
+
+bool CSlotPool::Acquire(unsigned int& index, unsigned int timeoutMs)
+{
+  index = m_next;
+  m_next = (m_next + 1) % m_count;
+
+  std::atomic<uint32_t>& busy = m_states[index].busy;
+
+  uint32_t expected = SLOT_FREE;
+  while (!busy.compare_exchange_strong(expected, SLOT_BUSY))
+  {
+    // Flag that we're about to sleep, unless the slot was freed meanwhile
+    if (expected == SLOT_BUSY && !busy.compare_exchange_strong(expected, SLOT_WAITING) && expected == SLOT_FREE)
+      continue;
+
+    if (!Futex::Wait(busy, SLOT_WAITING, timeoutMs))
+      return false;
+
+    expected = SLOT_FREE;
+  }
+
+  return true;
+}
+
+void CSlotPool::Release(unsigned int index)
+{
+  if (index >= m_count)
+    return;
+
+  if (m_states[index].busy.exchange(SLOT_FREE) == SLOT_WAITING)
+    Futex::WakeAll(m_states[index].busy);
+}
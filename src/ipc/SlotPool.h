@@ -0,0 +1,67 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "IPCProtocol.h"
+
+#include <stddef.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Fixed-size buffers in shared memory, handed from the server (which
+   *        fills them) to the host (which releases them after use)
+   */
+  class CSlotPool
+  {
+  public:
+    CSlotPool(void);
+
+    void Attach(IPC_SLOT_STATE* states, uint8_t* data, unsigned int count, size_t slotSize);
+
+    /*!
+     * \brief Mark all slots as free (creator only)
+     */
+    void Reset(void);
+
+    /*!
+     * \brief Take ownership of the next slot in round-robin order, waiting for
+     *        the host to release it if necessary
+     * \return false if the slot wasn't released within timeoutMs
+     */
+    bool Acquire(unsigned int& index, unsigned int timeoutMs);
+
+    /*!
+     * \brief Return a slot to the pool
+     */
+    void Release(unsigned int index);
+
+    uint8_t* Data(unsigned int index) const { return m_data + index * m_slotSize; }
+    size_t SlotSize(void) const { return m_slotSize; }
+    unsigned int Count(void) const { return m_count; }
+
+  private:
+    IPC_SLOT_STATE* m_states;
+    uint8_t*        m_data;
+    unsigned int    m_count;
+    size_t          m_slotSize;
+    unsigned int    m_next;
+  };
+}
@@ -19,35 +19,52 @@
  */
 
 #include "interface/dll/DLLGame.h"
+#include "interface/FrameScheduler.h"
 #include "interface/FrontendManager.h"
+#if !defined(_WIN32)
+  #include "interface/ipc/IPCFrontend.h"
+  #include "interface/ipc/IPCGameServer.h"
+  #include "ipc/IPCChannel.h"
+#endif
 #include "keyboard/Keyboard.h"
 #include "keyboard/KeyboardMock.h"
 #include "log/Log.h"
+#include "netplay/NetplayGame.h"
 #include "utils/AbortableTask.h"
 #include "utils/PathUtils.h"
+#include "utils/SignalHandler.h"
 
 #include "kodi/kodi_addon_utils.hpp"
 
+#include <atomic>
 #include <iostream>
 #include <signal.h>
 #include <stdexcept>
 #include <string>
 
+#if defined(__linux__)
+  #include <sys/prctl.h>
+#endif
+
 using namespace NETPLAY;
 
+#define FAST_FORWARD_INTERVAL  4   // Show every 4th frame while fast-forwarding
+#define SIGNAL_POLL_MS         100
+
 enum OPTION
 {
   OPTION_INVALID,
   OPTION_LOCAL_GAME,  // Load local game client
   OPTION_REMOTE_GAME, // Load remote game client
   OPTION_DISCOVER,    // Discover servers on the network
+  OPTION_HOST_GAME,   // Host a game client for a parent process over shared memory
 };
 
 // --- Helper function --------------------------------------------------------
 
 namespace NETPLAY
 {
-  IGame* GetGame(OPTION option, int argc, char* argv[], IFrontend* callbacks)
+  IGame* GetGame(OPTION option, int argc, char* argv[], CFrontendManager* callbacks)
   {
     IGame* game = NULL;
 
@@ -73,7 +90,7 @@ namespace NETPLAY
         }
 
         std::string strLibBasePath = PathUtils::GetHelperLibraryDir(PathUtils::GetParentDirectory(PathUtils::GetProcessPath()));
-        game = new CDLLGame(callbacks, props, strLibBasePath);
+        game = new CNetplayGame(new CDLLGame(callbacks, props, strLibBasePath), callbacks);
         break;
       }
       case OPTION_REMOTE_GAME:
@@ -101,6 +118,73 @@ namespace NETPLAY
 
     return game;
   }
+
+#if !defined(_WIN32)
+  /*!
+   * \brief Toggles fast-forward on SIGUSR1, for scripts and test automation
+   *
+   * The signal only sets a flag. The main thread applies it, so the handler
+   * never logs or takes a lock that the interrupted thread might hold.
+   */
+  class CFastForwardToggle : public ISignalReceiver
+  {
+  public:
+    CFastForwardToggle(void) : m_bToggle(false) { CSignalHandler::Get().SetSignalReceiver(SIGUSR1, this); }
+    virtual ~CFastForwardToggle(void) { CSignalHandler::Get().ResetSignalReceiver(SIGUSR1); }
+
+    // implementation of ISignalReceiver
+    virtual void OnSignal(int signum) { m_bToggle = true; }
+
+    bool TakeToggle(void) { return m_bToggle.exchange(false); }
+
+  private:
+    std::atomic<bool> m_bToggle;
+  };
+
+  /*!
+   * \brief Run as the child of a CIPCGame, servicing its calls until it exits
+   */
+  int RunHost(int argc, char* argv[], bool bAsyncDispatch)
+  {
+#if defined(__linux__)
+    // Don't outlive the host
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+
+    CIPCChannel channel;
+    if (!channel.Open(argv[2]))
+      return 1;
+
+    GameClientProperties props;
+    int arg = 3;
+    if (argc == 8)
+      props.proxy_dll_paths.push_back(argv[arg++]);
+    props.game_client_dll_path = argv[arg++];
+    props.system_directory     = argv[arg++];
+    props.content_directory    = argv[arg++];
+    props.save_directory       = argv[arg++];
+
+    CIPCFrontend frontend(channel);
+
+    CFrontendManager callbacks;
+    callbacks.SetAsyncDispatch(bAsyncDispatch);
+    callbacks.RegisterFrontend(&frontend);
+
+    std::string strLibBasePath = PathUtils::GetHelperLibraryDir(PathUtils::GetParentDirectory(PathUtils::GetProcessPath()));
+    CDLLGame game(&callbacks, props, strLibBasePath);
+
+    CIPCGameServer server(&game, channel, frontend);
+    int exitCode = server.Run();
+
+    game.Deinitialize();
+    game.GetStats().Dump();
+    callbacks.DumpStats();
+    callbacks.UnregisterFrontend(&frontend);
+    channel.Close();
+
+    return exitCode;
+  }
+#endif
 }
 
 // --- Entry point -------------------------------------------------------------
@@ -112,6 +196,16 @@ int main(int argc, char* argv[])
 
   OPTION option(OPTION_INVALID);
 
+  // Options come before the command, drop them so the command stays at argv[1]
+  bool bAsyncDispatch = false;
+  if (argc >= 2 && std::string(argv[1]) == "--async")
+  {
+    bAsyncDispatch = true;
+    argv[1] = argv[0];
+    argv++;
+    argc--;
+  }
+
   if (argc >= 2)
   {
     std::string strOption = argv[1];
@@ -122,6 +216,8 @@ int main(int argc, char* argv[])
       option = OPTION_REMOTE_GAME;
     else if ((strOption == "-d" || strOption == "--discover"))
       option = OPTION_DISCOVER;
+    else if (strOption == "--host" && (argc == 7 || argc == 8))
+      option = OPTION_HOST_GAME;
   }
 
   if (option == OPTION_INVALID)
@@ -134,15 +230,28 @@ int main(int argc, char* argv[])
     std::cout << "Load game client via proxy DLL:" << std::endl;
     std::cout << "  " << strExe << " --game <proxy DLL> <DLL> <system dir> <content dir> <save dir>" << std::endl;
     std::cout << std::endl;
+#if !defined(_WIN32)
+    std::cout << "  While a game runs, SIGUSR1 toggles fast-forward" << std::endl;
+    std::cout << std::endl;
+#endif
     std::cout << "Load remote game client" << std::endl;
     std::cout << "  " << strExe << " --remote [<address> [<port>]]" << std::endl;
     std::cout << std::endl;
     std::cout << "Discover servers on the network:" << std::endl;
     std::cout << "  " << strExe << " --discover" << std::endl;
     std::cout << std::endl;
+    std::cout << "Options, given before any of the above:" << std::endl;
+    std::cout << "  --async   Deliver video and audio to each frontend on its own thread" << std::endl;
+    std::cout << std::endl;
     return 1;
   }
 
+#if !defined(_WIN32)
+  // Started by CIPCGame, which owns the game client's lifetime
+  if (option == OPTION_HOST_GAME)
+    return RunHost(argc, argv, bAsyncDispatch);
+#endif
+
   isyslog("Netplay server initializing");
 
   try
@@ -151,6 +260,8 @@ int main(int argc, char* argv[])
     if (!CALLBACKS->Initialize())
       throw "Failed to initialize frontend";
 
+    CALLBACKS->SetAsyncDispatch(bAsyncDispatch);
+
     GAME = GetGame(option, argc, argv, CALLBACKS);
     if (!GAME)
       throw std::runtime_error("Server failed to connect to a game client. Call with no args for help.");
@@ -177,9 +288,34 @@ int main(int argc, char* argv[])
 
   if (option == OPTION_LOCAL_GAME)
   {
+    // Nothing else drives the game, run it at its own frame rate
+    game_system_av_info info = { };
+    if (GAME->GetGameInfo(&info) != GAME_ERROR_NO_ERROR)
+      esyslog("Failed to get game info");
+
+    CFrameScheduler scheduler(GAME, CALLBACKS);
+    scheduler.Start(info.timing.fps);
+
     CAbortableTask task;
+#if !defined(_WIN32)
+    CFastForwardToggle fastForward;
+    while (!task.Wait(SIGNAL_POLL_MS))
+    {
+      if (fastForward.TakeToggle())
+        scheduler.SetFastForward(scheduler.IsFastForwarding() ? 0 : FAST_FORWARD_INTERVAL);
+    }
+#else
     task.Wait();
+#endif
     exitCode = task.GetExitCode();
+
+    scheduler.Stop();
+
+    FrameSchedulerStats stats;
+    scheduler.GetStats(stats);
+    isyslog("Ran %llu frames (%llu caught up, %llu skipped), average jitter %.1f us, max %.1f us",
+            static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.catchUpFrames),
+            static_cast<unsigned long long>(stats.skippedFrames), stats.averageJitterUs, stats.maxJitterUs);
   }
   else if (option == OPTION_REMOTE_GAME || option == OPTION_DISCOVER)
   {
@@ -191,6 +327,8 @@ int main(int argc, char* argv[])
 
   isyslog("Netplay shutting down");
 
+  CALLBACKS->DumpStats();
+
   delete CALLBACKS;
   delete GAME;
 
@@ -0,0 +1,209 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "AudioJitterBuffer.h"
+#include "interface/IFrontend.h"
+#include "log/Log.h"
+
+#include "platform/util/timeutils.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define CHANNELS               2
+#define TICK_MS                10     // Playout period
+#define MIN_DEPTH_MS           20.0
+#define MAX_DEPTH_MS           300.0
+#define JITTER_MULTIPLIER      3.0    // Target depth in units of measured jitter
+#define UNDERRUN_PENALTY_MS    10.0   // Extra depth added for each underrun
+#define PENALTY_DECAY_MS       0.01   // Penalty removed per tick without underruns (1ms/s)
+#define MAX_STRETCH            0.02   // Maximum playback speed change
+#define DEPTH_TOLERANCE        0.2    // Don't resample within 20% of the target
+
+CAudioJitterBuffer::CAudioJitterBuffer(IFrontend* frontend, double sampleRate) :
+  m_frontend(frontend),
+  m_sampleRate(sampleRate > 0.0 ? sampleRate : 48000.0),
+  m_bPrimed(false),
+  m_underruns(0),
+  m_lastArrivalMs(0),
+  m_lastChunkMs(0.0),
+  m_jitterMs(0.0),
+  m_underrunPenaltyMs(0.0),
+  m_targetMs(MIN_DEPTH_MS),
+  m_position(0.0)
+{
+}
+
+bool CAudioJitterBuffer::Start(void)
+{
+  return CreateThread(false);
+}
+
+void CAudioJitterBuffer::Stop(void)
+{
+  StopThread();
+
+  CLockObject lock(m_mutex);
+  m_samples.clear();
+  m_bPrimed = false;
+}
+
+void CAudioJitterBuffer::AddFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format)
+{
+  if (format != GAME_AUDIO_FMT_S16NE || size < frames * CHANNELS * sizeof(int16_t))
+    return;
+
+  const int64_t now = GetTimeMs();
+  const int16_t* samples = reinterpret_cast<const int16_t*>(data);
+
+  CLockObject lock(m_mutex);
+
+  // Deviation between the arrival interval and the audio it carried
+  if (m_lastArrivalMs != 0)
+  {
+    const double deviation = std::fabs((now - m_lastArrivalMs) - m_lastChunkMs);
+    m_jitterMs += (deviation - m_jitterMs) / 16.0;
+  }
+  m_lastArrivalMs = now;
+  m_lastChunkMs = FramesToMs(frames);
+
+  m_samples.insert(m_samples.end(), samples, samples + frames * CHANNELS);
+
+  // Drop the oldest audio rather than let latency grow without bound
+  const size_t maxSamples = static_cast<size_t>(MAX_DEPTH_MS * 2 * m_sampleRate / 1000.0) * CHANNELS;
+  if (m_samples.size() > maxSamples)
+    m_samples.erase(m_samples.begin(), m_samples.begin() + (m_samples.size() - maxSamples));
+}
+
+unsigned int CAudioJitterBuffer::GetDepthMs(void)
+{
+  CLockObject lock(m_mutex);
+  return static_cast<unsigned int>(FramesToMs(m_samples.size() / CHANNELS));
+}
+
+unsigned int CAudioJitterBuffer::GetTargetDepthMs(void)
+{
+  CLockObject lock(m_mutex);
+  return static_cast<unsigned int>(m_targetMs);
+}
+
+unsigned int CAudioJitterBuffer::GetUnderrunCount(void)
+{
+  CLockObject lock(m_mutex);
+  return m_underruns;
+}
+
+void* CAudioJitterBuffer::Process(void)
+{
+  const unsigned int outputFrames = static_cast<unsigned int>(m_sampleRate * TICK_MS / 1000.0 + 0.5);
+
+  std::vector<int16_t> output(outputFrames * CHANNELS);
+
+  int64_t nextTick = GetTimeMs();
+
+  while (!IsStopped())
+  {
+    bool bRendered;
+    {
+      CLockObject lock(m_mutex);
+      UpdateTarget();
+      bRendered = Render(outputFrames, output);
+    }
+
+    if (bRendered)
+    {
+      m_frontend->AudioFrames(reinterpret_cast<const uint8_t*>(output.data()),
+                              output.size() * sizeof(int16_t), outputFrames, GAME_AUDIO_FMT_S16NE);
+    }
+
+    nextTick += TICK_MS;
+    const int64_t now = GetTimeMs();
+    if (nextTick > now)
+      Sleep(static_cast<uint32_t>(nextTick - now));
+    else if (now - nextTick > 10 * TICK_MS)
+      nextTick = now; // Don't try to make up for a long stall
+  }
+
+  return NULL;
+}
+
+bool CAudioJitterBuffer::Render(unsigned int outputFrames, std::vector<int16_t>& output)
+{
+  const size_t available = m_samples.size() / CHANNELS;
+  const double depthMs = FramesToMs(available);
+
+  if (!m_bPrimed)
+  {
+    // Refill to the target depth before playing
+    if (depthMs < m_targetMs)
+      return false;
+    m_bPrimed = true;
+  }
+
+  // Play slightly faster when the buffer is too deep, slower when too shallow
+  double ratio = 1.0;
+  if (depthMs > m_targetMs * (1.0 + DEPTH_TOLERANCE))
+    ratio = 1.0 + MAX_STRETCH;
+  else if (depthMs < m_targetMs * (1.0 - DEPTH_TOLERANCE))
+    ratio = 1.0 - MAX_STRETCH;
+
+  const double end = m_position + outputFrames * ratio;
+  const size_t required = static_cast<size_t>(std::ceil(end)) + 1;
+
+  if (available < required)
+  {
+    m_underruns++;
+    m_underrunPenaltyMs = std::min(m_underrunPenaltyMs + UNDERRUN_PENALTY_MS, MAX_DEPTH_MS);
+    m_bPrimed = false;
+    dsyslog("Audio underrun (%u total), target depth now %.0f ms", m_underruns, m_targetMs + UNDERRUN_PENALTY_MS);
+    return false;
+  }
+
+  for (unsigned int i = 0; i < outputFrames; i++)
+  {
+    const double position = m_position + i * ratio;
+    const size_t index = static_cast<size_t>(position);
+    const double fraction = position - index;
+
+    for (unsigned int channel = 0; channel < CHANNELS; channel++)
+    {
+      const double a = m_samples[index * CHANNELS + channel];
+      const double b = m_samples[(index + 1) * CHANNELS + channel];
+      output[i * CHANNELS + channel] = static_cast<int16_t>(a + (b - a) * fraction);
+    }
+  }
+
+  const size_t consumed = static_cast<size_t>(end);
+  m_position = end - consumed;
+  m_samples.erase(m_samples.begin(), m_samples.begin() + consumed * CHANNELS);
+
+  return true;
+}
+
+void CAudioJitterBuffer::UpdateTarget(void)
+{
+  m_underrunPenaltyMs = std::max(m_underrunPenaltyMs - PENALTY_DECAY_MS, 0.0);
+
+  m_targetMs = MIN_DEPTH_MS + JITTER_MULTIPLIER * m_jitterMs + m_underrunPenaltyMs;
+  m_targetMs = std::min(m_targetMs, MAX_DEPTH_MS);
+}
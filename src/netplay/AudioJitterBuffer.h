@@ -0,0 +1,106 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+namespace NETPLAY
+{
+  class IFrontend;
+
+  /*!
+   * \brief Smooths out network jitter in audio received from a remote game
+   *
+   * Received chunks are buffered and played out to the local frontend at a
+   * steady pace. The buffer depth adapts to the measured arrival jitter and
+   * grows after underruns, then slowly shrinks back while playback is clean.
+   * Instead of jumping to a new depth, playback is resampled up to 2% faster
+   * or slower until the buffer reaches its target, which isn't audible.
+   *
+   * Audio is 16-bit interleaved stereo (GAME_AUDIO_FMT_S16NE).
+   */
+  class CAudioJitterBuffer : public PLATFORM::CThread
+  {
+  public:
+    CAudioJitterBuffer(IFrontend* frontend, double sampleRate);
+    virtual ~CAudioJitterBuffer(void) { Stop(); }
+
+    bool Start(void);
+    void Stop(void);
+
+    /*!
+     * \brief Add audio received from the network
+     */
+    void AddFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format);
+
+    /*!
+     * \brief Amount of audio currently buffered
+     */
+    unsigned int GetDepthMs(void);
+
+    /*!
+     * \brief Depth the buffer is converging on
+     */
+    unsigned int GetTargetDepthMs(void);
+
+    unsigned int GetUnderrunCount(void);
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    /*!
+     * \brief Take enough input to produce outputFrames frames, resampling to
+     *        nudge the depth toward its target
+     * \return false on underrun
+     */
+    bool Render(unsigned int outputFrames, std::vector<int16_t>& output);
+
+    void UpdateTarget(void);
+
+    double FramesToMs(size_t frames) const { return frames * 1000.0 / m_sampleRate; }
+
+    IFrontend* const      m_frontend;
+    const double          m_sampleRate;
+
+    std::deque<int16_t>   m_samples;        // Interleaved stereo
+    bool                  m_bPrimed;        // False while refilling after an underrun
+    unsigned int          m_underruns;
+
+    // Jitter estimate (RFC 3550 style smoothed deviation)
+    int64_t               m_lastArrivalMs;
+    double                m_lastChunkMs;
+    double                m_jitterMs;
+
+    double                m_underrunPenaltyMs;
+    double                m_targetMs;
+    double                m_position;       // Fractional read position for resampling
+
+    PLATFORM::CMutex      m_mutex;
+  };
+}
@@ -0,0 +1,63 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "BandwidthEstimator.h"
+
+using namespace NETPLAY;
+
+#define INITIAL_ESTIMATE  (1024.0 * 1024.0) // 1 MB/s until we know better
+#define SAMPLE_WINDOW_MS  50                // Aggregate writes into samples at least this long
+#define SMOOTHING         0.25              // Weight of a new sample
+
+CBandwidthEstimator::CBandwidthEstimator(void)
+{
+  Reset();
+}
+
+void CBandwidthEstimator::AddSample(size_t bytes, int64_t elapsedMs, bool bBacklogged)
+{
+  if (!bBacklogged)
+  {
+    // The link wasn't saturated, so this write only measured the socket
+    // buffer
+    m_pendingBytes = 0;
+    m_pendingMs = 0;
+    return;
+  }
+
+  m_pendingBytes += bytes;
+  m_pendingMs += elapsedMs;
+
+  if (m_pendingMs < SAMPLE_WINDOW_MS)
+    return;
+
+  const double sample = m_pendingBytes * 1000.0 / m_pendingMs;
+  m_bytesPerSecond = SMOOTHING * sample + (1.0 - SMOOTHING) * m_bytesPerSecond;
+
+  m_pendingBytes = 0;
+  m_pendingMs = 0;
+}
+
+void CBandwidthEstimator::Reset(void)
+{
+  m_bytesPerSecond = INITIAL_ESTIMATE;
+  m_pendingBytes = 0;
+  m_pendingMs = 0;
+}
@@ -0,0 +1,61 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Estimates the throughput of a link from how long blocking writes
+   *        take while data is backlogged
+   *
+   * A write to a socket with free buffer space returns immediately and says
+   * nothing about the link, so only writes made while more data was waiting
+   * count as samples. Samples are smoothed with an exponential moving
+   * average.
+   */
+  class CBandwidthEstimator
+  {
+  public:
+    CBandwidthEstimator(void);
+
+    /*!
+     * \brief Record a write
+     * \param bytes The number of bytes written
+     * \param elapsedMs Time the write blocked for
+     * \param bBacklogged True if more data was queued behind this write
+     */
+    void AddSample(size_t bytes, int64_t elapsedMs, bool bBacklogged);
+
+    /*!
+     * \brief Estimated throughput, in bytes per second
+     */
+    double BytesPerSecond(void) const { return m_bytesPerSecond; }
+
+    void Reset(void);
+
+  private:
+    double  m_bytesPerSecond;
+    size_t  m_pendingBytes;  // Backlogged bytes not yet covered by a sample
+    int64_t m_pendingMs;
+  };
+}
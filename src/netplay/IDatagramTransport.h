@@ -0,0 +1,47 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Unreliable, unordered datagrams to a single remote netplay instance
+   */
+  class IDatagramTransport
+  {
+  public:
+    virtual ~IDatagramTransport(void) { }
+
+    /*!
+     * \brief Send a datagram. Delivery isn't guaranteed.
+     * \return false on a local error
+     */
+    virtual bool SendDatagram(const uint8_t* data, size_t size) = 0;
+
+    /*!
+     * \brief Receive a datagram, waiting up to timeoutMs
+     * \return The datagram's size, or 0 if none arrived
+     */
+    virtual size_t ReceiveDatagram(uint8_t* buffer, size_t size, unsigned int timeoutMs) = 0;
+  };
+}
@@ -0,0 +1,51 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+namespace game
+{
+  class InputLog;
+  class StateChunk;
+}
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Connection to a remote netplay instance that mirrors our game
+   */
+  class IPeer
+  {
+  public:
+    virtual ~IPeer(void) { }
+
+    /*!
+     * \brief Send part of a savestate. May block on the network; this is
+     *        called from a background thread.
+     * \return false if the peer disconnected
+     */
+    virtual bool SendStateChunk(const game::StateChunk& chunk) = 0;
+
+    /*!
+     * \brief Send inputs the peer needs to replay to reach our frame
+     * \return false if the peer disconnected
+     */
+    virtual bool SendInputLog(const game::InputLog& log) = 0;
+  };
+}
@@ -0,0 +1,41 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Reliable, ordered byte stream to a remote netplay instance
+   */
+  class ITransport
+  {
+  public:
+    virtual ~ITransport(void) { }
+
+    /*!
+     * \brief Write all bytes, blocking while the link is congested
+     * \return false if the connection was lost
+     */
+    virtual bool Send(const uint8_t* data, size_t size) = 0;
+  };
+}
@@ -0,0 +1,291 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "InputChannel.h"
+#include "IDatagramTransport.h"
+#include "log/Log.h"
+
+#include "game.pb.h"
+
+#include <algorithm>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define MAX_REDUNDANT_FRAMES  32   // Unacknowledged frames repeated in each packet (~0.5s at 60fps)
+#define PARITY_GROUP_SIZE     4    // Packets covered by each parity packet
+#define RECENT_PACKET_COUNT   64   // Received packets kept for parity recovery
+#define MAX_DATAGRAM_SIZE     65507 // Largest UDP payload; packets are usually far smaller
+
+namespace NETPLAY
+{
+  /*!
+   * \brief XOR a length-prefixed packet into a parity buffer
+   */
+  void XorPacket(const std::string& packet, std::string& parity)
+  {
+    if (parity.size() < packet.size() + 2)
+      parity.resize(packet.size() + 2, '\0');
+
+    parity[0] ^= static_cast<char>(packet.size() >> 8);
+    parity[1] ^= static_cast<char>(packet.size() & 0xff);
+
+    for (size_t i = 0; i < packet.size(); i++)
+      parity[i + 2] ^= packet[i];
+  }
+}
+
+CInputChannel::CInputChannel(IDatagramTransport* transport, IInputChannelCallback* callback, bool bParity /* = true */) :
+  m_transport(transport),
+  m_callback(callback),
+  m_bParity(bParity),
+  m_sequence(0),
+  m_parityFirstSequence(0),
+  m_bNeedsResync(false),
+  m_nextFrame(0),
+  m_recoveredPackets(0),
+  m_receiveBuffer(MAX_DATAGRAM_SIZE)
+{
+}
+
+void CInputChannel::SendFrame(uint64_t frame, const std::deque<InputLogEntry>& entries)
+{
+  CLockObject lock(m_mutex);
+
+  m_unacked[frame] = entries;
+
+  while (m_unacked.size() > MAX_REDUNDANT_FRAMES)
+  {
+    m_unacked.erase(m_unacked.begin());
+    if (!m_bNeedsResync)
+    {
+      esyslog("Peer stopped acknowledging input, frames were dropped");
+      m_bNeedsResync = true;
+    }
+  }
+
+  game::InputPacket packet;
+  packet.set_sequence(m_sequence);
+  packet.set_ack_frame(m_nextFrame);
+  packet.set_first_frame(m_unacked.begin()->first);
+  packet.set_end_frame(frame + 1);
+
+  for (std::map<uint64_t, std::deque<InputLogEntry> >::const_iterator it = m_unacked.begin(); it != m_unacked.end(); ++it)
+  {
+    for (std::deque<InputLogEntry>::const_iterator itEntry = it->second.begin(); itEntry != it->second.end(); ++itEntry)
+    {
+      game::InputLogEntry* entry = packet.add_entries();
+      entry->set_frame(it->first);
+      entry->set_port(itEntry->port);
+      itEntry->event.ToMessage(*entry->mutable_event());
+    }
+  }
+
+  // Serialize once, parity must cover exactly the bytes that were sent
+  const std::string packetBytes = packet.SerializeAsString();
+
+  game::InputDatagram datagram;
+  datagram.set_packet(packetBytes);
+
+  const std::string bytes = datagram.SerializeAsString();
+  m_transport->SendDatagram(reinterpret_cast<const uint8_t*>(bytes.c_str()), bytes.size());
+
+  if (m_bParity)
+  {
+    if (m_parityGroup.empty())
+      m_parityFirstSequence = m_sequence;
+
+    m_parityGroup.push_back(packetBytes);
+
+    if (m_parityGroup.size() == PARITY_GROUP_SIZE)
+      SendParity();
+  }
+
+  m_sequence++;
+}
+
+void CInputChannel::SendParity(void)
+{
+  game::InputDatagram datagram;
+  game::InputParity* parity = datagram.mutable_parity();
+  parity->set_first_sequence(m_parityFirstSequence);
+  parity->set_count(m_parityGroup.size());
+
+  std::string parityBytes;
+  for (std::vector<std::string>::const_iterator it = m_parityGroup.begin(); it != m_parityGroup.end(); ++it)
+    XorPacket(*it, parityBytes);
+  parity->set_parity(parityBytes);
+
+  const std::string bytes = datagram.SerializeAsString();
+  m_transport->SendDatagram(reinterpret_cast<const uint8_t*>(bytes.c_str()), bytes.size());
+
+  m_parityGroup.clear();
+}
+
+bool CInputChannel::Receive(unsigned int timeoutMs)
+{
+  const size_t size = m_transport->ReceiveDatagram(m_receiveBuffer.data(), m_receiveBuffer.size(), timeoutMs);
+  if (size == 0)
+    return false;
+
+  game::InputDatagram datagram;
+  if (!datagram.ParseFromArray(m_receiveBuffer.data(), size))
+  {
+    dsyslog("Dropping malformed input datagram");
+    return true;
+  }
+
+  InputFrames frames;
+  {
+    CLockObject lock(m_mutex);
+
+    if (datagram.has_packet())
+    {
+      game::InputPacket packet;
+      if (packet.ParseFromString(datagram.packet()))
+        HandlePacket(packet, datagram.packet(), frames);
+      else
+        dsyslog("Dropping malformed input packet");
+    }
+
+    if (datagram.has_parity())
+      HandleParity(datagram.parity(), frames);
+  }
+
+  // Deliver without holding the lock, the callback may run a frame
+  for (InputFrames::const_iterator it = frames.begin(); it != frames.end(); ++it)
+    m_callback->OnInputFrame(it->first, it->second);
+
+  return true;
+}
+
+void CInputChannel::HandlePacket(const game::InputPacket& packet, const std::string& bytes, InputFrames& frames)
+{
+  // An honest peer never sends more than its redundancy window, don't let a
+  // bogus range make us allocate frames
+  if (packet.end_frame() < packet.first_frame() ||
+      (packet.end_frame() > m_nextFrame && packet.end_frame() - m_nextFrame > MAX_REDUNDANT_FRAMES))
+  {
+    esyslog("Rejecting input packet with invalid frame range [%llu, %llu)",
+            static_cast<unsigned long long>(packet.first_frame()), static_cast<unsigned long long>(packet.end_frame()));
+    m_bNeedsResync = true;
+    return;
+  }
+
+  // The peer has everything before ack_frame
+  while (!m_unacked.empty() && m_unacked.begin()->first < packet.ack_frame())
+    m_unacked.erase(m_unacked.begin());
+
+  RememberPacket(packet.sequence(), bytes);
+
+  if (packet.end_frame() <= m_nextFrame)
+    return; // Nothing new
+
+  if (packet.first_frame() > m_nextFrame)
+  {
+    // Only possible if the sender gave up on frames we never acknowledged
+    dsyslog("Input gap: expected frame %llu, packet starts at %llu",
+            static_cast<unsigned long long>(m_nextFrame), static_cast<unsigned long long>(packet.first_frame()));
+    return;
+  }
+
+  const size_t firstNew = frames.size();
+  for (uint64_t frame = m_nextFrame; frame < packet.end_frame(); frame++)
+    frames.push_back(std::make_pair(frame, std::deque<InputLogEntry>()));
+
+  for (int i = 0; i < packet.entries_size(); i++)
+  {
+    const game::InputLogEntry& entryMsg = packet.entries(i);
+    if (entryMsg.frame() < m_nextFrame || entryMsg.frame() >= packet.end_frame())
+      continue;
+
+    InputLogEntry entry;
+    entry.frame = entryMsg.frame();
+    entry.port = entryMsg.port();
+    if (entry.event.FromMessage(entryMsg.event()))
+      frames[firstNew + (entry.frame - m_nextFrame)].second.push_back(entry);
+  }
+
+  m_nextFrame = packet.end_frame();
+}
+
+void CInputChannel::HandleParity(const game::InputParity& parity, InputFrames& frames)
+{
+  if (parity.count() == 0 || parity.count() > PARITY_GROUP_SIZE)
+  {
+    dsyslog("Dropping parity packet covering %u packets", parity.count());
+    return;
+  }
+
+  std::string recovered = parity.parity();
+  uint32_t missingSequence = 0;
+  unsigned int missingCount = 0;
+
+  // Count from zero so a group that wraps the sequence number can't overflow the bound
+  for (uint32_t i = 0; i < parity.count(); i++)
+  {
+    const uint32_t sequence = parity.first_sequence() + i;
+    std::map<uint32_t, std::string>::const_iterator it = m_recentPackets.find(sequence);
+    if (it == m_recentPackets.end())
+    {
+      missingSequence = sequence;
+      missingCount++;
+    }
+    else
+    {
+      XorPacket(it->second, recovered);
+    }
+  }
+
+  // Parity can only rebuild a single missing packet
+  if (missingCount != 1 || recovered.size() < 2)
+    return;
+
+  const size_t length = (static_cast<uint8_t>(recovered[0]) << 8) | static_cast<uint8_t>(recovered[1]);
+  if (length > recovered.size() - 2)
+    return;
+
+  game::InputPacket packet;
+  if (!packet.ParseFromArray(recovered.data() + 2, length) || packet.sequence() != missingSequence)
+    return;
+
+  m_recoveredPackets++;
+  HandlePacket(packet, recovered.substr(2, length), frames);
+}
+
+void CInputChannel::RememberPacket(uint32_t sequence, const std::string& bytes)
+{
+  m_recentPackets[sequence] = bytes;
+
+  while (m_recentPackets.size() > RECENT_PACKET_COUNT)
+    m_recentPackets.erase(m_recentPackets.begin());
+}
+
+bool CInputChannel::NeedsResync(void)
+{
+  CLockObject lock(m_mutex);
+  return m_bNeedsResync;
+}
+
+unsigned int CInputChannel::RecoveredPackets(void)
+{
+  CLockObject lock(m_mutex);
+  return m_recoveredPackets;
+}
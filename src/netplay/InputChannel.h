@@ -0,0 +1,118 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "InputLog.h"
+
+#include "platform/threads/mutex.h"
+
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace game
+{
+  class InputPacket;
+  class InputParity;
+}
+
+namespace NETPLAY
+{
+  class IDatagramTransport;
+
+  typedef std::vector<std::pair<uint64_t, std::deque<InputLogEntry> > > InputFrames;
+
+  class IInputChannelCallback
+  {
+  public:
+    virtual ~IInputChannelCallback(void) { }
+
+    /*!
+     * \brief Called once per frame, in frame order, with the peer's inputs
+     *        for that frame (possibly none)
+     */
+    virtual void OnInputFrame(uint64_t frame, const std::deque<InputLogEntry>& entries) = 0;
+  };
+
+  /*!
+   * \brief Latency-critical input exchange over UDP
+   *
+   * Each packet carries every frame of input the peer hasn't acknowledged,
+   * so a lost packet is repaired by the next one without a round trip.
+   * Optionally, every few packets are followed by an XOR parity packet that
+   * recovers a single loss within the group, which covers short bursts when
+   * the sender is idle between frames.
+   *
+   * SendFrame() and Receive() may be called from different threads.
+   */
+  class CInputChannel
+  {
+  public:
+    CInputChannel(IDatagramTransport* transport, IInputChannelCallback* callback, bool bParity = true);
+
+    /*!
+     * \brief Send our inputs for a frame. Must be called for every frame, in
+     *        order, even without input.
+     */
+    void SendFrame(uint64_t frame, const std::deque<InputLogEntry>& entries);
+
+    /*!
+     * \brief Process incoming datagrams for up to timeoutMs
+     * \return false if nothing was received
+     */
+    bool Receive(unsigned int timeoutMs);
+
+    /*!
+     * \brief True if the peer fell so far behind that frames were dropped from
+     *        the redundant history. The peer needs a new savestate.
+     */
+    bool NeedsResync(void);
+
+    unsigned int RecoveredPackets(void);
+
+  private:
+    void SendParity(void);
+    void HandlePacket(const game::InputPacket& packet, const std::string& bytes, InputFrames& frames);
+    void HandleParity(const game::InputParity& parity, InputFrames& frames);
+    void RememberPacket(uint32_t sequence, const std::string& bytes);
+
+    IDatagramTransport* const    m_transport;
+    IInputChannelCallback* const m_callback;
+    const bool                   m_bParity;
+
+    // Sending
+    std::map<uint64_t, std::deque<InputLogEntry> > m_unacked; // By frame
+    uint32_t                     m_sequence;
+    std::vector<std::string>     m_parityGroup;               // Packets since the last parity
+    uint32_t                     m_parityFirstSequence;
+    bool                         m_bNeedsResync;
+
+    // Receiving
+    uint64_t                     m_nextFrame;                 // Next frame expected, sent as our ack
+    std::map<uint32_t, std::string> m_recentPackets;          // By sequence, for parity recovery
+    unsigned int                 m_recoveredPackets;
+    std::vector<uint8_t>         m_receiveBuffer;
+
+    PLATFORM::CMutex             m_mutex;
+  };
+}
@@ -0,0 +1,91 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "InputLog.h"
+
+#include "game.pb.h"
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+void CInputLog::Append(uint64_t frame, unsigned int port, const game_input_event& event)
+{
+  InputLogEntry entry = { frame, port, CGameInputEvent(event) };
+
+  CLockObject lock(m_mutex);
+  m_entries.push_back(entry);
+}
+
+void CInputLog::GetSince(uint64_t frame, std::deque<InputLogEntry>& entries) const
+{
+  CLockObject lock(m_mutex);
+
+  for (std::deque<InputLogEntry>::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+  {
+    if (it->frame >= frame)
+      entries.push_back(*it);
+  }
+}
+
+void CInputLog::Trim(uint64_t frame)
+{
+  CLockObject lock(m_mutex);
+
+  // Entries are appended in frame order
+  while (!m_entries.empty() && m_entries.front().frame < frame)
+    m_entries.pop_front();
+}
+
+void CInputLog::Clear(void)
+{
+  CLockObject lock(m_mutex);
+  m_entries.clear();
+}
+
+void CInputLog::ToMessage(const std::deque<InputLogEntry>& entries, uint64_t liveFrame, game::InputLog& msg)
+{
+  msg.set_live_frame(liveFrame);
+
+  for (std::deque<InputLogEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+  {
+    game::InputLogEntry* entry = msg.add_entries();
+    entry->set_frame(it->frame);
+    entry->set_port(it->port);
+    it->event.ToMessage(*entry->mutable_event());
+  }
+}
+
+bool CInputLog::FromMessage(const game::InputLog& msg, std::deque<InputLogEntry>& entries)
+{
+  for (int i = 0; i < msg.entries_size(); i++)
+  {
+    const game::InputLogEntry& entryMsg = msg.entries(i);
+
+    InputLogEntry entry;
+    entry.frame = entryMsg.frame();
+    entry.port = entryMsg.port();
+    if (!entry.event.FromMessage(entryMsg.event()))
+      return false;
+
+    entries.push_back(entry);
+  }
+
+  return true;
+}
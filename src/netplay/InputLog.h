@@ -0,0 +1,79 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "input/GameInputEvent.h"
+
+#include "platform/threads/mutex.h"
+
+#include <deque>
+#include <stdint.h>
+
+namespace game
+{
+  class InputLog;
+}
+
+namespace NETPLAY
+{
+  struct InputLogEntry
+  {
+    uint64_t        frame;
+    unsigned int    port;
+    CGameInputEvent event;
+  };
+
+  /*!
+   * \brief Inputs received by the game client, tagged with the frame they
+   *        were applied before
+   *
+   * Replaying the log on top of a savestate taken at frame N reproduces every
+   * frame after N.
+   */
+  class CInputLog
+  {
+  public:
+    CInputLog(void) { }
+
+    void Append(uint64_t frame, unsigned int port, const game_input_event& event);
+
+    /*!
+     * \brief Get all entries applied at or after the given frame
+     */
+    void GetSince(uint64_t frame, std::deque<InputLogEntry>& entries) const;
+
+    /*!
+     * \brief Forget entries applied before the given frame
+     */
+    void Trim(uint64_t frame);
+
+    void Clear(void);
+
+    /*!
+     * \brief Convert entries to and from the message sent to a joining peer
+     */
+    static void ToMessage(const std::deque<InputLogEntry>& entries, uint64_t liveFrame, game::InputLog& msg);
+    static bool FromMessage(const game::InputLog& msg, std::deque<InputLogEntry>& entries);
+
+  private:
+    std::deque<InputLogEntry> m_entries;
+    mutable PLATFORM::CMutex  m_mutex;
+  };
+}
@@ -0,0 +1,200 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MemoryWatch.h"
+#include "log/Log.h"
+
+#include "game.pb.h"
+
+#include <algorithm>
+
+using namespace NETPLAY;
+
+#define MAX_WATCH_RANGES  256
+#define MAX_WATCH_BYTES   (64 * 1024) // Per peer, bounds what a single frame can send
+
+CMemoryWatch::CMemoryWatch(IGame* game) :
+  m_tracker(game),
+  m_frame(0)
+{
+}
+
+bool CMemoryWatch::Subscribe(IPeer* peer, const game::MemoryWatchSubscribe& msg)
+{
+  if (msg.ranges_size() == 0)
+  {
+    Unsubscribe(peer);
+    return true;
+  }
+
+  if (msg.ranges_size() > MAX_WATCH_RANGES)
+  {
+    esyslog("Memory watch rejected, %d ranges (max %u)", msg.ranges_size(), MAX_WATCH_RANGES);
+    return false;
+  }
+
+  Subscription subscription;
+  size_t totalBytes = 0;
+
+  for (int i = 0; i < msg.ranges_size(); i++)
+  {
+    const game::MemoryWatchRange& range = msg.ranges(i);
+    if (range.type() > GAME_MEMORY_VIDEO_RAM)
+    {
+      esyslog("Memory watch rejected, invalid memory type %u", range.type());
+      return false;
+    }
+
+    if (range.length() == 0)
+      continue;
+
+    MemoryRange watched = { range.offset(), range.length() };
+    subscription[static_cast<GAME_MEMORY>(range.type())].ranges.push_back(watched);
+  }
+
+  for (Subscription::iterator it = subscription.begin(); it != subscription.end(); ++it)
+  {
+    CMemoryTracker::NormalizeRanges(it->second.ranges);
+    it->second.bNew = true;
+
+    for (std::vector<MemoryRange>::const_iterator range = it->second.ranges.begin(); range != it->second.ranges.end(); ++range)
+      totalBytes += range->length;
+  }
+
+  if (totalBytes > MAX_WATCH_BYTES)
+  {
+    esyslog("Memory watch rejected, %u bytes (max %u)", static_cast<unsigned int>(totalBytes), MAX_WATCH_BYTES);
+    return false;
+  }
+
+  m_subscribers[peer].swap(subscription);
+  UpdateTracking();
+
+  dsyslog("Peer is watching %u bytes of memory", static_cast<unsigned int>(totalBytes));
+
+  return true;
+}
+
+void CMemoryWatch::Unsubscribe(IPeer* peer)
+{
+  if (m_subscribers.erase(peer) > 0)
+    UpdateTracking();
+}
+
+void CMemoryWatch::Update(uint64_t frame)
+{
+  m_tracker.Update();
+  m_frame = frame;
+}
+
+bool CMemoryWatch::TakeUpdate(IPeer* peer, game::MemoryWatchUpdate& update)
+{
+  update.Clear();
+
+  std::map<IPeer*, Subscription>::iterator it = m_subscribers.find(peer);
+  if (it == m_subscribers.end())
+    return false;
+
+  update.set_frame(m_frame);
+
+  std::vector<MemoryRange> dirty;
+  std::vector<MemoryRange> changed;
+
+  for (Subscription::iterator watch = it->second.begin(); watch != it->second.end(); ++watch)
+  {
+    const uint8_t* data;
+    size_t size;
+    if (!m_tracker.GetShadow(watch->first, data, size) || !m_tracker.GetDirtyRanges(watch->first, dirty))
+      continue;
+
+    if (watch->second.bNew)
+    {
+      changed = watch->second.ranges;
+      watch->second.bNew = false;
+    }
+    else
+    {
+      Intersect(watch->second.ranges, dirty, changed);
+    }
+
+    for (std::vector<MemoryRange>::const_iterator range = changed.begin(); range != changed.end() && range->offset < size; ++range)
+    {
+      game::MemoryWatchChange* change = update.add_changes();
+      change->set_type(watch->first);
+      change->set_offset(range->offset);
+      change->set_data(data + range->offset, std::min(range->length, size - range->offset));
+    }
+  }
+
+  return update.changes_size() > 0;
+}
+
+void CMemoryWatch::UpdateTracking(void)
+{
+  std::map<GAME_MEMORY, std::vector<MemoryRange> > watched;
+
+  for (std::map<IPeer*, Subscription>::const_iterator peer = m_subscribers.begin(); peer != m_subscribers.end(); ++peer)
+  {
+    for (Subscription::const_iterator watch = peer->second.begin(); watch != peer->second.end(); ++watch)
+    {
+      std::vector<MemoryRange>& ranges = watched[watch->first];
+      ranges.insert(ranges.end(), watch->second.ranges.begin(), watch->second.ranges.end());
+    }
+  }
+
+  for (int type = GAME_MEMORY_SAVE_RAM; type <= GAME_MEMORY_VIDEO_RAM; type++)
+  {
+    const GAME_MEMORY memoryType = static_cast<GAME_MEMORY>(type);
+
+    std::map<GAME_MEMORY, std::vector<MemoryRange> >::const_iterator it = watched.find(memoryType);
+    if (it != watched.end())
+      m_tracker.Track(memoryType, it->second);
+    else
+      m_tracker.Untrack(memoryType);
+  }
+}
+
+void CMemoryWatch::Intersect(const std::vector<MemoryRange>& a, const std::vector<MemoryRange>& b, std::vector<MemoryRange>& result)
+{
+  result.clear();
+
+  std::vector<MemoryRange>::const_iterator itA = a.begin();
+  std::vector<MemoryRange>::const_iterator itB = b.begin();
+
+  while (itA != a.end() && itB != b.end())
+  {
+    const size_t endA = itA->offset + itA->length;
+    const size_t endB = itB->offset + itB->length;
+
+    const size_t start = std::max(itA->offset, itB->offset);
+    const size_t end = std::min(endA, endB);
+
+    if (start < end)
+    {
+      MemoryRange range = { start, end - start };
+      result.push_back(range);
+    }
+
+    if (endA < endB)
+      ++itA;
+    else
+      ++itB;
+  }
+}
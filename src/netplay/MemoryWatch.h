@@ -0,0 +1,98 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "interface/MemoryTracker.h"
+
+#include "kodi/kodi_game_types.h"
+
+#include <map>
+#include <stdint.h>
+#include <vector>
+
+namespace game
+{
+  class MemoryWatchSubscribe;
+  class MemoryWatchUpdate;
+}
+
+namespace NETPLAY
+{
+  class IGame;
+  class IPeer;
+
+  /*!
+   * \brief Sends peers the bytes of the memory ranges they watch that
+   *        changed each frame
+   *
+   * Only the union of all watched ranges is diffed (see CMemoryTracker). A
+   * new subscriber first receives all of its watched bytes, then only changes.
+   * Changing the union restarts tracking, so subscriptions are meant to be
+   * set up once rather than changed every frame.
+   */
+  class CMemoryWatch
+  {
+  public:
+    CMemoryWatch(IGame* game);
+
+    /*!
+     * \brief Replace a peer's subscription, no ranges unsubscribes
+     * \return false if the subscription was rejected
+     */
+    bool Subscribe(IPeer* peer, const game::MemoryWatchSubscribe& msg);
+    void Unsubscribe(IPeer* peer);
+
+    bool HasSubscribers(void) const { return !m_subscribers.empty(); }
+
+    /*!
+     * \brief Find the changes made by a frame, call after each frame
+     */
+    void Update(uint64_t frame);
+
+    /*!
+     * \brief Get the changes to send to a peer for the last frame
+     * \return false if nothing the peer watches has changed
+     */
+    bool TakeUpdate(IPeer* peer, game::MemoryWatchUpdate& update);
+
+  private:
+    struct Watch
+    {
+      std::vector<MemoryRange> ranges; // Sorted and disjoint
+      bool                     bNew;   // Not sent yet, send all of it
+    };
+
+    typedef std::map<GAME_MEMORY, Watch> Subscription;
+
+    /*!
+     * \brief Diff only what someone still watches
+     */
+    void UpdateTracking(void);
+
+    /*!
+     * \brief Intersect two lists of sorted, disjoint ranges
+     */
+    static void Intersect(const std::vector<MemoryRange>& a, const std::vector<MemoryRange>& b, std::vector<MemoryRange>& result);
+
+    CMemoryTracker                m_tracker;
+    std::map<IPeer*, Subscription> m_subscribers;
+    uint64_t                      m_frame;
+  };
+}
@@ -0,0 +1,442 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "NetplayGame.h"
+#include "IPeer.h"
+#include "interface/FrontendManager.h"
+#include "log/Log.h"
+
+#include "game.pb.h"
+
+#include <algorithm>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define MAX_CATCHUP_FRAMES  8 // Frames replayed silently per frame while catching up
+
+CNetplayGame::CNetplayGame(IGame* game, CFrontendManager* callbacks) :
+  m_game(game),
+  m_callbacks(callbacks),
+  m_frame(0),
+  m_memoryWatch(game),
+  m_liveFrame(0),
+  m_bCatchingUp(false),
+  m_bDirectCalls(false)
+{
+}
+
+CNetplayGame::~CNetplayGame(void)
+{
+  std::vector<CStateSender*> senders;
+  {
+    CLockObject lock(m_mutex);
+    senders.swap(m_senders);
+    senders.insert(senders.end(), m_finishedSenders.begin(), m_finishedSenders.end());
+    m_finishedSenders.clear();
+  }
+
+  for (std::vector<CStateSender*>::iterator it = senders.begin(); it != senders.end(); ++it)
+    delete *it;
+
+  delete m_game;
+}
+
+bool CNetplayGame::AddPeer(IPeer* peer)
+{
+  ReapSenders();
+
+  // From here on every frame must be counted and every input logged
+  m_directGate.Close();
+
+  CLockObject lock(m_mutex);
+
+  // Holding m_mutex keeps FrameEvent() out, so the state is captured between
+  // two frames. This is the only work the running game pays for the join.
+  std::vector<uint8_t> state(m_game->SerializeSize());
+  if (state.empty() || m_game->Serialize(state.data(), state.size()) != GAME_ERROR_NO_ERROR)
+  {
+    esyslog("Failed to serialize game for joining peer");
+    return false;
+  }
+
+  isyslog("Sending %u byte savestate of frame %llu to joining peer",
+          static_cast<unsigned int>(state.size()), static_cast<unsigned long long>(m_frame));
+
+  CStateSender* sender = new CStateSender(peer, state, m_frame, this);
+  m_senders.push_back(sender);
+  sender->CreateThread(false);
+
+  return true;
+}
+
+void CNetplayGame::RemovePeer(IPeer* peer)
+{
+  CStateSender* sender = NULL;
+  {
+    CLockObject lock(m_mutex);
+
+    m_livePeers.erase(std::remove(m_livePeers.begin(), m_livePeers.end(), peer), m_livePeers.end());
+    m_memoryWatch.Unsubscribe(peer);
+
+    for (std::vector<CStateSender*>::iterator it = m_senders.begin(); it != m_senders.end(); ++it)
+    {
+      if ((*it)->Peer() == peer)
+      {
+        sender = *it;
+        m_senders.erase(it);
+        break;
+      }
+    }
+
+    TrimInputLog();
+  }
+
+  // The sender's thread may be waiting for m_mutex in OnStateSent()
+  delete sender;
+}
+
+void CNetplayGame::OnStateSent(IPeer* peer, uint64_t frame, bool bSuccess)
+{
+  CLockObject lock(m_mutex);
+
+  std::vector<CStateSender*>::iterator it;
+  for (it = m_senders.begin(); it != m_senders.end(); ++it)
+  {
+    if ((*it)->Peer() == peer)
+      break;
+  }
+
+  if (it == m_senders.end())
+    return; // Peer was removed
+
+  m_finishedSenders.push_back(*it);
+  m_senders.erase(it);
+
+  if (bSuccess)
+  {
+    // Everything the peer needs to replay from the savestate to our frame
+    std::deque<InputLogEntry> entries;
+    m_inputLog.GetSince(frame, entries);
+
+    game::InputLog log;
+    CInputLog::ToMessage(entries, m_frame, log);
+
+    if (peer->SendInputLog(log))
+    {
+      isyslog("Peer joined at frame %llu, replaying %llu frames",
+              static_cast<unsigned long long>(frame), static_cast<unsigned long long>(m_frame - frame));
+      m_livePeers.push_back(peer);
+    }
+  }
+
+  TrimInputLog();
+}
+
+bool CNetplayGame::OnMemoryWatchSubscribe(IPeer* peer, const game::MemoryWatchSubscribe& msg)
+{
+  m_directGate.Close();
+
+  CLockObject lock(m_mutex);
+  return m_memoryWatch.Subscribe(peer, msg);
+}
+
+void CNetplayGame::OnStateChunk(const game::StateChunk& chunk)
+{
+  m_directGate.Close();
+
+  CLockObject lock(m_mutex);
+
+  if (!m_receiver.AddChunk(chunk))
+    m_receiver.Reset();
+}
+
+void CNetplayGame::OnInputLog(const game::InputLog& log)
+{
+  m_directGate.Close();
+
+  CLockObject lock(m_mutex);
+
+  if (!CInputLog::FromMessage(log, m_pendingInputs))
+  {
+    esyslog("Received invalid input log");
+    return;
+  }
+
+  m_liveFrame = std::max(m_liveFrame, static_cast<uint64_t>(log.live_frame()));
+
+  // The first log after a savestate completes the join
+  if (m_receiver.IsComplete())
+  {
+    const std::vector<uint8_t>& state = m_receiver.State();
+    if (m_game->Deserialize(state.data(), state.size()) == GAME_ERROR_NO_ERROR)
+    {
+      m_frame = m_receiver.Frame();
+      m_bCatchingUp = true;
+
+      while (!m_pendingInputs.empty() && m_pendingInputs.front().frame < m_frame)
+        m_pendingInputs.pop_front();
+
+      isyslog("Loaded savestate of frame %llu, catching up to frame %llu",
+              static_cast<unsigned long long>(m_frame), static_cast<unsigned long long>(m_liveFrame));
+    }
+    else
+    {
+      esyslog("Failed to load savestate from host");
+    }
+
+    m_receiver.Reset();
+  }
+}
+
+void CNetplayGame::StageInput(unsigned int port, const game_input_event& event)
+{
+  if (!m_staging.Stage(port, event))
+    esyslog("Too much input staged for one frame, dropping event on port %u", port);
+
+  // Staged input is only applied by FrameEvent()
+  m_directGate.Close();
+}
+
+void CNetplayGame::OnInputFrame(uint64_t frame, const std::deque<InputLogEntry>& entries)
+{
+  // Applied at our next frame, and logged there for peers to replay
+  for (std::deque<InputLogEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    StageInput(it->port, it->event.Get());
+}
+
+bool CNetplayGame::IsCatchingUp(void)
+{
+  CLockObject lock(m_mutex);
+  return m_bCatchingUp;
+}
+
+GAME_ERROR CNetplayGame::LoadGame(const char* url)
+{
+  CLockObject lock(m_mutex);
+  ResetSession();
+  return m_game->LoadGame(url);
+}
+
+GAME_ERROR CNetplayGame::LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount)
+{
+  CLockObject lock(m_mutex);
+  ResetSession();
+  return m_game->LoadGameSpecial(type, urls, urlCount);
+}
+
+GAME_ERROR CNetplayGame::LoadStandalone(void)
+{
+  CLockObject lock(m_mutex);
+  ResetSession();
+  return m_game->LoadStandalone();
+}
+
+GAME_ERROR CNetplayGame::UnloadGame(void)
+{
+  m_directGate.Close();
+
+  CLockObject lock(m_mutex);
+  ResetSession();
+  m_bDirectCalls = false;
+  return m_game->UnloadGame();
+}
+
+bool CNetplayGame::GetDirectCalls(GameDirectCalls& calls)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_game->GetDirectCalls(calls))
+    return false;
+
+  // Calls may only skip this layer while it has nothing to do
+  calls.gate = &m_directGate;
+  m_bDirectCalls = true;
+
+  if (IsIdle())
+    m_directGate.Open();
+
+  return true;
+}
+
+void CNetplayGame::FrameEvent(void)
+{
+  ReapSenders();
+
+  CLockObject lock(m_mutex);
+
+  if (m_bCatchingUp)
+  {
+    // Another layer may have disabled video or audio, leave it that way
+    const bool bVideoEnabled = m_callbacks->IsVideoEnabled();
+    const bool bAudioEnabled = m_callbacks->IsAudioEnabled();
+
+    m_callbacks->SetAVEnabled(false);
+
+    for (unsigned int i = 0; i < MAX_CATCHUP_FRAMES && m_frame + 1 < m_liveFrame; i++)
+      RunFrame();
+
+    m_callbacks->SetVideoEnabled(bVideoEnabled);
+    m_callbacks->SetAudioEnabled(bAudioEnabled);
+
+    if (m_frame + 1 >= m_liveFrame)
+    {
+      isyslog("Caught up with host at frame %llu", static_cast<unsigned long long>(m_frame));
+      m_bCatchingUp = false;
+    }
+  }
+
+  RunFrame();
+
+  if (m_bDirectCalls && IsIdle())
+  {
+    m_directGate.Open();
+
+    // Input staged since the check above would otherwise wait for a peer
+    if (!m_staging.IsEmpty())
+      m_directGate.Close();
+  }
+}
+
+bool CNetplayGame::InputEvent(unsigned int port, const game_input_event* event)
+{
+  CLockObject lock(m_mutex);
+
+  // Only log while a peer may need to replay this frame
+  if (!m_senders.empty() || !m_livePeers.empty())
+    m_inputLog.Append(m_frame, port, *event);
+
+  return m_game->InputEvent(port, event);
+}
+
+unsigned int CNetplayGame::InputEvents(unsigned int port, const game_input_event* events, unsigned int count)
+{
+  CLockObject lock(m_mutex);
+
+  if (!m_senders.empty() || !m_livePeers.empty())
+  {
+    for (unsigned int i = 0; i < count; i++)
+      m_inputLog.Append(m_frame, port, events[i]);
+  }
+
+  return m_game->InputEvents(port, events, count);
+}
+
+void CNetplayGame::RunFrame(void)
+{
+  while (!m_pendingInputs.empty() && m_pendingInputs.front().frame <= m_frame)
+  {
+    const InputLogEntry& entry = m_pendingInputs.front();
+    StagedInput input = { entry.port, entry.event };
+    m_frameInputs.push_back(input);
+    m_pendingInputs.pop_front();
+  }
+
+  const size_t firstStaged = m_frameInputs.size();
+  m_staging.Drain(m_frameInputs);
+
+  // Staged input is applied at this frame, peers need to replay it too
+  if (!m_senders.empty() || !m_livePeers.empty())
+  {
+    for (size_t i = firstStaged; i < m_frameInputs.size(); i++)
+      m_inputLog.Append(m_frame, m_frameInputs[i].port, m_frameInputs[i].event.Get());
+  }
+
+  if (!m_frameInputs.empty())
+  {
+    m_staging.Apply(m_game, m_frameInputs);
+    m_frameInputs.clear();
+  }
+
+  m_game->FrameEvent();
+
+  if (m_memoryWatch.HasSubscribers())
+    m_memoryWatch.Update(m_frame);
+
+  if (!m_livePeers.empty())
+  {
+    std::deque<InputLogEntry> entries;
+    m_inputLog.GetSince(m_frame, entries);
+
+    game::InputLog log;
+    CInputLog::ToMessage(entries, m_frame + 1, log);
+
+    for (std::vector<IPeer*>::iterator it = m_livePeers.begin(); it != m_livePeers.end(); )
+    {
+      // Memory changes ride along with the frame's input
+      if (!m_memoryWatch.TakeUpdate(*it, *log.mutable_memory_watch()))
+        log.clear_memory_watch();
+
+      if ((*it)->SendInputLog(log))
+      {
+        ++it;
+      }
+      else
+      {
+        esyslog("Peer disconnected");
+        it = m_livePeers.erase(it);
+      }
+    }
+  }
+
+  m_frame++;
+
+  TrimInputLog();
+}
+
+void CNetplayGame::TrimInputLog(void)
+{
+  // Senders need everything since their savestate, live peers have been sent
+  // everything before the current frame
+  uint64_t oldestFrame = m_frame;
+  for (std::vector<CStateSender*>::const_iterator it = m_senders.begin(); it != m_senders.end(); ++it)
+    oldestFrame = std::min(oldestFrame, (*it)->Frame());
+
+  m_inputLog.Trim(oldestFrame);
+}
+
+void CNetplayGame::ReapSenders(void)
+{
+  std::vector<CStateSender*> finished;
+  {
+    CLockObject lock(m_mutex);
+    finished.swap(m_finishedSenders);
+  }
+
+  for (std::vector<CStateSender*>::iterator it = finished.begin(); it != finished.end(); ++it)
+    delete *it;
+}
+
+bool CNetplayGame::IsIdle(void) const
+{
+  return m_senders.empty() && m_livePeers.empty() && !m_bCatchingUp && m_liveFrame == 0 &&
+         m_pendingInputs.empty() && m_staging.IsEmpty() && !m_memoryWatch.HasSubscribers();
+}
+
+void CNetplayGame::ResetSession(void)
+{
+  m_frame = 0;
+  m_liveFrame = 0;
+  m_bCatchingUp = false;
+  m_inputLog.Clear();
+  m_pendingInputs.clear();
+  m_staging.Clear();
+  m_receiver.Reset();
+}
@@ -0,0 +1,196 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "InputChannel.h"
+#include "InputLog.h"
+#include "MemoryWatch.h"
+#include "StateTransfer.h"
+#include "input/InputStaging.h"
+#include "interface/DirectCalls.h"
+#include "interface/IGame.h"
+
+#include "platform/threads/mutex.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+namespace game
+{
+  class InputLog;
+  class MemoryWatchSubscribe;
+  class StateChunk;
+}
+
+namespace NETPLAY
+{
+  class CFrontendManager;
+  class IPeer;
+
+  /*!
+   * \brief Game client wrapper that lets peers join a game in progress
+   *
+   * Host side: when a peer is added, a savestate is captured between two
+   * frames and streamed to the peer in the background. Inputs received from
+   * then on are logged by frame. Once the savestate has been sent, the peer
+   * receives the logged inputs and, after that, the inputs of every frame.
+   *
+   * Joining side: after the savestate and the first input log arrive, the
+   * state is loaded and the logged frames are replayed with video and audio
+   * suppressed until the game reaches the host's frame. Catch-up is spread
+   * over several frames so the joining frontend doesn't stall.
+   *
+   * While no peer is attached, nothing needs to be logged or forwarded, and
+   * the add-on may call the game client directly (see GetDirectCalls()).
+   * Anything that brings a peer in closes the gate first. Frames run directly
+   * aren't counted; frame numbers only need to agree from a join onwards.
+   */
+  class CNetplayGame : public IGame, public IStateSenderCallback, public IInputChannelCallback
+  {
+  public:
+    /*!
+     * \brief Take ownership of a game client
+     */
+    CNetplayGame(IGame* game, CFrontendManager* callbacks);
+    virtual ~CNetplayGame(void);
+
+    // --- Host side -----------------------------------------------------------
+
+    /*!
+     * \brief Start bringing a peer into the game in progress
+     * \return false if the game client can't be serialized
+     */
+    bool AddPeer(IPeer* peer);
+
+    void RemovePeer(IPeer* peer);
+
+    /*!
+     * \brief Set the memory ranges a peer follows. Changes are sent with the
+     *        peer's per-frame input log once it is live.
+     */
+    bool OnMemoryWatchSubscribe(IPeer* peer, const game::MemoryWatchSubscribe& msg);
+
+    // --- Joining side --------------------------------------------------------
+
+    void OnStateChunk(const game::StateChunk& chunk);
+    void OnInputLog(const game::InputLog& log);
+
+    bool IsCatchingUp(void);
+
+    // --- Input ---------------------------------------------------------------
+
+    /*!
+     * \brief Queue input for the next frame without waiting for the frame in
+     *        progress. Safe to call from any thread, e.g. a network thread.
+     */
+    void StageInput(unsigned int port, const game_input_event& event);
+
+    // implementation of IGame
+    virtual ADDON_STATUS Initialize(void) { return m_game->Initialize(); }
+    virtual void         Deinitialize(void) { m_game->Deinitialize(); }
+    virtual void         Stop(void) { m_game->Stop(); }
+    virtual ADDON_STATUS GetStatus(void) { return m_game->GetStatus(); }
+    virtual bool         HasSettings(void) { return m_game->HasSettings(); }
+    virtual unsigned int GetSettings(ADDON_StructSetting*** sSet) { return m_game->GetSettings(sSet); }
+    virtual ADDON_STATUS SetSetting(const char* settingName, const void* settingValue) { return m_game->SetSetting(settingName, settingValue); }
+    virtual void         FreeSettings(void) { m_game->FreeSettings(); }
+    virtual void         Announce(const char* flag, const char* sender, const char* message, const void* data) { m_game->Announce(flag, sender, message, data); }
+    virtual std::string GetGameAPIVersion(void) { return m_game->GetGameAPIVersion(); }
+    virtual std::string GetMininumGameAPIVersion(void) { return m_game->GetMininumGameAPIVersion(); }
+    virtual GAME_ERROR LoadGame(const char* url);
+    virtual GAME_ERROR LoadGameSpecial(SPECIAL_GAME_TYPE type, const char** urls, size_t urlCount);
+    virtual GAME_ERROR LoadStandalone(void);
+    virtual GAME_ERROR UnloadGame(void);
+    virtual GAME_ERROR GetGameInfo(game_system_av_info* info) { return m_game->GetGameInfo(info); }
+    virtual GAME_REGION GetRegion(void) { return m_game->GetRegion(); }
+    virtual void FrameEvent(void);
+    virtual GAME_ERROR Reset(void) { return m_game->Reset(); }
+    virtual GAME_ERROR HwContextReset(void) { return m_game->HwContextReset(); }
+    virtual GAME_ERROR HwContextDestroy(void) { return m_game->HwContextDestroy(); }
+    virtual void UpdatePort(unsigned int port, bool connected, const game_controller* controller) { m_game->UpdatePort(port, connected, controller); }
+    virtual bool InputEvent(unsigned int port, const game_input_event* event);
+    virtual unsigned int InputEvents(unsigned int port, const game_input_event* events, unsigned int count);
+    virtual size_t SerializeSize(void) { return m_game->SerializeSize(); }
+    virtual GAME_ERROR Serialize(uint8_t* data, size_t size) { return m_game->Serialize(data, size); }
+    virtual GAME_ERROR Deserialize(const uint8_t* data, size_t size) { return m_game->Deserialize(data, size); }
+    virtual GAME_ERROR CheatReset(void) { return m_game->CheatReset(); }
+    virtual GAME_ERROR GetMemory(GAME_MEMORY type, const uint8_t** data, size_t* size) { return m_game->GetMemory(type, data, size); }
+    virtual GAME_ERROR SetCheat(unsigned int index, bool enabled, const char* code) { return m_game->SetCheat(index, enabled, code); }
+    virtual bool GetDirectCalls(GameDirectCalls& calls);
+
+    // implementation of IInputChannelCallback
+    // A remote player's input, staged from the channel's receive thread
+    virtual void OnInputFrame(uint64_t frame, const std::deque<InputLogEntry>& entries);
+
+    // implementation of IStateSenderCallback
+    virtual void OnStateSent(IPeer* peer, uint64_t frame, bool bSuccess);
+
+  private:
+    /*!
+     * \brief Apply the peer and staged inputs for the current frame, run it,
+     *        and forward its inputs to live peers
+     */
+    void RunFrame(void);
+
+    /*!
+     * \brief Drop logged inputs that no peer needs anymore
+     */
+    void TrimInputLog(void);
+
+    /*!
+     * \brief Delete senders that have finished. Must be called without m_mutex
+     *        held, as a sender's thread may be waiting for it.
+     */
+    void ReapSenders(void);
+
+    void ResetSession(void);
+
+    /*!
+     * \brief True if no peer needs to see calls into the game client
+     */
+    bool IsIdle(void) const;
+
+    IGame* const              m_game;
+    CFrontendManager* const   m_callbacks;
+    uint64_t                  m_frame;
+    CInputLog                 m_inputLog;
+    CInputStaging             m_staging;
+    std::vector<StagedInput>  m_frameInputs; // Reused by RunFrame()
+
+    // Host side
+    std::vector<CStateSender*> m_senders;
+    std::vector<CStateSender*> m_finishedSenders;
+    std::vector<IPeer*>        m_livePeers;
+    CMemoryWatch               m_memoryWatch;
+
+    // Joining side
+    CStateReceiver             m_receiver;
+    std::deque<InputLogEntry>  m_pendingInputs;
+    uint64_t                   m_liveFrame;
+    bool                       m_bCatchingUp;
+
+    // In-process fast path
+    CDirectCallGate            m_directGate;
+    bool                       m_bDirectCalls; // The game client supports direct calls
+
+    PLATFORM::CMutex           m_mutex;
+  };
+}
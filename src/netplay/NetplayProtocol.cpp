@@ -0,0 +1,67 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "NetplayProtocol.h"
+
+#include <google/protobuf/message_lite.h>
+
+#include <cstring>
+#include <stdint.h>
+
+#if defined(_WIN32)
+  #include <winsock2.h>
+#else
+  #include <arpa/inet.h>
+#endif
+
+using namespace NETPLAY;
+
+bool NetplayProtocol::FrameMessage(NETPLAY_MESSAGE type, const google::protobuf::MessageLite& msg, std::string& framed)
+{
+  // The header holds a 32-bit size
+  const size_t byteSize = msg.ByteSizeLong();
+  if (byteSize > UINT32_MAX)
+    return false;
+
+  const uint32_t payloadSize = static_cast<uint32_t>(byteSize);
+
+  framed.resize(NETPLAY_HEADER_SIZE + payloadSize);
+
+  uint8_t* data = reinterpret_cast<uint8_t*>(&framed[0]);
+
+  const uint32_t header[2] = { htonl(type), htonl(payloadSize) };
+  std::memcpy(data, header, sizeof(header));
+
+  return msg.SerializeWithCachedSizesToArray(data + NETPLAY_HEADER_SIZE) == data + framed.size();
+}
+
+bool NetplayProtocol::ParseHeader(const uint8_t* data, size_t size, NETPLAY_MESSAGE& type, uint32_t& payloadSize)
+{
+  if (size < NETPLAY_HEADER_SIZE)
+    return false;
+
+  uint32_t header[2];
+  std::memcpy(header, data, sizeof(header));
+
+  type = static_cast<NETPLAY_MESSAGE>(ntohl(header[0]));
+  payloadSize = ntohl(header[1]);
+
+  return true;
+}
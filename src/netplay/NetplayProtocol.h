@@ -0,0 +1,70 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace google
+{
+namespace protobuf
+{
+  class MessageLite;
+}
+}
+
+// Every message on the reliable stream is framed as
+//
+//   [ uint32 type ][ uint32 payload size ][ protobuf payload ]
+//
+// in network byte order.
+
+#define NETPLAY_HEADER_SIZE  8
+
+namespace NETPLAY
+{
+  enum NETPLAY_MESSAGE
+  {
+    NETPLAY_MSG_NONE = 0,
+    NETPLAY_MSG_VIDEO_FRAME,      // game::VideoFrameRequest
+    NETPLAY_MSG_AUDIO_FRAMES,     // game::AudioFramesRequest
+    NETPLAY_MSG_RUMBLE_SET_STATE, // game::RumbleSetStateRequest
+    NETPLAY_MSG_CLOSE_GAME,       // game::CloseGameRequest
+    NETPLAY_MSG_STATE_CHUNK,      // game::StateChunk
+    NETPLAY_MSG_INPUT_LOG,        // game::InputLog
+    NETPLAY_MSG_MEMORY_WATCH,     // game::MemoryWatchSubscribe
+  };
+
+  class NetplayProtocol
+  {
+  public:
+    /*!
+     * \brief Serialize a message with its frame header
+     */
+    static bool FrameMessage(NETPLAY_MESSAGE type, const google::protobuf::MessageLite& msg, std::string& framed);
+
+    /*!
+     * \brief Read a frame header
+     * \return false if fewer than NETPLAY_HEADER_SIZE bytes are given
+     */
+    static bool ParseHeader(const uint8_t* data, size_t size, NETPLAY_MESSAGE& type, uint32_t& payloadSize);
+  };
+}
@@ -0,0 +1,198 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "RemoteFrontend.h"
+#include "ITransport.h"
+#include "NetplayProtocol.h"
+#include "log/Log.h"
+
+#include "game.pb.h"
+
+#include "platform/util/timeutils.h"
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define POP_TIMEOUT_MS       100
+#define VIDEO_RATE_WINDOW_MS 1000
+
+CRemoteFrontend::CRemoteFrontend(ITransport* transport) :
+  m_transport(transport),
+  m_bConnected(false),
+  m_videoBytesPerSecond(0.0),
+  m_videoBytes(0),
+  m_videoWindowStartMs(0)
+{
+}
+
+bool CRemoteFrontend::Initialize(void)
+{
+  m_bConnected = true;
+  m_videoWindowStartMs = GetTimeMs();
+
+  return CreateThread(false);
+}
+
+void CRemoteFrontend::Deinitialize(void)
+{
+  m_queue.Interrupt();
+  StopThread();
+  m_queue.Clear();
+  m_bConnected = false;
+}
+
+void* CRemoteFrontend::Process(void)
+{
+  while (!IsStopped() && m_bConnected)
+  {
+    OutgoingMessage msg;
+    if (!m_queue.Pop(msg, POP_TIMEOUT_MS))
+      continue;
+
+    const int64_t start = GetTimeMs();
+
+    if (!m_transport->Send(reinterpret_cast<const uint8_t*>(msg.data.c_str()), msg.data.size()))
+    {
+      esyslog("Lost connection to remote frontend");
+      m_bConnected = false;
+      break;
+    }
+
+    const int64_t elapsed = GetTimeMs() - start;
+
+    CLockObject lock(m_estimatorMutex);
+    m_estimator.AddSample(msg.data.size(), elapsed, !m_queue.IsEmpty());
+  }
+
+  return NULL;
+}
+
+void CRemoteFrontend::CloseGame(void)
+{
+  if (!m_bConnected)
+    return;
+
+  game::CloseGameRequest request;
+
+  std::string framed;
+  if (NetplayProtocol::FrameMessage(NETPLAY_MSG_CLOSE_GAME, request, framed))
+    PushRealtime(framed, false);
+}
+
+void CRemoteFrontend::VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format)
+{
+  if (!m_bConnected)
+    return;
+
+  double bytesPerSecond;
+  {
+    CLockObject lock(m_estimatorMutex);
+    bytesPerSecond = m_estimator.BytesPerSecond();
+  }
+
+  m_quality.Update(m_queue.TakeDroppedFrames(), m_queue.TakeDroppedRealtime(), m_queue.GetDelayMs(),
+                   bytesPerSecond, m_videoBytesPerSecond);
+
+  if (!m_quality.ShouldSendFrame())
+    return;
+
+  game::VideoFrameRequest request;
+  request.set_format(format);
+
+  unsigned int scaledWidth;
+  unsigned int scaledHeight;
+  const unsigned int scale = m_quality.Level().scale;
+
+  if (scale > 1 && CVideoQuality::Downscale(data, width, height, format, scale, m_scaledFrame, scaledWidth, scaledHeight))
+  {
+    request.set_data(m_scaledFrame);
+    request.set_width(scaledWidth);
+    request.set_height(scaledHeight);
+  }
+  else
+  {
+    request.set_data(data, size);
+    request.set_width(width);
+    request.set_height(height);
+  }
+
+  std::string framed;
+  if (!NetplayProtocol::FrameMessage(NETPLAY_MSG_VIDEO_FRAME, request, framed))
+    return;
+
+  UpdateVideoRate(framed.size());
+
+  m_queue.PushVideo(framed);
+}
+
+void CRemoteFrontend::AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format)
+{
+  if (!m_bConnected)
+    return;
+
+  game::AudioFramesRequest request;
+  request.set_data(data, size);
+  request.set_frames(frames);
+  request.set_format(format);
+
+  std::string framed;
+  if (NetplayProtocol::FrameMessage(NETPLAY_MSG_AUDIO_FRAMES, request, framed))
+    PushRealtime(framed, true);
+}
+
+void CRemoteFrontend::RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength)
+{
+  if (!m_bConnected)
+    return;
+
+  game::RumbleSetStateRequest request;
+  request.set_port(port);
+  request.set_effect(effect);
+  request.set_strength(strength);
+
+  std::string framed;
+  if (NetplayProtocol::FrameMessage(NETPLAY_MSG_RUMBLE_SET_STATE, request, framed))
+    PushRealtime(framed, false);
+}
+
+void CRemoteFrontend::PushRealtime(std::string& framed, bool bDroppable)
+{
+  if (!m_queue.PushRealtime(framed, bDroppable))
+  {
+    esyslog("Remote frontend stopped receiving, disconnecting");
+    m_bConnected = false;
+    m_queue.Interrupt();
+  }
+}
+
+void CRemoteFrontend::UpdateVideoRate(size_t bytes)
+{
+  m_videoBytes += bytes;
+
+  const int64_t now = GetTimeMs();
+  const int64_t elapsed = now - m_videoWindowStartMs;
+
+  if (elapsed >= VIDEO_RATE_WINDOW_MS)
+  {
+    m_videoBytesPerSecond = m_videoBytes * 1000.0 / elapsed;
+    m_videoBytes = 0;
+    m_videoWindowStartMs = now;
+  }
+}
@@ -0,0 +1,116 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "BandwidthEstimator.h"
+#include "SendQueue.h"
+#include "VideoQuality.h"
+#include "interface/IFrontend.h"
+
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <atomic>
+
+namespace NETPLAY
+{
+  class ITransport;
+
+  /*!
+   * \brief Frontend on another machine, reached over a reliable stream
+   *
+   * Callbacks are serialized and queued; a background thread drains the
+   * queue so the game client never blocks on the network. Under congestion
+   * stale video frames are dropped first, then the video quality is lowered
+   * (see CVideoQuality). Audio is dropped only when it arrives too late to
+   * be worth playing, rumble is never dropped. A client that stops taking
+   * data altogether is disconnected.
+   *
+   * File and system callbacks are only handled by the local frontend.
+   */
+  class CRemoteFrontend : public IFrontend, public PLATFORM::CThread
+  {
+  public:
+    CRemoteFrontend(ITransport* transport);
+    virtual ~CRemoteFrontend(void) { Deinitialize(); }
+
+    bool IsConnected(void) const { return m_bConnected; }
+
+    // implementation of IFrontend
+    virtual bool Initialize(void);
+    virtual void Deinitialize(void);
+    virtual void Log(const ADDON::addon_log_t loglevel, const char* msg) { }
+    virtual bool GetSetting(const char* settingName, void* settingValue) { return false; }
+    virtual void QueueNotification(const ADDON::queue_msg_t type, const char* msg) { }
+    virtual bool WakeOnLan(const char* mac) { return false; }
+    virtual std::string UnknownToUTF8(const char* str) { return str; }
+    virtual std::string GetLocalizedString(int dwCode, const char* strDefault = "") { return strDefault; }
+    virtual std::string GetDVDMenuLanguage(void) { return ""; }
+    virtual void* OpenFile(const char* strFileName, unsigned int flags) { return NULL; }
+    virtual void* OpenFileForWrite(const char* strFileName, bool bOverWrite) { return NULL; }
+    virtual ssize_t ReadFile(void* file, void* lpBuf, size_t uiBufSize) { return -1; }
+    virtual bool ReadFileString(void* file, char* szLine, int iLineLength) { return false; }
+    virtual ssize_t WriteFile(void* file, const void* lpBuf, size_t uiBufSize) { return -1; }
+    virtual void FlushFile(void* file) { }
+    virtual int64_t SeekFile(void* file, int64_t iFilePosition, int iWhence) { return -1; }
+    virtual int TruncateFile(void* file, int64_t iSize) { return -1; }
+    virtual int64_t GetFilePosition(void* file) { return -1; }
+    virtual int64_t GetFileLength(void* file) { return -1; }
+    virtual void CloseFile(void* file) { }
+    virtual int GetFileChunkSize(void* file) { return -1; }
+    virtual bool FileExists(const char* strFileName, bool bUseCache) { return false; }
+    virtual bool StatFile(const char* strFileName, STAT_STRUCTURE& buffer) { return false; }
+    virtual bool DeleteFile(const char* strFileName) { return false; }
+    virtual bool CanOpenDirectory(const char* strUrl) { return false; }
+    virtual bool CreateDirectory(const char* strPath) { return false; }
+    virtual bool DirectoryExists(const char* strPath) { return false; }
+    virtual bool RemoveDirectory(const char* strPath) { return false; }
+    virtual void CloseGame(void);
+    virtual void VideoFrame(const uint8_t* data, unsigned int size, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format);
+    virtual void AudioFrames(const uint8_t* data, unsigned int size, unsigned int frames, GAME_AUDIO_FORMAT format);
+    virtual void HwSetInfo(const game_hw_info* hw_info) { }
+    virtual uintptr_t HwGetCurrentFramebuffer(void) { return 0; }
+    virtual game_proc_address_t HwGetProcAddress(const char* symbol) { return NULL; }
+    virtual bool OpenPort(unsigned int port) { return false; }
+    virtual void ClosePort(unsigned int port) { }
+    virtual void RumbleSetState(unsigned int port, GAME_RUMBLE_EFFECT effect, float strength);
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    void PushRealtime(std::string& framed, bool bDroppable);
+    void UpdateVideoRate(size_t bytes);
+
+    ITransport* const    m_transport;
+    std::atomic<bool>    m_bConnected;
+    CSendQueue           m_queue;
+    CVideoQuality        m_quality;         // Only used on the game client's thread
+    std::string          m_scaledFrame;     // Scratch buffer for downscaled frames
+    CBandwidthEstimator  m_estimator;
+    PLATFORM::CMutex     m_estimatorMutex;
+
+    // Video throughput at the current quality level
+    double               m_videoBytesPerSecond;
+    size_t               m_videoBytes;
+    int64_t              m_videoWindowStartMs;
+  };
+}
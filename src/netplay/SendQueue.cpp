@@ -0,0 +1,192 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SendQueue.h"
+
+#include "platform/util/timeutils.h"
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define MAX_REALTIME_AGE_MS    150          // Audio older than this is dropped
+#define MAX_REALTIME_BYTES     (256 * 1024) // Audio beyond this is dropped
+#define MAX_REALTIME_STALL_MS  2000         // Undroppable messages this old mean a dead link
+
+CSendQueue::CSendQueue(void) :
+  m_realtimeBytes(0),
+  m_droppedRealtime(0),
+  m_bHasVideo(false),
+  m_droppedFrames(0),
+  m_bInterrupted(false),
+  m_bReady(false)
+{
+  m_video.queuedMs = 0;
+  m_video.bDroppable = true;
+}
+
+bool CSendQueue::PushRealtime(std::string& data, bool bDroppable /* = false */)
+{
+  CLockObject lock(m_mutex);
+
+  const int64_t now = GetTimeMs();
+
+  m_realtime.push_back(OutgoingMessage());
+  m_realtime.back().data.swap(data);
+  m_realtime.back().queuedMs = now;
+  m_realtime.back().bDroppable = bDroppable;
+  m_realtimeBytes += m_realtime.back().data.size();
+
+  TrimRealtime(now);
+
+  m_bReady = true;
+  m_condition.Signal();
+
+  // Only undroppable messages can be this old after trimming
+  return now - m_realtime.front().queuedMs < MAX_REALTIME_STALL_MS;
+}
+
+void CSendQueue::TrimRealtime(int64_t now)
+{
+  for (std::deque<OutgoingMessage>::iterator it = m_realtime.begin(); it != m_realtime.end(); )
+  {
+    const bool bLate = now - it->queuedMs > MAX_REALTIME_AGE_MS || m_realtimeBytes > MAX_REALTIME_BYTES;
+    if (!bLate)
+      break; // Everything after this is newer
+
+    if (it->bDroppable)
+    {
+      m_realtimeBytes -= it->data.size();
+      m_droppedRealtime++;
+      it = m_realtime.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+bool CSendQueue::PushVideo(std::string& data)
+{
+  CLockObject lock(m_mutex);
+
+  const bool bDropped = m_bHasVideo;
+  if (bDropped)
+    m_droppedFrames++;
+
+  m_video.data.swap(data);
+  m_video.queuedMs = GetTimeMs();
+  m_bHasVideo = true;
+
+  m_bReady = true;
+  m_condition.Signal();
+
+  return !bDropped;
+}
+
+bool CSendQueue::Pop(OutgoingMessage& msg, uint32_t timeoutMs)
+{
+  CLockObject lock(m_mutex);
+
+  if (m_realtime.empty() && !m_bHasVideo && !m_bInterrupted)
+  {
+    m_bReady = false;
+    m_condition.Wait(m_mutex, m_bReady, timeoutMs);
+  }
+
+  m_bInterrupted = false;
+
+  if (!m_realtime.empty())
+  {
+    msg.data.swap(m_realtime.front().data);
+    msg.queuedMs = m_realtime.front().queuedMs;
+    msg.bDroppable = m_realtime.front().bDroppable;
+    m_realtimeBytes -= msg.data.size();
+    m_realtime.pop_front();
+    return true;
+  }
+
+  if (m_bHasVideo)
+  {
+    msg.data.swap(m_video.data);
+    msg.queuedMs = m_video.queuedMs;
+    msg.bDroppable = true;
+    m_bHasVideo = false;
+    return true;
+  }
+
+  return false;
+}
+
+bool CSendQueue::IsEmpty(void)
+{
+  CLockObject lock(m_mutex);
+  return m_realtime.empty() && !m_bHasVideo;
+}
+
+int64_t CSendQueue::GetDelayMs(void)
+{
+  CLockObject lock(m_mutex);
+
+  int64_t oldest = 0;
+  if (!m_realtime.empty())
+    oldest = m_realtime.front().queuedMs;
+  if (m_bHasVideo && (oldest == 0 || m_video.queuedMs < oldest))
+    oldest = m_video.queuedMs;
+
+  return oldest != 0 ? GetTimeMs() - oldest : 0;
+}
+
+unsigned int CSendQueue::TakeDroppedFrames(void)
+{
+  CLockObject lock(m_mutex);
+
+  unsigned int dropped = m_droppedFrames;
+  m_droppedFrames = 0;
+  return dropped;
+}
+
+unsigned int CSendQueue::TakeDroppedRealtime(void)
+{
+  CLockObject lock(m_mutex);
+
+  unsigned int dropped = m_droppedRealtime;
+  m_droppedRealtime = 0;
+  return dropped;
+}
+
+void CSendQueue::Interrupt(void)
+{
+  CLockObject lock(m_mutex);
+
+  m_bInterrupted = true;
+  m_bReady = true;
+  m_condition.Signal();
+}
+
+void CSendQueue::Clear(void)
+{
+  CLockObject lock(m_mutex);
+
+  m_realtime.clear();
+  m_realtimeBytes = 0;
+  m_video.data.clear();
+  m_bHasVideo = false;
+}
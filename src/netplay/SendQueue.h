@@ -0,0 +1,113 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "platform/threads/mutex.h"
+
+#include <deque>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  struct OutgoingMessage
+  {
+    std::string data;       // Framed message
+    int64_t     queuedMs;   // Time the message was queued
+    bool        bDroppable; // Realtime message that may be dropped when late
+  };
+
+  /*!
+   * \brief Bounded outgoing queue for one client
+   *
+   * Messages are split into two lanes. The realtime lane (input, audio,
+   * rumble, control) is always sent first. Droppable messages (audio) are
+   * discarded, oldest first, once they are too old or take too much memory
+   * to be worth playing. Other realtime messages are never dropped. If the
+   * link stalls long enough that even they pile up, the push fails and the
+   * client should be disconnected. The video lane holds at most one frame: a
+   * new frame replaces an unsent one, so a slow client receives fewer,
+   * fresher frames instead of an ever-growing backlog.
+   */
+  class CSendQueue
+  {
+  public:
+    CSendQueue(void);
+
+    /*!
+     * \param bDroppable True if the message may be dropped when late
+     * \return false if the realtime lane has stalled
+     */
+    bool PushRealtime(std::string& data, bool bDroppable = false);
+
+    /*!
+     * \brief Queue a video frame, replacing any frame that hasn't been sent
+     * \return false if a stale frame was dropped
+     */
+    bool PushVideo(std::string& data);
+
+    /*!
+     * \brief Take the next message to send, waiting up to timeoutMs
+     */
+    bool Pop(OutgoingMessage& msg, uint32_t timeoutMs);
+
+    bool IsEmpty(void);
+
+    /*!
+     * \brief Age of the oldest queued message, in milliseconds
+     */
+    int64_t GetDelayMs(void);
+
+    /*!
+     * \brief Get and reset the number of video frames dropped
+     */
+    unsigned int TakeDroppedFrames(void);
+
+    /*!
+     * \brief Get and reset the number of droppable realtime messages dropped
+     */
+    unsigned int TakeDroppedRealtime(void);
+
+    /*!
+     * \brief Wake up a thread blocked in Pop()
+     */
+    void Interrupt(void);
+
+    void Clear(void);
+
+  private:
+    /*!
+     * \brief Drop late droppable messages from the realtime lane
+     */
+    void TrimRealtime(int64_t now);
+
+    std::deque<OutgoingMessage>   m_realtime;
+    size_t                        m_realtimeBytes;
+    unsigned int                  m_droppedRealtime;
+    OutgoingMessage               m_video;
+    bool                          m_bHasVideo;
+    unsigned int                  m_droppedFrames;
+    bool                          m_bInterrupted;
+    PLATFORM::CMutex              m_mutex;
+    PLATFORM::CCondition<bool>    m_condition;
+    bool                          m_bReady;
+  };
+}
@@ -0,0 +1,335 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "SpeculativeRollback.h"
+#include "interface/IGame.h"
+#include "log/Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+// --- CInputPredictor ---------------------------------------------------------
+
+void CInputPredictor::Observe(const InputEntries& entries)
+{
+  for (InputEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+  {
+    const game_input_event& event = it->event.Get();
+    if (event.type != GAME_INPUT_EVENT_DIGITAL_BUTTON)
+      continue;
+
+    const std::string key = GetKey(*it);
+
+    if (event.digital_button.pressed)
+    {
+      m_held[key] = *it;
+      m_pressCounts[key]++;
+      m_lastPress[key] = *it;
+    }
+    else
+    {
+      m_held.erase(key);
+    }
+  }
+}
+
+void CInputPredictor::Predict(uint64_t frame, unsigned int maxHypotheses, std::vector<InputEntries>& hypotheses) const
+{
+  hypotheses.clear();
+
+  if (maxHypotheses == 0)
+    return;
+
+  // Input rarely changes from one frame to the next
+  hypotheses.push_back(InputEntries());
+
+  // Everything that's held is let go
+  if (hypotheses.size() < maxHypotheses && !m_held.empty())
+  {
+    InputEntries release;
+    for (std::map<std::string, InputLogEntry>::const_iterator it = m_held.begin(); it != m_held.end(); ++it)
+    {
+      InputLogEntry entry = it->second;
+      game_input_event event = entry.event.Get();
+      event.digital_button.pressed = false;
+
+      entry.frame = frame;
+      entry.event = event;
+      release.push_back(entry);
+    }
+    hypotheses.push_back(release);
+  }
+
+  // The buttons pressed most often so far, unless they're already held
+  std::vector<std::pair<unsigned int, std::string> > popular;
+  for (std::map<std::string, unsigned int>::const_iterator it = m_pressCounts.begin(); it != m_pressCounts.end(); ++it)
+  {
+    if (m_held.find(it->first) == m_held.end())
+      popular.push_back(std::make_pair(it->second, it->first));
+  }
+  std::sort(popular.rbegin(), popular.rend());
+
+  for (std::vector<std::pair<unsigned int, std::string> >::const_iterator it = popular.begin();
+       it != popular.end() && hypotheses.size() < maxHypotheses; ++it)
+  {
+    InputLogEntry entry = m_lastPress.find(it->second)->second;
+    entry.frame = frame;
+    hypotheses.push_back(InputEntries(1, entry));
+  }
+}
+
+void CInputPredictor::Clear(void)
+{
+  m_held.clear();
+  m_pressCounts.clear();
+  m_lastPress.clear();
+}
+
+std::string CInputPredictor::GetKey(const InputLogEntry& entry)
+{
+  const game_input_event& event = entry.event.Get();
+
+  std::ostringstream key;
+  key << entry.port << '/' << (event.controller_id ? event.controller_id : "")
+                    << '/' << (event.feature_name ? event.feature_name : "");
+  return key.str();
+}
+
+// --- CSpeculativeBranches ----------------------------------------------------
+
+CSpeculativeBranches::CSpeculativeBranches(const std::vector<IGame*>& instances)
+{
+  for (std::vector<IGame*>::const_iterator it = instances.begin(); it != instances.end(); ++it)
+    m_branches.push_back(new CBranch(*it));
+
+  dsyslog("Speculative rollback using %u branches", static_cast<unsigned int>(m_branches.size()));
+}
+
+CSpeculativeBranches::~CSpeculativeBranches(void)
+{
+  Cancel();
+
+  for (std::vector<CBranch*>::iterator it = m_branches.begin(); it != m_branches.end(); ++it)
+    delete *it;
+}
+
+void CSpeculativeBranches::Fork(const StateBuffer& state, const InputFrames& localFrames, const std::vector<InputEntries>& remoteGuesses)
+{
+  // Branches read the state and local input, so they must be stopped first
+  Cancel();
+
+  m_forkState = m_pool.Acquire(state.size);
+  if (!m_forkState)
+  {
+    esyslog("Failed to allocate %u bytes for speculative rollback", static_cast<unsigned int>(state.size));
+    return;
+  }
+  std::memcpy(m_forkState->data, state.data, state.size);
+
+  m_localFrames = localFrames;
+
+  for (unsigned int i = 0; i < m_branches.size() && i < remoteGuesses.size(); i++)
+    m_branches[i]->Run(m_forkState.get(), &m_localFrames, remoteGuesses[i]);
+}
+
+bool CSpeculativeBranches::Adopt(const InputEntries& actual, CStatePool& pool, StatePtr& state)
+{
+  CBranch* match = NULL;
+
+  for (std::vector<CBranch*>::iterator it = m_branches.begin(); it != m_branches.end(); ++it)
+  {
+    if ((*it)->IsRunning() && match == NULL && IsSameInput((*it)->Guess(), actual))
+      match = *it;
+    else
+      (*it)->Cancel();
+  }
+
+  bool bAdopted = false;
+
+  if (match != NULL && match->Wait())
+    bAdopted = (match->Game()->SerializeState(pool, state) == GAME_ERROR_NO_ERROR);
+
+  // Wait for the losing branches so they can be reused
+  Cancel();
+
+  return bAdopted;
+}
+
+void CSpeculativeBranches::Cancel(void)
+{
+  for (std::vector<CBranch*>::iterator it = m_branches.begin(); it != m_branches.end(); ++it)
+    (*it)->Cancel();
+
+  for (std::vector<CBranch*>::iterator it = m_branches.begin(); it != m_branches.end(); ++it)
+  {
+    if ((*it)->IsRunning())
+      (*it)->Wait();
+  }
+}
+
+bool CSpeculativeBranches::IsSameInput(const InputEntries& a, const InputEntries& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (unsigned int i = 0; i < a.size(); i++)
+  {
+    if (a[i].port != b[i].port)
+      return false;
+
+    const game_input_event& x = a[i].event.Get();
+    const game_input_event& y = b[i].event.Get();
+
+    if (x.type != y.type ||
+        std::strcmp(x.controller_id ? x.controller_id : "", y.controller_id ? y.controller_id : "") != 0 ||
+        std::strcmp(x.feature_name ? x.feature_name : "", y.feature_name ? y.feature_name : "") != 0)
+      return false;
+
+    bool bSame;
+    switch (x.type)
+    {
+      case GAME_INPUT_EVENT_DIGITAL_BUTTON:
+        bSame = (x.digital_button.pressed == y.digital_button.pressed);
+        break;
+      case GAME_INPUT_EVENT_ANALOG_BUTTON:
+        bSame = (x.analog_button.magnitude == y.analog_button.magnitude);
+        break;
+      case GAME_INPUT_EVENT_ANALOG_STICK:
+        bSame = (x.analog_stick.x == y.analog_stick.x && x.analog_stick.y == y.analog_stick.y);
+        break;
+      case GAME_INPUT_EVENT_ACCELEROMETER:
+        bSame = (x.accelerometer.x == y.accelerometer.x && x.accelerometer.y == y.accelerometer.y &&
+                 x.accelerometer.z == y.accelerometer.z);
+        break;
+      case GAME_INPUT_EVENT_KEY:
+        bSame = (x.key.pressed == y.key.pressed && x.key.character == y.key.character &&
+                 x.key.modifiers == y.key.modifiers);
+        break;
+      case GAME_INPUT_EVENT_RELATIVE_POINTER:
+        bSame = (x.rel_pointer.x == y.rel_pointer.x && x.rel_pointer.y == y.rel_pointer.y);
+        break;
+      case GAME_INPUT_EVENT_ABSOLUTE_POINTER:
+        bSame = (x.abs_pointer.pressed == y.abs_pointer.pressed &&
+                 x.abs_pointer.x == y.abs_pointer.x && x.abs_pointer.y == y.abs_pointer.y);
+        break;
+      default:
+        bSame = false;
+        break;
+    }
+
+    if (!bSame)
+      return false;
+  }
+
+  return true;
+}
+
+// --- CBranch -----------------------------------------------------------------
+
+CSpeculativeBranches::CBranch::CBranch(IGame* game) :
+  m_game(game),
+  m_state(NULL),
+  m_localFrames(NULL),
+  m_bCancel(false),
+  m_bRunning(false),
+  m_bSuccess(false)
+{
+  CreateThread(false);
+}
+
+CSpeculativeBranches::CBranch::~CBranch(void)
+{
+  StopThread(-1);
+  m_startEvent.Signal();
+  StopThread();
+
+  delete m_game;
+}
+
+void CSpeculativeBranches::CBranch::Run(const StateBuffer* state, const InputFrames* localFrames, const InputEntries& remoteGuess)
+{
+  m_state = state;
+  m_localFrames = localFrames;
+  m_remoteGuess = remoteGuess;
+  m_bCancel = false;
+  m_bRunning = true;
+
+  m_startEvent.Signal();
+}
+
+bool CSpeculativeBranches::CBranch::Wait(void)
+{
+  if (!m_bRunning)
+    return false;
+
+  m_doneEvent.Wait();
+  m_bRunning = false;
+
+  return m_bSuccess;
+}
+
+void* CSpeculativeBranches::CBranch::Process(void)
+{
+  while (!IsStopped())
+  {
+    if (!m_startEvent.Wait(100))
+      continue;
+
+    if (IsStopped())
+      break;
+
+    m_bSuccess = Simulate();
+    m_doneEvent.Signal();
+  }
+
+  return NULL;
+}
+
+bool CSpeculativeBranches::CBranch::Simulate(void)
+{
+  if (m_game->Deserialize(m_state->data, m_state->size) != GAME_ERROR_NO_ERROR)
+    return false;
+
+  for (InputFrames::const_iterator it = m_localFrames->begin(); it != m_localFrames->end(); ++it)
+  {
+    if (m_bCancel)
+      return false;
+
+    // The guess only covers the frame the remote input is missing for. After
+    // that, remote input is assumed not to change.
+    if (it == m_localFrames->begin())
+      Apply(m_remoteGuess);
+    Apply(it->second);
+
+    m_game->FrameEvent();
+  }
+
+  return !m_bCancel;
+}
+
+void CSpeculativeBranches::CBranch::Apply(const InputEntries& entries)
+{
+  for (InputEntries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+    m_game->InputEvent(it->port, &it->event.Get());
+}
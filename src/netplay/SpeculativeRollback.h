@@ -0,0 +1,171 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "InputChannel.h"
+#include "InputLog.h"
+#include "interface/StatePool.h"
+
+#include "platform/threads/mutex.h"
+#include "platform/threads/threads.h"
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace NETPLAY
+{
+  class IGame;
+
+  typedef std::deque<InputLogEntry> InputEntries;
+
+  /*!
+   * \brief Guesses what a remote player's input for the next frame is
+   *        likely to be, from the input seen so far
+   */
+  class CInputPredictor
+  {
+  public:
+    CInputPredictor(void) { }
+
+    /*!
+     * \brief Feed the remote player's actual input, in frame order
+     */
+    void Observe(const InputEntries& entries);
+
+    /*!
+     * \brief Get up to maxHypotheses candidate inputs, most likely first:
+     *        nothing changes (everything held), everything held is released,
+     *        and the most frequently pressed button that isn't held is pressed
+     */
+    void Predict(uint64_t frame, unsigned int maxHypotheses, std::vector<InputEntries>& hypotheses) const;
+
+    void Clear(void);
+
+  private:
+    static std::string GetKey(const InputLogEntry& entry);
+
+    std::map<std::string, InputLogEntry> m_held;       // Pressed digital buttons, by port and feature
+    std::map<std::string, unsigned int>  m_pressCounts;
+    std::map<std::string, InputLogEntry> m_lastPress;  // Most recent press of each button
+  };
+
+  /*!
+   * \brief Simulates several guesses of a remote player's late input in
+   *        parallel, so a rollback can adopt the right result instead of
+   *        re-simulating
+   *
+   * Each branch is a separate instance of the game client with its own
+   * worker thread. Fork() loads the state from before the late input into
+   * every branch and re-runs the frames since, each branch with a different
+   * guess of the remote input. When the real input arrives, Adopt() hands
+   * back the state of the branch that guessed right, and the others are
+   * stopped and reused for the next fork.
+   *
+   * Branch instances must be private copies of the game client (see
+   * CDLLGame), loaded with the same content, whose callbacks don't reach the
+   * player's video and audio.
+   */
+  class CSpeculativeBranches
+  {
+  public:
+    /*!
+     * \brief Take ownership of the branch instances
+     */
+    CSpeculativeBranches(const std::vector<IGame*>& instances);
+    ~CSpeculativeBranches(void);
+
+    unsigned int BranchCount(void) const { return m_branches.size(); }
+
+    /*!
+     * \brief Start simulating from a state on every branch
+     *
+     * \param state The state before the first frame
+     * \param localFrames Our own input for each frame to simulate, in order
+     * \param remoteGuesses Remote input for the first frame, one per branch.
+     *        Extra guesses are ignored, missing ones leave branches idle.
+     */
+    void Fork(const StateBuffer& state, const InputFrames& localFrames, const std::vector<InputEntries>& remoteGuesses);
+
+    /*!
+     * \brief Get the result of the branch that guessed the actual remote
+     *        input, waiting for it to finish if necessary
+     *
+     * \return false if no branch guessed right and the frames must be
+     *         re-simulated
+     */
+    bool Adopt(const InputEntries& actual, CStatePool& pool, StatePtr& state);
+
+    /*!
+     * \brief Stop all branches, e.g. when the rollback is abandoned
+     */
+    void Cancel(void);
+
+  private:
+    class CBranch : public PLATFORM::CThread
+    {
+    public:
+      CBranch(IGame* game);
+      virtual ~CBranch(void);
+
+      void Run(const StateBuffer* state, const InputFrames* localFrames, const InputEntries& remoteGuess);
+
+      /*!
+       * \brief Wait for the branch to finish
+       * \return true if every frame was simulated
+       */
+      bool Wait(void);
+
+      void Cancel(void) { m_bCancel = true; }
+
+      bool IsRunning(void) const { return m_bRunning; }
+      IGame* Game(void) const { return m_game; }
+      const InputEntries& Guess(void) const { return m_remoteGuess; }
+
+    protected:
+      // implementation of CThread
+      virtual void* Process(void);
+
+    private:
+      bool Simulate(void);
+      void Apply(const InputEntries& entries);
+
+      IGame* const         m_game;
+      const StateBuffer*   m_state;
+      const InputFrames*   m_localFrames;
+      InputEntries         m_remoteGuess;
+      std::atomic<bool>    m_bCancel;
+      bool                 m_bRunning;  // Owner thread only
+      bool                 m_bSuccess;
+      PLATFORM::CEvent     m_startEvent;
+      PLATFORM::CEvent     m_doneEvent;
+    };
+
+    static bool IsSameInput(const InputEntries& a, const InputEntries& b);
+
+    std::vector<CBranch*> m_branches;
+    StatePtr              m_forkState;   // Shared read-only by the branches
+    InputFrames           m_localFrames; // Shared read-only by the branches
+    CStatePool            m_pool;
+  };
+}
@@ -0,0 +1,135 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "StateTransfer.h"
+#include "IPeer.h"
+#include "log/Log.h"
+
+#include "game.pb.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace NETPLAY;
+
+#define STATE_CHUNK_SIZE  (64 * 1024)
+#define MAX_STATE_SIZE    (64 * 1024 * 1024) // Larger than any emulator's savestate
+
+// --- CStateSender ------------------------------------------------------------
+
+CStateSender::CStateSender(IPeer* peer, std::vector<uint8_t>& state, uint64_t frame, IStateSenderCallback* callback) :
+  m_peer(peer),
+  m_frame(frame),
+  m_callback(callback)
+{
+  m_state.swap(state);
+}
+
+void* CStateSender::Process(void)
+{
+  bool bSuccess = true;
+
+  // The receiver would reject it
+  if (m_state.size() > MAX_STATE_SIZE)
+  {
+    esyslog("Savestate is too large to send (%u bytes)", static_cast<unsigned int>(m_state.size()));
+    m_callback->OnStateSent(m_peer, m_frame, false);
+    return NULL;
+  }
+
+  game::StateChunk chunk;
+  chunk.set_frame(m_frame);
+  chunk.set_total_size(m_state.size());
+
+  for (size_t offset = 0; offset < m_state.size() && !IsStopped(); offset += STATE_CHUNK_SIZE)
+  {
+    const size_t size = std::min(m_state.size() - offset, static_cast<size_t>(STATE_CHUNK_SIZE));
+
+    chunk.set_offset(offset);
+    chunk.set_data(m_state.data() + offset, size);
+
+    if (!m_peer->SendStateChunk(chunk))
+    {
+      esyslog("Peer disconnected during state transfer");
+      bSuccess = false;
+      break;
+    }
+  }
+
+  if (IsStopped())
+    bSuccess = false;
+
+  m_callback->OnStateSent(m_peer, m_frame, bSuccess);
+
+  return NULL;
+}
+
+// --- CStateReceiver ----------------------------------------------------------
+
+CStateReceiver::CStateReceiver(void) :
+  m_frame(0),
+  m_received(0)
+{
+}
+
+bool CStateReceiver::AddChunk(const game::StateChunk& chunk)
+{
+  // A chunk at offset 0 starts a new transfer
+  if (chunk.offset() == 0)
+  {
+    // The size comes from the peer, don't let it allocate without bound
+    if (chunk.total_size() > MAX_STATE_SIZE)
+    {
+      esyslog("Rejecting %u byte savestate, larger than %u bytes", chunk.total_size(), MAX_STATE_SIZE);
+      Reset();
+      return false;
+    }
+
+    m_state.resize(chunk.total_size());
+    m_frame = chunk.frame();
+    m_received = 0;
+  }
+
+  // Chunks arrive in order over the stream
+  if (chunk.frame() != m_frame || chunk.offset() != m_received ||
+      chunk.offset() + chunk.data().size() > m_state.size())
+  {
+    esyslog("Received out-of-order savestate chunk (frame %llu, offset %u)",
+            static_cast<unsigned long long>(chunk.frame()), chunk.offset());
+    return false;
+  }
+
+  std::memcpy(m_state.data() + chunk.offset(), chunk.data().data(), chunk.data().size());
+  m_received += chunk.data().size();
+
+  return true;
+}
+
+bool CStateReceiver::IsComplete(void) const
+{
+  return !m_state.empty() && m_received == m_state.size();
+}
+
+void CStateReceiver::Reset(void)
+{
+  m_state.clear();
+  m_frame = 0;
+  m_received = 0;
+}
@@ -0,0 +1,100 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "platform/threads/threads.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace game
+{
+  class StateChunk;
+}
+
+namespace NETPLAY
+{
+  class IPeer;
+
+  class IStateSenderCallback
+  {
+  public:
+    virtual ~IStateSenderCallback(void) { }
+
+    /*!
+     * \brief Called from the sender's thread after the last chunk was sent
+     */
+    virtual void OnStateSent(IPeer* peer, uint64_t frame, bool bSuccess) = 0;
+  };
+
+  /*!
+   * \brief Streams a savestate to a peer in the background so that the game
+   *        keeps running while a player joins
+   */
+  class CStateSender : public PLATFORM::CThread
+  {
+  public:
+    /*!
+     * \brief Take ownership of a savestate captured before the given frame
+     */
+    CStateSender(IPeer* peer, std::vector<uint8_t>& state, uint64_t frame, IStateSenderCallback* callback);
+    virtual ~CStateSender(void) { StopThread(); }
+
+    IPeer* Peer(void) const { return m_peer; }
+    uint64_t Frame(void) const { return m_frame; }
+
+  protected:
+    // implementation of CThread
+    virtual void* Process(void);
+
+  private:
+    IPeer* const                m_peer;
+    std::vector<uint8_t>        m_state;
+    const uint64_t              m_frame;
+    IStateSenderCallback* const m_callback;
+  };
+
+  /*!
+   * \brief Reassembles a savestate from the chunks sent by a CStateSender
+   */
+  class CStateReceiver
+  {
+  public:
+    CStateReceiver(void);
+
+    /*!
+     * \brief Add a chunk to the savestate
+     * \return false if the chunk doesn't belong to the transfer in progress
+     */
+    bool AddChunk(const game::StateChunk& chunk);
+
+    bool IsComplete(void) const;
+    uint64_t Frame(void) const { return m_frame; }
+    const std::vector<uint8_t>& State(void) const { return m_state; }
+
+    void Reset(void);
+
+  private:
+    std::vector<uint8_t> m_state;
+    uint64_t             m_frame;
+    size_t               m_received;
+  };
+}
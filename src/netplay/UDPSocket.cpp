@@ -0,0 +1,127 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "UDPSocket.h"
+#include "log/Log.h"
+
+#include <arpa/inet.h>
+#include <cstring>
+#include <errno.h>
+#include <stdio.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace NETPLAY;
+
+bool CUDPSocket::Open(unsigned int localPort, const std::string& strPeerAddress, unsigned int peerPort)
+{
+  Close();
+
+  addrinfo hints = { };
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  char strPort[8];
+  snprintf(strPort, sizeof(strPort), "%u", peerPort);
+
+  addrinfo* peer = NULL;
+  if (getaddrinfo(strPeerAddress.c_str(), strPort, &hints, &peer) != 0 || peer == NULL)
+  {
+    esyslog("Failed to resolve %s", strPeerAddress.c_str());
+    return false;
+  }
+
+  m_socket = socket(peer->ai_family, SOCK_DGRAM, 0);
+  if (m_socket < 0)
+  {
+    LOG_ERROR_STR("socket()");
+    freeaddrinfo(peer);
+    return false;
+  }
+
+  sockaddr_storage local = { };
+  socklen_t localSize;
+  if (peer->ai_family == AF_INET6)
+  {
+    sockaddr_in6* local6 = reinterpret_cast<sockaddr_in6*>(&local);
+    local6->sin6_family = AF_INET6;
+    local6->sin6_addr = in6addr_any;
+    local6->sin6_port = htons(localPort);
+    localSize = sizeof(*local6);
+  }
+  else
+  {
+    sockaddr_in* local4 = reinterpret_cast<sockaddr_in*>(&local);
+    local4->sin_family = AF_INET;
+    local4->sin_addr.s_addr = htonl(INADDR_ANY);
+    local4->sin_port = htons(localPort);
+    localSize = sizeof(*local4);
+  }
+
+  // Connecting a UDP socket filters out datagrams from other hosts
+  const bool bSuccess = bind(m_socket, reinterpret_cast<sockaddr*>(&local), localSize) == 0 &&
+                        connect(m_socket, peer->ai_addr, peer->ai_addrlen) == 0;
+
+  freeaddrinfo(peer);
+
+  if (!bSuccess)
+  {
+    LOG_ERROR_STR(strPeerAddress.c_str());
+    Close();
+    return false;
+  }
+
+  return true;
+}
+
+void CUDPSocket::Close(void)
+{
+  if (m_socket >= 0)
+  {
+    close(m_socket);
+    m_socket = -1;
+  }
+}
+
+bool CUDPSocket::SendDatagram(const uint8_t* data, size_t size)
+{
+  if (m_socket < 0)
+    return false;
+
+  // Packets refused by the peer (ECONNREFUSED) are just lost packets
+  ssize_t sent = send(m_socket, data, size, 0);
+  return sent == static_cast<ssize_t>(size) || (sent < 0 && errno == ECONNREFUSED);
+}
+
+size_t CUDPSocket::ReceiveDatagram(uint8_t* buffer, size_t size, unsigned int timeoutMs)
+{
+  if (m_socket < 0)
+    return 0;
+
+  pollfd fd = { m_socket, POLLIN, 0 };
+  if (poll(&fd, 1, timeoutMs) <= 0)
+    return 0;
+
+  ssize_t received = recv(m_socket, buffer, size, 0);
+  return received > 0 ? received : 0;
+}
@@ -0,0 +1,50 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "IDatagramTransport.h"
+
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief UDP socket connected to a single peer
+   */
+  class CUDPSocket : public IDatagramTransport
+  {
+  public:
+    CUDPSocket(void) : m_socket(-1) { }
+    virtual ~CUDPSocket(void) { Close(); }
+
+    /*!
+     * \brief Bind to a local port and send to the given peer
+     */
+    bool Open(unsigned int localPort, const std::string& strPeerAddress, unsigned int peerPort);
+    void Close(void);
+
+    // implementation of IDatagramTransport
+    virtual bool SendDatagram(const uint8_t* data, size_t size);
+    virtual size_t ReceiveDatagram(uint8_t* buffer, size_t size, unsigned int timeoutMs);
+
+  private:
+    int m_socket;
+  };
+}
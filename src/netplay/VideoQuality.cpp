@@ -0,0 +1,140 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "VideoQuality.h"
+#include "log/Log.h"
+
+#include "platform/util/timeutils.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define TARGET_DELAY_MS     100  // Queued data older than this means the client is falling behind
+#define DOWNGRADE_HOLD_MS   500  // Minimum time between two downgrades
+#define UPGRADE_HOLD_MS     3000 // Time without congestion before trying a higher level
+#define UPGRADE_HEADROOM    0.5  // Only upgrade if video uses less than this fraction of the link
+
+namespace NETPLAY
+{
+  // Ordered from best to worst
+  const VideoQualityLevel QUALITY_LEVELS[] =
+  {
+    { 1, 1 },
+    { 2, 1 },
+    { 2, 2 },
+    { 3, 2 },
+    { 4, 4 },
+  };
+
+  const unsigned int QUALITY_LEVEL_COUNT = sizeof(QUALITY_LEVELS) / sizeof(QUALITY_LEVELS[0]);
+}
+
+CVideoQuality::CVideoQuality(void) :
+  m_level(0),
+  m_frameCount(0),
+  m_lastChangeMs(0)
+{
+}
+
+void CVideoQuality::Update(unsigned int droppedFrames, unsigned int droppedAudio, int64_t queueDelayMs, double bytesPerSecond, double videoBytesPerSecond)
+{
+  const int64_t now = GetTimeMs();
+  const int64_t sinceChange = now - m_lastChangeMs;
+
+  // Video is the only thing that can give way to let audio through
+  const bool bCongested = droppedFrames > 0 || droppedAudio > 0 || queueDelayMs > TARGET_DELAY_MS;
+
+  if (bCongested)
+  {
+    if (m_level + 1 < QUALITY_LEVEL_COUNT && sinceChange >= DOWNGRADE_HOLD_MS)
+      SetLevel(m_level + 1);
+    else // Restart the wait before upgrading without delaying the next downgrade
+      m_lastChangeMs = std::max(m_lastChangeMs, now - DOWNGRADE_HOLD_MS);
+  }
+  else if (m_level > 0 && sinceChange >= UPGRADE_HOLD_MS && videoBytesPerSecond < bytesPerSecond * UPGRADE_HEADROOM)
+  {
+    SetLevel(m_level - 1);
+  }
+}
+
+bool CVideoQuality::ShouldSendFrame(void)
+{
+  return (m_frameCount++ % Level().frameInterval) == 0;
+}
+
+const VideoQualityLevel& CVideoQuality::Level(void) const
+{
+  return QUALITY_LEVELS[m_level];
+}
+
+void CVideoQuality::SetLevel(unsigned int level)
+{
+  dsyslog("Video quality level %u -> %u (every %u frames, 1/%u resolution)",
+          m_level, level, QUALITY_LEVELS[level].frameInterval, QUALITY_LEVELS[level].scale);
+
+  m_level = level;
+  m_frameCount = 0;
+  m_lastChangeMs = GetTimeMs();
+}
+
+bool CVideoQuality::Downscale(const uint8_t* data, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format,
+                              unsigned int scale, std::string& scaled, unsigned int& scaledWidth, unsigned int& scaledHeight)
+{
+  unsigned int bytesPerPixel;
+
+  switch (format)
+  {
+    case GAME_RENDER_FMT_0RGB8888:
+      bytesPerPixel = 4;
+      break;
+    case GAME_RENDER_FMT_RGB565:
+    case GAME_RENDER_FMT_0RGB1555:
+      bytesPerPixel = 2;
+      break;
+    default:
+      return false; // Planar and hardware formats are sent as-is
+  }
+
+  scaledWidth = width / scale;
+  scaledHeight = height / scale;
+  if (scaledWidth == 0 || scaledHeight == 0)
+    return false;
+
+  scaled.resize(scaledWidth * scaledHeight * bytesPerPixel);
+
+  uint8_t* dest = reinterpret_cast<uint8_t*>(&scaled[0]);
+  const size_t srcStride = width * bytesPerPixel;
+
+  for (unsigned int y = 0; y < scaledHeight; y++)
+  {
+    const uint8_t* src = data + y * scale * srcStride;
+    for (unsigned int x = 0; x < scaledWidth; x++)
+    {
+      std::memcpy(dest, src, bytesPerPixel);
+      dest += bytesPerPixel;
+      src += scale * bytesPerPixel;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,85 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "kodi/kodi_game_types.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Video quality level for a congested client
+   */
+  struct VideoQualityLevel
+  {
+    unsigned int frameInterval; // Send every Nth frame
+    unsigned int scale;         // Divide width and height by this
+  };
+
+  /*!
+   * \brief Chooses how much video a client can take
+   *
+   * The send queue already drops stale frames and late audio. If it keeps
+   * having to, or if queued data (video or realtime) waits longer than the
+   * latency target, the client steps down
+   * a level: first fewer frames, then lower resolution. It steps back up
+   * after a period without congestion.
+   */
+  class CVideoQuality
+  {
+  public:
+    CVideoQuality(void);
+
+    /*!
+     * \brief Feed the latest congestion signals
+     * \param droppedFrames Stale frames dropped since the last update
+     * \param droppedAudio Late audio packets dropped since the last update
+     * \param queueDelayMs Age of the oldest unsent message in either lane
+     * \param bytesPerSecond Estimated link throughput
+     * \param videoBytesPerSecond Recent video throughput at the current level
+     */
+    void Update(unsigned int droppedFrames, unsigned int droppedAudio, int64_t queueDelayMs, double bytesPerSecond, double videoBytesPerSecond);
+
+    /*!
+     * \brief Decide whether the next frame should be sent at this level
+     */
+    bool ShouldSendFrame(void);
+
+    const VideoQualityLevel& Level(void) const;
+    unsigned int LevelIndex(void) const { return m_level; }
+
+    /*!
+     * \brief Shrink a frame by an integer factor using nearest neighbour
+     *        sampling
+     * \return false if the format can't be scaled
+     */
+    static bool Downscale(const uint8_t* data, unsigned int width, unsigned int height, GAME_RENDER_FORMAT format,
+                          unsigned int scale, std::string& scaled, unsigned int& scaledWidth, unsigned int& scaledHeight);
+
+  private:
+    void SetLevel(unsigned int level);
+
+    unsigned int m_level;
+    unsigned int m_frameCount;
+    int64_t      m_lastChangeMs;
+  };
+}
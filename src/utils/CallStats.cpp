@@ -0,0 +1,221 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "CallStats.h"
+#include "log/Log.h"
+
+#include <algorithm>
+
+using namespace NETPLAY;
+using namespace PLATFORM;
+
+#define NO_SLOT  MAX_CALL_STATS
+
+namespace NETPLAY
+{
+  std::atomic<uint64_t> g_nextStatsId(1);
+
+  // Slots not held by any CCallStats
+  std::vector<unsigned int> g_freeSlots;
+  unsigned int              g_nextSlot = 0;
+  CMutex                    g_slotMutex;
+
+  // This thread's counters in the CCallStats holding each slot
+  struct ThreadSlot
+  {
+    uint64_t id; // Owner of the counters, 0 if none
+    void*    counters;
+  };
+
+  thread_local ThreadSlot t_threadSlots[MAX_CALL_STATS];
+
+  unsigned int AcquireSlot(void)
+  {
+    CLockObject lock(g_slotMutex);
+
+    if (!g_freeSlots.empty())
+    {
+      const unsigned int slot = g_freeSlots.back();
+      g_freeSlots.pop_back();
+      return slot;
+    }
+
+    if (g_nextSlot < MAX_CALL_STATS)
+      return g_nextSlot++;
+
+    return NO_SLOT;
+  }
+
+  void ReleaseSlot(unsigned int slot)
+  {
+    if (slot == NO_SLOT)
+      return;
+
+    CLockObject lock(g_slotMutex);
+    g_freeSlots.push_back(slot);
+  }
+
+  unsigned int GetBucket(uint64_t elapsedNs)
+  {
+    uint64_t us = elapsedNs / 1000;
+
+    unsigned int bucket = 0;
+    while (us > 0 && bucket < CALL_STATS_BUCKETS - 1)
+    {
+      us >>= 1;
+      bucket++;
+    }
+
+    return bucket;
+  }
+}
+
+uint64_t CallHistogram::PercentileUs(double percentile) const
+{
+  if (count == 0)
+    return 0;
+
+  const uint64_t target = static_cast<uint64_t>(percentile * count);
+
+  uint64_t seen = 0;
+  for (unsigned int i = 0; i < CALL_STATS_BUCKETS; i++)
+  {
+    seen += buckets[i];
+    if (seen > target)
+      return i < CALL_STATS_BUCKETS - 1 ? (1ULL << i) : maxNs / 1000;
+  }
+
+  return maxNs / 1000;
+}
+
+CCallStats::CCallStats(const std::string& strName, const char* const* callNames, unsigned int callCount) :
+  m_strName(strName),
+  m_callNames(callNames, callNames + callCount),
+  m_id(g_nextStatsId++),
+  m_slot(AcquireSlot())
+{
+  if (m_slot == NO_SLOT)
+    esyslog("Too many call statistics, not recording calls for %s", m_strName.c_str());
+}
+
+CCallStats::~CCallStats(void)
+{
+  ReleaseSlot(m_slot);
+
+  for (std::vector<Counters*>::iterator it = m_threads.begin(); it != m_threads.end(); ++it)
+    delete[] *it;
+}
+
+void CCallStats::Record(unsigned int call, uint64_t elapsedNs)
+{
+  if (call >= m_callNames.size() || m_slot == NO_SLOT)
+    return;
+
+  Counters& counters = GetThreadCounters()[call];
+
+  // Only this thread writes these, so plain load/store is enough
+  counters.count.store(counters.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  counters.totalNs.store(counters.totalNs.load(std::memory_order_relaxed) + elapsedNs, std::memory_order_relaxed);
+  if (elapsedNs > counters.maxNs.load(std::memory_order_relaxed))
+    counters.maxNs.store(elapsedNs, std::memory_order_relaxed);
+
+  std::atomic<uint64_t>& bucket = counters.buckets[GetBucket(elapsedNs)];
+  bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+CCallStats::Counters* CCallStats::GetThreadCounters(void)
+{
+  ThreadSlot& slot = t_threadSlots[m_slot];
+  if (slot.id != m_id)
+  {
+    Counters* newCounters = new Counters[m_callNames.size()];
+    for (unsigned int i = 0; i < m_callNames.size(); i++)
+    {
+      newCounters[i].count = 0;
+      newCounters[i].totalNs = 0;
+      newCounters[i].maxNs = 0;
+      for (unsigned int j = 0; j < CALL_STATS_BUCKETS; j++)
+        newCounters[i].buckets[j] = 0;
+    }
+
+    CLockObject lock(m_mutex);
+    m_threads.push_back(newCounters);
+
+    slot.id = m_id;
+    slot.counters = newCounters;
+  }
+
+  return static_cast<Counters*>(slot.counters);
+}
+
+void CCallStats::Collect(std::vector<CallHistogram>& histograms) const
+{
+  histograms.assign(m_callNames.size(), CallHistogram());
+
+  for (unsigned int i = 0; i < m_callNames.size(); i++)
+  {
+    CallHistogram& histogram = histograms[i];
+    histogram.name = m_callNames[i];
+    histogram.count = 0;
+    histogram.totalNs = 0;
+    histogram.maxNs = 0;
+    for (unsigned int j = 0; j < CALL_STATS_BUCKETS; j++)
+      histogram.buckets[j] = 0;
+  }
+
+  CLockObject lock(m_mutex);
+
+  for (std::vector<Counters*>::const_iterator it = m_threads.begin(); it != m_threads.end(); ++it)
+  {
+    for (unsigned int i = 0; i < m_callNames.size(); i++)
+    {
+      const Counters& counters = (*it)[i];
+      CallHistogram& histogram = histograms[i];
+
+      histogram.count += counters.count.load(std::memory_order_relaxed);
+      histogram.totalNs += counters.totalNs.load(std::memory_order_relaxed);
+      histogram.maxNs = std::max(histogram.maxNs, counters.maxNs.load(std::memory_order_relaxed));
+      for (unsigned int j = 0; j < CALL_STATS_BUCKETS; j++)
+        histogram.buckets[j] += counters.buckets[j].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void CCallStats::Dump(void) const
+{
+  std::vector<CallHistogram> histograms;
+  Collect(histograms);
+
+  isyslog("Call statistics for %s:", m_strName.c_str());
+
+  for (std::vector<CallHistogram>::const_iterator it = histograms.begin(); it != histograms.end(); ++it)
+  {
+    if (it->count == 0)
+      continue;
+
+    isyslog("  %-24s calls=%llu avg=%lluus p50<%lluus p99<%lluus max=%lluus",
+            it->name.c_str(),
+            static_cast<unsigned long long>(it->count),
+            static_cast<unsigned long long>(it->totalNs / it->count / 1000),
+            static_cast<unsigned long long>(it->PercentileUs(0.5)),
+            static_cast<unsigned long long>(it->PercentileUs(0.99)),
+            static_cast<unsigned long long>(it->maxNs / 1000));
+  }
+}
@@ -0,0 +1,140 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include "platform/threads/mutex.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define CALL_STATS_BUCKETS  24  // Bucket i counts calls under 2^i microseconds, the last one everything slower
+#define MAX_CALL_STATS      256 // Instances alive at the same time that can record
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Call count and latency distribution of one call
+   */
+  struct CallHistogram
+  {
+    std::string name;
+    uint64_t    count;
+    uint64_t    totalNs;
+    uint64_t    maxNs;
+    uint64_t    buckets[CALL_STATS_BUCKETS];
+
+    /*!
+     * \brief Estimate a percentile (0.0 - 1.0) from the buckets
+     * \return Upper bound of the bucket containing the percentile, in microseconds
+     */
+    uint64_t PercentileUs(double percentile) const;
+  };
+
+  /*!
+   * \brief Always-on call counts and latency histograms for a fixed set of
+   *        calls
+   *
+   * Every thread records into its own counters, so recording takes no locks
+   * and touches no shared cache lines. A thread's counters are created the
+   * first time it records into an instance. Collect() sums all threads.
+   *
+   * Each instance holds one of MAX_CALL_STATS slots while it exists. A thread
+   * finds its counters in a fixed per-thread table indexed by slot, so the
+   * lookup is a single array access. Table entries left over from a
+   * destroyed instance are recognized by the instance ID and replaced.
+   */
+  class CCallStats
+  {
+  public:
+    /*!
+     * \param strName   Name used when dumping, e.g. the object being measured
+     * \param callNames Name of each call, indexed by call ID
+     */
+    CCallStats(const std::string& strName, const char* const* callNames, unsigned int callCount);
+    ~CCallStats(void);
+
+    const std::string& Name(void) const { return m_strName; }
+
+    void Record(unsigned int call, uint64_t elapsedNs);
+
+    /*!
+     * \brief Sum the counters of all threads. Safe to call at any time.
+     */
+    void Collect(std::vector<CallHistogram>& histograms) const;
+
+    /*!
+     * \brief Log every call that was made at least once
+     */
+    void Dump(void) const;
+
+  private:
+    /*!
+     * \brief Counters written by one thread only. Atomics let other threads
+     *        read them while they change.
+     */
+    struct Counters
+    {
+      std::atomic<uint64_t> count;
+      std::atomic<uint64_t> totalNs;
+      std::atomic<uint64_t> maxNs;
+      std::atomic<uint64_t> buckets[CALL_STATS_BUCKETS];
+    };
+
+    Counters* GetThreadCounters(void);
+
+    const std::string        m_strName;
+    std::vector<std::string> m_callNames;
+    const uint64_t           m_id;      // Unique over the process lifetime, unlike this
+    const unsigned int       m_slot;    // Index into the per-thread tables
+    std::vector<Counters*>   m_threads; // One array of counters per thread
+    mutable PLATFORM::CMutex m_mutex;   // Taken once per thread, and for Collect()
+  };
+
+  /*!
+   * \brief Time a call for the lifetime of the object
+   */
+  class CCallTimer
+  {
+  public:
+    CCallTimer(CCallStats* stats, unsigned int call) :
+      m_stats(stats),
+      m_call(call),
+      m_start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~CCallTimer(void)
+    {
+      if (m_stats)
+      {
+        const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+        m_stats->Record(m_call, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+      }
+    }
+
+  private:
+    CCallStats* const                           m_stats;
+    const unsigned int                          m_call;
+    const std::chrono::steady_clock::time_point m_start;
+  };
+}
@@ -0,0 +1,195 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "MemoryDiff.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define HAS_SSE2  1
+  #if defined(__GNUC__)
+    #include <immintrin.h>
+    #define HAS_AVX2  1
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define HAS_NEON  1
+#endif
+
+using namespace NETPLAY;
+
+namespace
+{
+  /*!
+   * \brief Find the first block that is equal (bMatch) or differs (!bMatch)
+   */
+  typedef size_t (*ScanFunc)(const uint8_t* a, const uint8_t* b, size_t size, bool bMatch);
+
+  /*!
+   * \brief Compare the last block, which may be cut short by the end
+   */
+  inline size_t ScanTail(const uint8_t* a, const uint8_t* b, size_t offset, size_t size, bool bMatch)
+  {
+    if (offset < size && (std::memcmp(a + offset, b + offset, size - offset) == 0) == bMatch)
+      return offset;
+
+    return size;
+  }
+
+  inline bool BlockEqualPortable(const uint8_t* a, const uint8_t* b)
+  {
+    uint64_t x[MEMORY_DIFF_BLOCK / sizeof(uint64_t)];
+    uint64_t y[MEMORY_DIFF_BLOCK / sizeof(uint64_t)];
+    std::memcpy(x, a, MEMORY_DIFF_BLOCK);
+    std::memcpy(y, b, MEMORY_DIFF_BLOCK);
+
+    uint64_t diff = 0;
+    for (unsigned int i = 0; i < MEMORY_DIFF_BLOCK / sizeof(uint64_t); i++)
+      diff |= x[i] ^ y[i];
+
+    return diff == 0;
+  }
+
+#if defined(HAS_SSE2)
+  inline bool BlockEqualSSE2(const uint8_t* a, const uint8_t* b)
+  {
+    const __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a)),
+                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b)));
+    const __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 16)),
+                                      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 16)));
+
+    return _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+  }
+#endif
+
+#if defined(HAS_NEON)
+  inline bool BlockEqualNEON(const uint8_t* a, const uint8_t* b)
+  {
+    const uint8x16_t lo = vceqq_u8(vld1q_u8(a), vld1q_u8(b));
+    const uint8x16_t hi = vceqq_u8(vld1q_u8(a + 16), vld1q_u8(b + 16));
+
+    return vminvq_u8(vandq_u8(lo, hi)) == 0xFF;
+  }
+#endif
+
+  template <bool (*BlockEqual)(const uint8_t*, const uint8_t*)>
+  size_t Scan(const uint8_t* a, const uint8_t* b, size_t size, bool bMatch)
+  {
+    size_t offset = 0;
+    for (; offset + MEMORY_DIFF_BLOCK <= size; offset += MEMORY_DIFF_BLOCK)
+    {
+      if (BlockEqual(a + offset, b + offset) == bMatch)
+        return offset;
+    }
+
+    return ScanTail(a, b, offset, size, bMatch);
+  }
+
+#if defined(HAS_AVX2)
+  // Can't share Scan(), the loop itself must be compiled for AVX2
+  __attribute__((target("avx2")))
+  size_t ScanAVX2(const uint8_t* a, const uint8_t* b, size_t size, bool bMatch)
+  {
+    size_t offset = 0;
+    for (; offset + MEMORY_DIFF_BLOCK <= size; offset += MEMORY_DIFF_BLOCK)
+    {
+      const __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + offset)),
+                                           _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + offset)));
+
+      if ((static_cast<uint32_t>(_mm256_movemask_epi8(eq)) == 0xFFFFFFFFu) == bMatch)
+        return offset;
+    }
+
+    return ScanTail(a, b, offset, size, bMatch);
+  }
+#endif
+
+  struct Kernel
+  {
+    ScanFunc    scan;
+    const char* name;
+  };
+
+  Kernel SelectKernel(void)
+  {
+#if defined(HAS_AVX2)
+    if (__builtin_cpu_supports("avx2"))
+    {
+      const Kernel kernel = { ScanAVX2, "AVX2" };
+      return kernel;
+    }
+#endif
+#if defined(HAS_SSE2)
+    const Kernel kernel = { Scan<BlockEqualSSE2>, "SSE2" };
+#elif defined(HAS_NEON)
+    const Kernel kernel = { Scan<BlockEqualNEON>, "NEON" };
+#else
+    const Kernel kernel = { Scan<BlockEqualPortable>, "portable" };
+#endif
+    return kernel;
+  }
+
+  const Kernel& GetKernel(void)
+  {
+    static const Kernel kernel = SelectKernel();
+    return kernel;
+  }
+}
+
+size_t MemoryDiff::FindDifference(const uint8_t* a, const uint8_t* b, size_t size)
+{
+  return GetKernel().scan(a, b, size, false);
+}
+
+size_t MemoryDiff::FindMatch(const uint8_t* a, const uint8_t* b, size_t size)
+{
+  return GetKernel().scan(a, b, size, true);
+}
+
+void MemoryDiff::GetChangedRanges(const uint8_t* a, const uint8_t* b, size_t size, std::vector<MemoryRange>& ranges, size_t minGap /* = MEMORY_DIFF_BLOCK */)
+{
+  ranges.clear();
+
+  size_t offset = 0;
+  while (offset < size)
+  {
+    const size_t start = offset + FindDifference(a + offset, b + offset, size - offset);
+    if (start >= size)
+      break;
+
+    const size_t end = start + FindMatch(a + start, b + start, size - start);
+
+    if (!ranges.empty() && start - (ranges.back().offset + ranges.back().length) < minGap)
+      ranges.back().length = end - ranges.back().offset;
+    else
+    {
+      MemoryRange range = { start, end - start };
+      ranges.push_back(range);
+    }
+
+    offset = end;
+  }
+}
+
+const char* MemoryDiff::KernelName(void)
+{
+  return GetKernel().name;
+}
@@ -0,0 +1,69 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this Program; see the file COPYING. If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define MEMORY_DIFF_BLOCK  32  // Bytes compared at a time, ranges are aligned to this
+
+namespace NETPLAY
+{
+  struct MemoryRange
+  {
+    size_t offset;
+    size_t length;
+  };
+
+  /*!
+   * \brief Vectorized comparison of two buffers
+   *
+   * Uses AVX2 when the CPU supports it, otherwise SSE2 on x86-64 and NEON on
+   * ARM64, with a portable fallback.
+   */
+  class MemoryDiff
+  {
+  public:
+    /*!
+     * \brief Find the first block that differs
+     * \return The block's offset, or size if the buffers are equal
+     */
+    static size_t FindDifference(const uint8_t* a, const uint8_t* b, size_t size);
+
+    /*!
+     * \brief Find the first block that is equal
+     * \return The block's offset, or size if every block differs
+     */
+    static size_t FindMatch(const uint8_t* a, const uint8_t* b, size_t size);
+
+    /*!
+     * \brief Get the ranges of blocks that differ
+     *
+     * \param minGap Ranges separated by fewer equal bytes are merged
+     */
+    static void GetChangedRanges(const uint8_t* a, const uint8_t* b, size_t size, std::vector<MemoryRange>& ranges, size_t minGap = MEMORY_DIFF_BLOCK);
+
+    /*!
+     * \brief Name of the kernel in use, for logging
+     */
+    static const char* KernelName(void);
+  };
+}
@@ -32,6 +32,12 @@ using namespace NETPLAY;
 
 #define HELPER_LIBRARY_DIR  "resources"
 
+#if defined(_WIN32)
+  #define SERVER_EXECUTABLE "netplay_server.exe"
+#else
+  #define SERVER_EXECUTABLE "netplay_server"
+#endif
+
 #if defined(_WIN32)
   #define PATH_SEPARATOR    "\\"
 #else
@@ -87,3 +93,23 @@ std::string PathUtils::GetHelperLibraryDir(const std::string& strBasePath)
 {
   return strBasePath + PATH_SEPARATOR + HELPER_LIBRARY_DIR;
 }
+
+std::string PathUtils::GetServerPath(const std::string& strBasePath)
+{
+  return strBasePath + PATH_SEPARATOR + SERVER_EXECUTABLE;
+}
+
+std::string PathUtils::GetSavePath(const std::string& strSaveDirectory, const std::string& strContentPath, const std::string& strExtension)
+{
+  std::string strName = GetFileName(strContentPath);
+
+  size_t pos = strName.find_last_of('.');
+  if (pos != std::string::npos && pos > 0)
+    strName.erase(pos);
+
+  std::string strDirectory = strSaveDirectory;
+  if (!strDirectory.empty() && strDirectory.find_last_of("/\\") == strDirectory.length() - 1)
+    strDirectory.erase(strDirectory.length() - 1);
+
+  return strDirectory + PATH_SEPARATOR + strName + strExtension;
+}
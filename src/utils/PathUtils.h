@@ -49,5 +49,17 @@ namespace NETPLAY
      * \brief Get the directory for helper libraries
      */
     static std::string GetHelperLibraryDir(const std::string& strBasePath);
+
+    /*!
+     * \brief Get the path of the netplay_server executable used to host game
+     *        clients out of process
+     */
+    static std::string GetServerPath(const std::string& strBasePath);
+
+    /*!
+     * \brief Get the path of a save file for the given content, e.g.
+     *        <save dir>/<content name>.srm
+     */
+    static std::string GetSavePath(const std::string& strSaveDirectory, const std::string& strContentPath, const std::string& strExtension);
   };
 }
@@ -20,42 +20,183 @@
 
 #include "ReadWriteLock.h"
 
+#include <stddef.h>
+
+#if !defined(_WIN32)
+  #include "ipc/Futex.h"
+#else
+  #include <thread>
+#endif
+
 using namespace NETPLAY;
 using namespace PLATFORM;
 
+#define MAX_HELD_READ_LOCKS    8     // Read locks a thread can hold at once and still recurse
+
+namespace
+{
+  struct ReadHold
+  {
+    const CReadWriteLock* lock;
+    unsigned int          depth;
+  };
+
+  std::atomic<unsigned int> g_nextSlot(0);
+
+  thread_local unsigned int g_slot = RWLOCK_READER_SLOTS; // Assigned on first read
+  thread_local char         g_threadToken; // Its address identifies the thread
+  thread_local ReadHold     g_held[MAX_HELD_READ_LOCKS];
+
+  unsigned int GetSlot(void)
+  {
+    if (g_slot == RWLOCK_READER_SLOTS)
+      g_slot = g_nextSlot++ % RWLOCK_READER_SLOTS;
+    return g_slot;
+  }
+
+  ReadHold* FindHold(const CReadWriteLock* lock)
+  {
+    ReadHold* unused = NULL;
+    for (unsigned int i = 0; i < MAX_HELD_READ_LOCKS; i++)
+    {
+      if (g_held[i].lock == lock)
+        return &g_held[i];
+      if (unused == NULL && g_held[i].lock == NULL)
+        unused = &g_held[i];
+    }
+
+    // Recursion isn't tracked past MAX_HELD_READ_LOCKS
+    if (unused)
+    {
+      unused->lock = lock;
+      unused->depth = 0;
+    }
+
+    return unused;
+  }
+}
+
 CReadWriteLock::CReadWriteLock(void) :
-  m_readCount(0)
+  m_writers(0),
+  m_readerExits(0),
+  m_owner(NULL),
+  m_writeDepth(0)
 {
+  for (unsigned int i = 0; i < RWLOCK_READER_SLOTS; i++)
+    m_readers[i].count = 0;
 }
 
 void CReadWriteLock::LockRead(void)
 {
-  CLockObject lock(m_readLock);
+  std::atomic<uint32_t>& count = m_readers[GetSlot()].count;
+
+  ReadHold* hold = FindHold(this);
+
+  // Already a reader, or the writer: waiting for a writer would deadlock
+  if ((hold && hold->depth > 0) || m_owner.load(std::memory_order_relaxed) == &g_threadToken)
+  {
+    count++;
+    if (hold)
+      hold->depth++;
+    return;
+  }
+
+  for (;;)
+  {
+    count++;
+
+    const uint32_t writers = m_writers.load();
+    if (writers == 0)
+      break;
 
-  m_readCount++;
+    // Back off and let the writer through
+    count--;
+    m_readerExits++;
+    Wake(m_readerExits);
 
-  if (m_readCount == 1)
-    LockWrite();
+    Wait(m_writers, writers);
+  }
+
+  if (hold)
+    hold->depth++;
 }
 
 void CReadWriteLock::UnlockRead(void)
 {
-  CLockObject lock(m_readLock);
+  m_readers[GetSlot()].count--;
 
-  m_readCount--;
+  ReadHold* hold = FindHold(this);
+  if (hold && hold->depth > 0 && --hold->depth == 0)
+    hold->lock = NULL;
 
-  if (m_readCount == 0)
-    UnlockWrite();
+  if (m_writers.load() != 0)
+  {
+    m_readerExits++;
+    Wake(m_readerExits);
+  }
 }
 
 void CReadWriteLock::LockWrite(void)
 {
-  m_writeLock.Lock();
+  if (m_owner.load(std::memory_order_relaxed) == &g_threadToken)
+  {
+    m_writeDepth++;
+    return;
+  }
+
+  // Announce the writer first so that new readers stay out while it waits
+  m_writers++;
+
+  m_writeMutex.Lock();
+  m_owner = &g_threadToken;
+  m_writeDepth = 1;
+
+  for (;;)
+  {
+    const uint32_t exits = m_readerExits.load();
+    if (ActiveReaders() == 0)
+      break;
+    Wait(m_readerExits, exits);
+  }
 }
 
 void CReadWriteLock::UnlockWrite(void)
 {
-  m_writeLock.Unlock();
+  if (--m_writeDepth > 0)
+    return;
+
+  m_owner = NULL;
+  m_writeMutex.Unlock();
+
+  if (--m_writers == 0)
+    Wake(m_writers);
+}
+
+unsigned int CReadWriteLock::ActiveReaders(void) const
+{
+  unsigned int readers = 0;
+  for (unsigned int i = 0; i < RWLOCK_READER_SLOTS; i++)
+    readers += m_readers[i].count.load();
+  return readers;
+}
+
+void CReadWriteLock::Wait(std::atomic<uint32_t>& word, uint32_t expected)
+{
+#if !defined(_WIN32)
+  Futex::Wait(word, expected);
+#else
+  while (word.load() == expected)
+    std::this_thread::yield();
+#endif
+}
+
+void CReadWriteLock::Wake(std::atomic<uint32_t>& word)
+{
+#if !defined(_WIN32)
+  Futex::WakeAll(word);
+#else
+  (void)word; // Waiters poll
+#endif
 }
 
 CReadLockObject::CReadLockObject(CReadWriteLock& mutex) :
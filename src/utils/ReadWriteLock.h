@@ -21,8 +21,29 @@
 
 #include "platform/threads/mutex.h"
 
+#include <atomic>
+#include <stdint.h>
+
+#define RWLOCK_READER_SLOTS    16    // Reader counters, each on its own cache line
+#define RWLOCK_CACHE_LINE      64
+
 namespace NETPLAY
 {
+  /*!
+   * \brief Reader-writer lock tuned for many readers and rare writers
+   *
+   * Readers don't share a mutex. Each thread increments a counter in one of
+   * RWLOCK_READER_SLOTS cache-line-sized slots, so uncontended readers on
+   * different cores don't bounce a cache line between them.
+   *
+   * Writers take preference: once a writer is waiting, new readers back off
+   * until it is done, so a steady stream of readers can't starve it. Threads
+   * that block sleep on a futex instead of spinning.
+   *
+   * Read and write locks are both recursive, and a thread holding the write
+   * lock may also take the read lock. Upgrading a read lock to a write lock
+   * is not supported and will deadlock.
+   */
   class CReadWriteLock
   {
   public:
@@ -35,9 +56,23 @@ namespace NETPLAY
     void UnlockWrite(void);
 
   private:
-    PLATFORM::CMutex m_readLock;
-    PLATFORM::CMutex m_writeLock;
-    int              m_readCount;
+    struct ReaderSlot
+    {
+      std::atomic<uint32_t> count;
+      char                  padding[RWLOCK_CACHE_LINE - sizeof(std::atomic<uint32_t>)];
+    };
+
+    unsigned int ActiveReaders(void) const;
+
+    static void Wait(std::atomic<uint32_t>& word, uint32_t expected);
+    static void Wake(std::atomic<uint32_t>& word);
+
+    ReaderSlot               m_readers[RWLOCK_READER_SLOTS];
+    std::atomic<uint32_t>    m_writers;     // Waiting or active writers, readers sleep on this
+    std::atomic<uint32_t>    m_readerExits; // Bumped when a reader leaves while a writer waits
+    PLATFORM::CMutex         m_writeMutex;  // Serializes writers
+    std::atomic<const void*> m_owner;       // Thread holding the write lock
+    unsigned int             m_writeDepth;
   };
 
   class CReadLockObject
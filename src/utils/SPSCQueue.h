@@ -0,0 +1,99 @@
+/*
+ *      Copyright (C) 2015 Garrett Brown
+ *      Copyright (C) 2015 Team XBMC
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, see
+ *  <http://www.gnu.org/licenses/>.
+ *
+ */
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <vector>
+
+namespace NETPLAY
+{
+  /*!
+   * \brief Bounded lock-free queue for exactly one producer thread and one
+   *        consumer thread
+   */
+  template <typename T>
+  class CSPSCQueue
+  {
+  public:
+    CSPSCQueue(size_t capacity) :
+      m_items(capacity + 1), // One slot is always empty to tell full from empty
+      m_head(0),
+      m_tail(0)
+    {
+    }
+
+    /*!
+     * \brief Producer only
+     * \return false if the queue is full
+     */
+    bool TryPush(const T& item)
+    {
+      const size_t tail = m_tail.load(std::memory_order_relaxed);
+      const size_t next = Next(tail);
+
+      if (next == m_head.load(std::memory_order_acquire))
+        return false;
+
+      m_items[tail] = item;
+      m_tail.store(next, std::memory_order_release);
+
+      return true;
+    }
+
+    /*!
+     * \brief Consumer only
+     * \return false if the queue is empty
+     */
+    bool TryPop(T& item)
+    {
+      const size_t head = m_head.load(std::memory_order_relaxed);
+
+      if (head == m_tail.load(std::memory_order_acquire))
+        return false;
+
+      item = m_items[head];
+      m_items[head] = T(); // Release any resources held by the slot
+      m_head.store(Next(head), std::memory_order_release);
+
+      return true;
+    }
+
+    /*!
+     * \brief Approximate when called while the other thread is active
+     */
+    size_t Size(void) const
+    {
+      const size_t head = m_head.load(std::memory_order_acquire);
+      const size_t tail = m_tail.load(std::memory_order_acquire);
+
+      return tail >= head ? tail - head : tail + m_items.size() - head;
+    }
+
+    size_t Capacity(void) const { return m_items.size() - 1; }
+
+  private:
+    size_t Next(size_t index) const { return index + 1 < m_items.size() ? index + 1 : 0; }
+
+    std::vector<T>      m_items;
+    std::atomic<size_t> m_head; // Next item to pop, owned by the consumer
+    std::atomic<size_t> m_tail; // Next slot to fill, owned by the producer
+  };
+}